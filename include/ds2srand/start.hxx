@@ -4,28 +4,78 @@
 #include <ds2srand/start/alter.hxx>
 #include <ds2srand/start/menutext.hxx>
 #include <ds2srand/start/stats.hxx>
+#include <modules/param_writes.hpp>
+#include <modules/spoiler_log.hpp>
 
 #include <array>
+#include <cstdint>
+#include <filesystem>
+#include <random>
 #include <string>
 
 namespace ds2srand::start {
+    // Name the param coordinator knows this module by
+    inline constexpr std::string_view module_name{ "start" };
+
+    // Files and generator of one scatter, a run on its own root folder shares nothing with the others
+    // With a coordinator the stats are handed to it as edits of its PlayerStatusParam.param instead of written to statsdata
+    struct Context {
+        MenuText menutext;
+        StatsData statsdata;
+        std::mt19937_64 generator;
+        param_writes::Coordinator *writes;
+        explicit Context( uint64_t seed, std::filesystem::path const &root = { }, param_writes::Coordinator *writes = nullptr ) :
+            menutext{ root / MenuText::default_path },
+            statsdata{ root / StatsData::default_path },
+            generator{ seed },
+            writes{ writes }
+        { }
+    };
+
+    inline void submit( param_writes::Coordinator &writes, std::uint8_t index, Stats const &stats ) {
+        auto const name = std::filesystem::path{ StatsData::default_path }.filename( ).string( );
+        for ( auto &put : StatsData::puts( index, stats ) ) writes.submit_at( module_name, name, put.offset, std::move( put.bytes ) );
+    }
+
     // TODO seperate interface and implementation, e.g move to source/classes.cpp
-    inline auto scatter( ) -> Alter::array_view {
+    // With a spoiler log, each class's new name and stats go to its start_classes section
+    inline auto scatter( Context &context, spoiler_log::Writer *spoiler = nullptr ) -> Alter::array_view {
         Alter::array_view names{ };
-        MenuText menutext{ };
-        StatsData statsdata{ };
-        std::random_device rd;
-        std::mt19937_64 gen{ rd( ) };
+        auto &menutext = context.menutext;
+        auto &statsdata = context.statsdata;
+        auto &gen = context.generator;
+        if ( spoiler ) spoiler->section( "start_classes" );
         for ( auto &orig_class : Original::array ) {
             Stats randstats( 9u, 8u, gen );
             auto group = randstats.group( );
             std::string_view classname = Alter::replacements[(int)group][orig_class.index];
             menutext.override_bytes( orig_class.index, classname );
-            statsdata.write( orig_class.index, randstats );
+            if ( context.writes ) submit( *context.writes, orig_class.index, randstats );
+            else statsdata.write( orig_class.index, randstats );
             names[orig_class.index] = classname;
+            if ( !spoiler ) continue;
+            spoiler->begin_record( );
+            spoiler->field( "class", orig_class.index );
+            spoiler->field( "name", classname );
+            spoiler->field( "soul_level", randstats.soul_level( ) );
+            spoiler->field( "vigor", randstats.vigor( ) );
+            spoiler->field( "endurance", randstats.endurance( ) );
+            spoiler->field( "vitality", randstats.vitality( ) );
+            spoiler->field( "attunement", randstats.attunement( ) );
+            spoiler->field( "strength", randstats.strength( ) );
+            spoiler->field( "dexterity", randstats.dexterity( ) );
+            spoiler->field( "adaptability", randstats.adaptability( ) );
+            spoiler->field( "intelligence", randstats.intelligence( ) );
+            spoiler->field( "faith", randstats.faith( ) );
+            spoiler->end_record( );
         }
         return names;
     }
+
+    inline auto scatter( spoiler_log::Writer *spoiler = nullptr, param_writes::Coordinator *writes = nullptr ) -> Alter::array_view {
+        Context context{ std::random_device{ }( ), { }, writes };
+        return scatter( context, spoiler );
+    }
     // TODO split to private menutext and statsdata restore functions
     inline void restore( ) {
         MenuText menutext{ };
@@ -34,7 +84,12 @@ namespace ds2srand::start {
         statsdata.restore( );
     }
 
-    inline auto optimal200( ) -> void {
+    inline auto optimal200( param_writes::Coordinator *writes = nullptr ) -> void {
+        if ( writes ) {
+            MenuText{ }.restore( );
+            for ( auto &orig_class : Original::array ) submit( *writes, orig_class.index, Optimal200::array[ orig_class.index ].stats );
+            return;
+        }
         restore( ); // TODO only need to restore menutext
         StatsData statsdata{ };
         for ( auto &orig_class : Original::array ) {
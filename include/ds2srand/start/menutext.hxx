@@ -3,13 +3,16 @@
 
 #include <array>
 #include <cinttypes>
+#include <filesystem>
 #include <fstream>
+#include <string_view>
 
 namespace ds2srand::start {
     // This class is used to override the names of the classes
     struct MenuText {
+        inline static constexpr std::string_view default_path{ "menu/text/english/common.fmg" };
         std::fstream file;
-        MenuText( ) : file{ "menu/text/english/common.fmg", std::ios::binary | std::ios::in | std::ios::out } {
+        explicit MenuText( std::filesystem::path const &path = default_path ) : file{ path, std::ios::binary | std::ios::in | std::ios::out } {
             if ( !file.is_open( ) ) {
                 throw std::runtime_error( "Error opening common.fmg file" );
             }
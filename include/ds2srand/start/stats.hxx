@@ -8,6 +8,7 @@
 #include <cassert>
 #include <concepts>
 #include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <random>
 #include <stdexcept>
@@ -233,8 +234,9 @@ namespace ds2srand::start {
     };
 
     struct StatsData {
+        inline static constexpr std::string_view default_path{ "Param/PlayerStatusParam.param" };
         std::fstream file;
-        StatsData( ) : file{ "Param/PlayerStatusParam.param", std::ios::binary | std::ios::in | std::ios::out } {
+        explicit StatsData( std::filesystem::path const &path = default_path ) : file{ path, std::ios::binary | std::ios::in | std::ios::out } {
             if ( !file.is_open( ) ) throw std::runtime_error( "Error opening PlayerStatusParam.param file" );
         }
         inline static constexpr std::array< uint8_t, 9 > const offsets{ 0x02u, 0x08u, 0x0Au, 0x0Cu, 0x0Eu, 0x10u, 0x12u, 0x14u, 0x16u };
@@ -290,15 +292,31 @@ namespace ds2srand::start {
 
         auto read( std::uint8_t index ) -> Stats { return read( array.at( index ) ); }
 
-        void write( OverrideBytes const &bytesclass, Stats const &stats ) {
+        // Where in the file write puts each value and its bytes, soul level first
+        struct Put {
+            unsigned offset;
+            std::string bytes;
+        };
+
+        static auto puts( OverrideBytes const &bytesclass, Stats const &stats ) -> std::vector< Put > {
             StatsAdapter adapter{ stats };
-            for (auto i = 0u; i < offsets.size( ); ++i ) {
-                file.seekp( bytesclass.offset + offsets[i] );
-                file.put( adapter.array[i] );
-            }
             uint16_t sum = stats.soul_level( );
-            file.seekp( bytesclass.offset );
-            file.write( reinterpret_cast< char const * >( &sum ), sizeof( sum ) );
+            std::vector< Put > result{ };
+            result.reserve( offsets.size( ) + 1u );
+            result.push_back( { bytesclass.offset, std::string( reinterpret_cast< char const * >( &sum ), sizeof( sum ) ) } );
+            for ( auto i = 0u; i < offsets.size( ); ++i ) {
+                result.push_back( { bytesclass.offset + offsets[i], std::string( 1u, static_cast< char >( adapter.array[i] ) ) } );
+            }
+            return result;
+        }
+
+        static auto puts( std::uint8_t index, Stats const &stats ) -> std::vector< Put > { return puts( array.at( index ), stats ); }
+
+        void write( OverrideBytes const &bytesclass, Stats const &stats ) {
+            for ( auto const &put : puts( bytesclass, stats ) ) {
+                file.seekp( put.offset );
+                file.write( put.bytes.data( ), static_cast< std::streamsize >( put.bytes.size( ) ) );
+            }
         }
 
         void write( std::uint8_t index, Stats const &stats ) { write( array.at( index ), stats ); }
@@ -0,0 +1,46 @@
+#ifndef MY_BLOCK_STORE
+#define MY_BLOCK_STORE
+
+#include <stdint.h>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Param folders of many seeds kept as shared chunks, a seed only costs the chunks no other seed already has
+namespace block_store{
+    //Content defined chunk limits, a row deleted near the start of a file only changes the chunks around it
+    constexpr size_t min_chunk = 1024;
+    constexpr size_t max_chunk = 32768;
+    constexpr uint64_t boundary_mask = (1u<<12)-1;//4KB chunks on average
+
+    //Offsets where the chunks of data end, the last one is always data.size()
+    std::vector<size_t> chunk_ends(std::string_view data);
+    std::string hash(std::string_view data);
+
+    struct Stats{
+        uint64_t seeds{0};
+        uint64_t files{0};
+        uint64_t logical_bytes{0};//What the seeds would take as plain folders
+        uint64_t chunks{0};
+        uint64_t stored_bytes{0};
+    };
+    class Store{
+    public:
+        explicit Store(std::filesystem::path folder);
+        //Every file of param_folder goes under name, replacing a seed already stored with that name
+        bool add(const std::string& name,const std::filesystem::path& param_folder);
+        //Rebuilds the files of name in out_folder, each one checked against its hash
+        bool extract(const std::string& name,const std::filesystem::path& out_folder)const;
+        //Forgets name and deletes the chunks no other seed uses
+        bool drop(const std::string& name);
+        std::vector<std::string> names()const;
+        Stats stats()const;
+    private:
+        std::filesystem::path chunk_path(const std::string& chunk)const;
+        std::filesystem::path seed_path(const std::string& name)const;
+        std::filesystem::path folder;
+    };
+}
+
+#endif
@@ -2,6 +2,16 @@
 #define MY_ITEMRANDO
 
 #include <stdint.h>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace output_cache{class Cache;}
+namespace param_writes{class Coordinator;}
+namespace spoiler_log{class Writer;}
+namespace search{struct Predicate;struct Options;}
 namespace item_rando{
     struct ItemRandoConfig{
         uint64_t seed{0u};
@@ -23,19 +33,60 @@ namespace item_rando{
         bool write_cheatsheet{false};
         bool melentia_lifegems{false};
         bool randomize_key_items{true};
+        bool verify_ledger{false};
         bool valid{false};
     };
     struct ItemRandoData;
+    //Loaded data and config, owned here so nothing has to be freed
+    //Runs only read it, so one IRData serves runs of any number of seeds at the same time
     struct IRData{
+        IRData();
+        ~IRData();
+        IRData(IRData&&) noexcept;
+        IRData& operator=(IRData&&) noexcept;
+        ItemRandoConfig config;
+        std::unique_ptr<ItemRandoData> data;
+    };
+    //What one run has to itself: its config, where its params go and what it reports to
+    //Runs at the same time need their own out_folder and spoiler log, a cache can be shared
+    //With a coordinator params are handed to it instead of written, modules running together write each file once
+    //Cheatsheets go to cheatsheet_folder, named by time and seed
+    //The seed's stages run on stage_threads threads, 0 for one per core, callers already running seeds in parallel pass 1
+    struct Run{
         ItemRandoConfig config;
-        ItemRandoData* data;
+        std::filesystem::path out_folder{"Param"};
+        output_cache::Cache* cache{nullptr};
+        spoiler_log::Writer* spoiler{nullptr};
+        param_writes::Coordinator* writes{nullptr};
+        std::filesystem::path cheatsheet_folder{"cheatsheets/items"};
+        size_t stage_threads{0};
     };
+    //Defaults for what the text doesn't set, and a new seed unless it gives one
+    void read_config(std::istream& file,ItemRandoConfig& config);
     bool load_randomizer_data(IRData& irdata);
-    bool randomize_items(IRData& irdata,bool devmode);
+    //Class stats from a PlayerStatusParam file, for when the start module scattered them after the data was loaded
+    //Runs after it only share cached params with runs that took the same stats
+    bool take_class_stats(IRData& irdata,const std::string& classes_param);
+    //With a cache, params of an already made seed and config are taken from it unless a cheatsheet or spoiler log is wanted
+    //With a spoiler log, lots, enemy drops, shops, classes and gifts are written to it
+    bool randomize_items(const IRData& irdata,const Run& run,bool devmode);
+    //Plans keep the decisions of a seed in a few kilobytes, params are made from them on demand
+    //The plan is of the run's config, nothing is written to its out_folder
+    bool save_item_plan(const IRData& irdata,const std::string& path,const Run& run);
+    //The plan brings its own config, the run's config and cache are not used
+    bool materialize_item_plan(const IRData& irdata,const std::string& path,const Run& run,bool devmode);
     void write_config_file(ItemRandoConfig& config);
-    void free_rando_data(IRData& irdata);
-    bool restore_default_params();
-    bool add_item_shop(int32_t item_id,bool devmode);
+    //Vanilla params back into the run's out_folder
+    bool restore_default_params(const Run& run);
+    //Adds the item to the shop param already in the run's out_folder
+    bool add_item_shop(int32_t item_id,const Run& run,bool devmode);
+    //Seed search, key-in:<key>=<room>|<room> and key-before:<key>=<room>
+    bool is_item_predicate(const search::Predicate& predicate);
+    bool validate_item_predicate(const IRData& irdata,const search::Predicate& predicate);
+    bool check_item_predicates(const IRData& irdata,uint64_t seed,const std::vector<search::Predicate>& predicates);
+    //Key placement alone for every seed of the range, no params
+    //Writes depths.csv, key_rooms.csv and rooms.csv to folder
+    bool analyze_key_placement(const IRData& irdata,const search::Options& options,const std::string& folder);
 }
 
 #endif
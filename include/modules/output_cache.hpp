@@ -0,0 +1,50 @@
+#ifndef MY_OUTPUT_CACHE
+#define MY_OUTPUT_CACHE
+
+#include <stdint.h>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Param files of already made seeds, one folder per key, oldest used entries go first once the cache is over its size
+namespace output_cache{
+    //Same module, config, seed, program version and code, and vanilla data give the same params
+    std::string make_key(std::string_view module,std::string_view config_text,uint64_t seed,uint64_t data_hash);
+    //Every file under folder, names and contents
+    uint64_t hash_folder(const std::filesystem::path& folder);
+    struct File{
+        std::filesystem::path path;
+        bool link;//False for files something edits in place later, they are always copied
+    };
+    //A file only made in memory so far
+    struct Contents{
+        std::string name;
+        std::string data;
+        bool link;
+    };
+    //Modules running at the same time can share one
+    class Cache{
+    public:
+        Cache(std::filesystem::path folder,uint64_t max_bytes);
+        //Puts the files of key in out_folder, false on a miss
+        bool serve(const std::string& key,const std::filesystem::path& out_folder);
+        //The files of key where they are in the cache, for callers that put them in place themselves, false on a miss
+        bool lookup(const std::string& key,std::vector<File>& files);
+        void store(const std::string& key,const std::vector<File>& files);
+        void store(const std::string& key,const std::vector<Contents>& files);
+        void print_metrics()const;
+    private:
+        bool find(const std::string& key,std::vector<File>& files);
+        void evict();
+        void save_metrics()const;
+        std::filesystem::path folder;
+        uint64_t max_bytes;
+        uint64_t hits{0},misses{0},evictions{0};
+        uint64_t run_hits{0},run_misses{0};
+        mutable std::mutex mutex;
+    };
+}
+
+#endif
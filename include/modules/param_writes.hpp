@@ -0,0 +1,68 @@
+#ifndef MY_PARAM_WRITES
+#define MY_PARAM_WRITES
+
+#include <stdint.h>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Param files several modules write in one run, every module hands in what it changes and each file is written once at the end
+//A whole file is the base the module built from, only the edits are owned, so start's stats go on top of the item classes file
+//Modules are merged in the order they were given, not the order their threads finish, so a run always writes the same bytes
+namespace param_writes{
+    //Bytes of one row, offset is from the start of the row's data
+    struct Edit{
+        uint64_t row;
+        uint32_t offset;
+        std::string bytes;
+    };
+    //Two modules set a field to different values, the earlier module's value was written
+    struct Conflict{
+        std::string file;
+        uint64_t row;
+        uint32_t offset;
+        std::string kept,dropped;
+    };
+    //Edits turning base into contents, false when the files don't have the same rows
+    bool diff(const std::string& base,const std::string& contents,std::vector<Edit>& edits);
+    class Coordinator{
+    public:
+        Coordinator(std::filesystem::path out_folder,std::vector<std::string> modules);
+        //Every submit can come from any thread
+        void submit_file(std::string_view module,const std::string& name,std::string contents);
+        //A whole file already on disk, linked instead of written when nothing else touches it
+        void submit_link(std::string_view module,const std::string& name,const std::filesystem::path& from);
+        void submit_edits(std::string_view module,const std::string& name,std::vector<Edit> edits);
+        //Bytes at an offset of the file, for modules that only know the file's layout, turned into a row edit on commit
+        void submit_at(std::string_view module,const std::string& name,uint64_t file_offset,std::string bytes);
+        //Merges and writes every file, without a whole file the one in the out folder is the base
+        std::vector<std::filesystem::path> commit();
+        //What the file would be if it was committed now, for a module that reads what another one changed
+        bool preview(const std::string& name,std::string& contents);
+        const std::vector<Conflict>& conflicts()const{return found;}
+        void print_conflicts()const;
+    private:
+        struct Submission{
+            size_t rank;
+            size_t order;
+            std::string module;
+            enum Kind{File,Link,Edits,At}kind;
+            std::string contents;
+            std::filesystem::path from;
+            std::vector<Edit> edits;
+            uint64_t file_offset{0};
+        };
+        void add(const std::string& name,Submission submission);
+        static void sort(std::vector<Submission>& submissions);
+        bool merge(const std::string& name,std::vector<Submission>& submissions,std::string& base,std::vector<Conflict>& conflicts)const;
+        std::filesystem::path out_folder;
+        std::vector<std::string> modules;
+        std::mutex mutex;
+        std::vector<std::pair<std::string,Submission>> submitted;
+        std::vector<Conflict> found;
+    };
+}
+
+#endif
@@ -2,9 +2,16 @@
 #define MY_ENEMYRANDO
 
 #include <stdint.h>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
 #include <vector>
 #include <string>
 
+namespace output_cache{class Cache;}
+namespace param_writes{class Coordinator;}
+namespace spoiler_log{class Writer;}
+namespace search{struct Predicate;struct Options;}
 namespace randomizer{
     struct MapSetting{
         std::string map_name;
@@ -61,25 +68,64 @@ namespace randomizer{
         bool enemy_scaling;
         bool scale_bosses;
         bool write_cheatsheet;
+        bool write_stage_graph;
         bool valid;
     };
     //Forward declarations
     struct MapData;
     using GameData=std::vector<MapData>;
     struct EnemyTable;
+    //Loaded data and config, owned here so nothing has to be freed
+    //Runs only read it, so one Data serves runs of any number of seeds at the same time
     struct Data{
-        GameData* game_data;
-        EnemyTable* enemy_table;
+        Data();
+        ~Data();
+        Data(Data&&) noexcept;
+        Data& operator=(Data&&) noexcept;
+        std::unique_ptr<GameData> game_data;
+        std::unique_ptr<EnemyTable> enemy_table;
         Config config;
+        //Hash of the vanilla data the tables came from, for cache keys of every run
+        uint64_t data_hash{0u};
+    };
+    //What one run has to itself: its config, where its params go and what it reports to
+    //Runs at the same time need their own out_folder and spoiler log, a cache can be shared
+    //With a coordinator params are handed to it instead of written, modules running together write each file once
+    //Cheatsheets and stage graphs go to cheatsheet_folder, named by time and seed
+    //The seed's stages run on stage_threads threads, 0 for one per core, callers already running seeds in parallel pass 1
+    struct Run{
+        Config config;
+        std::filesystem::path out_folder{"Param"};
+        output_cache::Cache* cache{nullptr};
+        spoiler_log::Writer* spoiler{nullptr};
+        param_writes::Coordinator* writes{nullptr};
+        std::filesystem::path cheatsheet_folder{"cheatsheets/enemies"};
+        size_t stage_threads{0};
     };
     std::vector<EnemyIdName> get_enemytable(Data& data);
     std::vector<EnemyIdName> get_bosstable(Data& data);
     void restore_zone_limit_defaults(Config& config);
+    //Defaults for what the text doesn't set, and a new seed unless it gives one
+    bool read_config(std::istream& file,Config& config);
     void write_configfile(Config& config);
     bool load_data(Data& data);
-    bool randomize(Data& data,bool devmode);
-    bool restore_default_params(bool devmode);
-    void free_stuff(Data& data);
+    //With a cache, params of an already made seed and config are taken from it unless a cheatsheet or spoiler log is wanted
+    //With a spoiler log, the replaced generators and boss arenas are written to it
+    bool randomize(const Data& data,const Run& run,bool devmode);
+    //Plans keep the decisions of a seed in a few kilobytes, params are made from them on demand
+    //The plan is of the run's config, nothing is written to its out_folder
+    bool save_enemy_plan(const Data& data,const std::string& path,const Run& run);
+    //The plan brings its own config, the run's config and cache are not used
+    bool materialize_enemy_plan(const Data& data,const std::string& path,const Run& run,bool devmode);
+    //Vanilla params back into the run's out_folder
+    bool restore_default_params(const Run& run,bool devmode);
+    //Seed search, boss:<arena>=<huge|big|mid|boss> and roaming:<map>=<none|any|boss>
+    bool is_enemy_predicate(const search::Predicate& predicate);
+    bool validate_enemy_predicate(const Data& data,const search::Predicate& predicate);
+    bool check_enemy_predicates(const Data& data,uint64_t seed,const std::vector<search::Predicate>& predicates);
+    //Runs only the enemy selection over the seeds of options and writes per map type counts, roaming bosses,
+    //deck reshuffles and how evenly types were picked as CSV files in folder
+    bool analyze_enemy_selection(const Data& data,const search::Options& options,const std::string& folder);
 };
 
 #endif
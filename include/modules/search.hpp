@@ -0,0 +1,34 @@
+#ifndef MY_SEARCH
+#define MY_SEARCH
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Looks for seeds matching predicates, every module checks the predicates it knows without writing any params
+namespace search{
+    //kind:subject=value, like boss:Pursuer=huge or key-before:Lenigrast's Key=Heides Tower
+    struct Predicate{
+        std::string kind;
+        std::string subject;
+        std::string value;
+        std::string text;
+    };
+    bool parse_predicate(std::string_view text,Predicate& predicate);
+    struct Options{
+        uint64_t first_seed{0u};
+        uint64_t seeds{100000u};
+        size_t matches{10u};
+        size_t threads{0u};
+    };
+    //Returns the lowest matching seeds, at most options.matches of them
+    std::vector<uint64_t> run(const Options& options,const std::function<bool(uint64_t)>& check);
+    //Workers used, options.threads or one per core
+    size_t thread_count(const Options& options);
+    //Calls work for every seed of the range, worker is below thread_count and one thread always passes the same one
+    void each(const Options& options,const std::function<void(size_t worker,uint64_t seed)>& work);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef MY_SPOILER_LOG
+#define MY_SPOILER_LOG
+
+#include <stdint.h>
+#include <concepts>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+//What a seed turned into, one file for every module so tools read it instead of parsing the cheatsheets
+//A log is one object of top level fields and sections, a section is an array of flat records:
+//{"enemy_seed":1,"generators":[{"map":"m10_02_00_00","generator":1000,...},...],"lots":[...]}
+//Records go to the stream as they are written, only a small buffer is held so every seed of a batch can have one
+namespace spoiler_log{
+    enum class Format{Json,Binary};
+    //Json for .json paths and Binary for anything else
+    Format format_of(std::string_view path);
+    class Writer{
+    public:
+        Writer(std::ostream& out,Format format);
+        ~Writer();
+        Writer(const Writer&)=delete;
+        Writer& operator=(const Writer&)=delete;
+        //Inside a record it adds to the record, otherwise it is a top level field and closes the open section
+        void field(std::string_view name,std::string_view value);
+        void field(std::string_view name,const char* value){field(name,std::string_view{value});}
+        void field(std::string_view name,bool value);
+        void field(std::string_view name,double value);
+        void field(std::string_view name,std::signed_integral auto value){signed_field(name,(int64_t)value);}
+        void field(std::string_view name,std::unsigned_integral auto value){unsigned_field(name,(uint64_t)value);}
+        void section(std::string_view name);
+        void begin_record();
+        void end_record();
+        //Closes everything, the destructor calls it too
+        void finish();
+        uint64_t records()const{return record_count;}
+    private:
+        void signed_field(std::string_view name,int64_t value);
+        void unsigned_field(std::string_view name,uint64_t value);
+        //Json writes the separator and key, Binary the name id
+        void key(std::string_view name,uint8_t op);
+        void close_section();
+        void flush();
+        std::ostream& out;
+        Format format;
+        std::string buffer;
+        std::unordered_map<std::string,uint32_t> names;//Binary only, names are declared the first time they are used
+        bool in_section{false},in_record{false},finished{false};
+        bool first_top{true},first_record{true},first_field{true};
+        uint64_t record_count{0};
+    };
+    //Replays a binary log into a Json one, the text is the same the Json writer would have made
+    bool binary_to_json(std::istream& in,std::ostream& out);
+    //Replays a binary log's calls on out, so logs written apart can be joined in a fixed order
+    bool replay(std::istream& in,Writer& out);
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include "modules/block_store.hpp"
+#include "modules/utils.hpp"
+
+#include <array>
+#include <set>
+#include <sstream>
+
+namespace block_store{
+    const std::string chunks_name = "chunks";
+    const std::string seeds_name = "seeds";
+    const std::string manifest_extension = ".txt";
+
+    //Random value per byte for the rolling hash, fixed so chunk boundaries never change between versions
+    const std::array<uint64_t,256> gear = []{
+        std::array<uint64_t,256> table{};
+        uint64_t state = 0x9e3779b97f4a7c15ull;
+        for(auto& value:table){
+            state+=0x9e3779b97f4a7c15ull;
+            uint64_t z = state;
+            z = (z^(z>>30))*0xbf58476d1ce4e5b9ull;
+            z = (z^(z>>27))*0x94d049bb133111ebull;
+            value = z^(z>>31);
+        }
+        return table;
+    }();
+
+    std::vector<size_t> chunk_ends(std::string_view data){
+        std::vector<size_t> ends;
+        size_t start = 0;
+        while(start<data.size()){
+            size_t end = std::min(data.size(),start+max_chunk);
+            size_t i = std::min(end,start+min_chunk);
+            uint64_t rolling = 0;
+            for(;i<end;i++){
+                rolling = (rolling<<1)+gear[(uint8_t)data[i]];
+                //Top bits depend on the last 64 bytes, lower ones on fewer
+                if(((rolling>>40)&boundary_mask)==0){
+                    i++;
+                    break;
+                }
+            }
+            ends.push_back(i);
+            start = i;
+        }
+        return ends;
+    }
+
+    uint64_t fnv1a(std::string_view data,uint64_t hash){
+        for(char c:data){
+            hash^=(uint8_t)c;
+            hash*=1099511628211ull;
+        }
+        return hash;
+    }
+    std::string hex(uint64_t value){
+        std::string out(16,'0');
+        for(int i = 15;i>=0;i--,value>>=4) out[i] = "0123456789abcdef"[value&15];
+        return out;
+    }
+    std::string hash(std::string_view data){
+        //Size goes in too, two differently seeded hashes so different chunks don't share a name
+        auto size = std::to_string(data.size());
+        return hex(fnv1a(data,fnv1a(size,14695981039346656037ull)))+hex(fnv1a(data,fnv1a(size,0x6a09e667f3bcc909ull)));
+    }
+
+    //One line per file: name, size, whole file hash and its chunks in order
+    struct FileEntry{
+        std::string name;
+        uint64_t size{0};
+        std::string hash;
+        std::vector<std::string> chunks;
+    };
+    bool read_manifest(const std::filesystem::path& path,std::vector<FileEntry>& files){
+        std::ifstream file(path);
+        if(!file) return false;
+        std::string line;
+        while(cboyo::parse::getline(file,line)){
+            std::stringstream ss(line);
+            FileEntry entry;
+            if(!(ss>>entry.name>>entry.size>>entry.hash)) return false;
+            std::string chunk;
+            while(ss>>chunk) entry.chunks.push_back(chunk);
+            files.push_back(std::move(entry));
+        }
+        return true;
+    }
+
+    Store::Store(std::filesystem::path folder_):folder(std::move(folder_)){}
+    std::filesystem::path Store::chunk_path(const std::string& chunk)const{
+        return folder/chunks_name/chunk.substr(0,2)/chunk;
+    }
+    std::filesystem::path Store::seed_path(const std::string& name)const{
+        return folder/seeds_name/(name+manifest_extension);
+    }
+    bool Store::add(const std::string& name,const std::filesystem::path& param_folder){
+        if(name.empty()||name.find_first_of("/\\ ")!=std::string::npos){
+            std::cout<<"Invalid seed name "<<name<<'\n';
+            return false;
+        }
+        if(!std::filesystem::is_directory(param_folder)){
+            std::cout<<"Can't find folder "<<param_folder<<'\n';
+            return false;
+        }
+        std::vector<std::filesystem::path> paths;
+        for(const auto& entry:std::filesystem::directory_iterator(param_folder)){
+            if(entry.is_regular_file()) paths.push_back(entry.path());
+        }
+        std::sort(paths.begin(),paths.end());
+        std::stringstream manifest;
+        for(const auto& path:paths){
+            auto data = get_file_contents_binary(path);
+            auto file_name = path.filename().string();
+            if(file_name.find(' ')!=std::string::npos){
+                std::cout<<"Skipped "<<path<<", names with spaces can't be stored\n";
+                continue;
+            }
+            manifest<<file_name<<' '<<data.size()<<' '<<hash(data);
+            size_t start = 0;
+            for(auto end:chunk_ends(data)){
+                std::string_view chunk(data.data()+start,end-start);
+                auto chunk_hash = hash(chunk);
+                auto to = chunk_path(chunk_hash);
+                //Chunks are named by content, one already there is the same chunk
+                if(!std::filesystem::exists(to)){
+                    std::filesystem::create_directories(to.parent_path());
+                    write_to_file_binary(to,std::string(chunk));
+                }
+                manifest<<' '<<chunk_hash;
+                start = end;
+            }
+            manifest<<'\n';
+        }
+        //Chunks go first and the manifest last, an interrupted add never leaves a seed pointing at missing chunks
+        std::filesystem::create_directories(folder/seeds_name);
+        write_to_file_binary(seed_path(name),manifest.str());
+        return true;
+    }
+    bool Store::extract(const std::string& name,const std::filesystem::path& out_folder)const{
+        std::vector<FileEntry> files;
+        if(!read_manifest(seed_path(name),files)){
+            std::cout<<"Seed "<<name<<" is not in the store\n";
+            return false;
+        }
+        if(!std::filesystem::exists(out_folder)){
+            std::filesystem::create_directories(out_folder);
+        }
+        for(const auto& file:files){
+            std::string data;
+            data.reserve(file.size);
+            for(const auto& chunk:file.chunks){
+                auto path = chunk_path(chunk);
+                if(!std::filesystem::exists(path)){
+                    std::cout<<"Missing chunk "<<chunk<<" of "<<file.name<<'\n';
+                    return false;
+                }
+                data+=get_file_contents_binary(path);
+            }
+            if(data.size()!=file.size||hash(data)!=file.hash){
+                std::cout<<"Rebuilt "<<file.name<<" doesn't match its hash\n";
+                return false;
+            }
+            write_to_file_binary(out_folder/file.name,data);
+        }
+        return true;
+    }
+    bool Store::drop(const std::string& name){
+        auto path = seed_path(name);
+        if(!std::filesystem::exists(path)){
+            std::cout<<"Seed "<<name<<" is not in the store\n";
+            return false;
+        }
+        std::filesystem::remove(path);
+        std::set<std::string> used;
+        for(const auto& other:names()){
+            std::vector<FileEntry> files;
+            if(!read_manifest(seed_path(other),files)){
+                //Sweeping without knowing every seed's chunks could delete some of them
+                std::cout<<"Can't read seed "<<other<<", unused chunks kept\n";
+                return true;
+            }
+            for(const auto& file:files) used.insert(file.chunks.begin(),file.chunks.end());
+        }
+        if(!std::filesystem::exists(folder/chunks_name)) return true;
+        for(const auto& entry:std::filesystem::recursive_directory_iterator(folder/chunks_name)){
+            if(entry.is_regular_file()&&!used.contains(entry.path().filename().string())){
+                std::error_code error;
+                std::filesystem::remove(entry.path(),error);
+            }
+        }
+        return true;
+    }
+    std::vector<std::string> Store::names()const{
+        std::vector<std::string> out;
+        if(!std::filesystem::exists(folder/seeds_name)) return out;
+        for(const auto& entry:std::filesystem::directory_iterator(folder/seeds_name)){
+            if(entry.is_regular_file()&&entry.path().extension()==manifest_extension) out.push_back(entry.path().stem().string());
+        }
+        std::sort(out.begin(),out.end());
+        return out;
+    }
+    Stats Store::stats()const{
+        Stats stats;
+        for(const auto& name:names()){
+            std::vector<FileEntry> files;
+            if(!read_manifest(seed_path(name),files)) continue;
+            stats.seeds++;
+            stats.files+=files.size();
+            for(const auto& file:files) stats.logical_bytes+=file.size;
+        }
+        if(!std::filesystem::exists(folder/chunks_name)) return stats;
+        for(const auto& entry:std::filesystem::recursive_directory_iterator(folder/chunks_name)){
+            if(!entry.is_regular_file()) continue;
+            stats.chunks++;
+            stats.stored_bytes+=entry.file_size();
+        }
+        return stats;
+    }
+}
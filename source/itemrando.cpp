@@ -1,414 +1,29 @@
 #include <ds2srand/start.hxx>
 #include "modules/item_rando.hpp"
+#include "modules/output_cache.hpp"
 #include "modules/param_editor.hpp"
+#include "modules/param_writes.hpp"
+#include "modules/plan_file.hpp"
+#include "modules/search.hpp"
+#include "modules/solver.hpp"
+#include "modules/spoiler_log.hpp"
+#include "modules/stages.hpp"
 #include "modules/utils.hpp"
 
-namespace item_rando{
-//This thing is used to place the keys so no softlocks happen
-namespace solver{
-    constexpr size_t max_keys=4;
-    struct Door{
-        uint32_t from,to;
-        uint32_t keys[max_keys];
-    };
-    struct Key{
-        std::string name;
-        uint64_t total_amount;
-    };
-    struct Room{
-        std::string name;
-        uint64_t capacity;
-    };
-
-    struct Graph{
-        uint64_t n_nodes;
-        std::vector<Door> blockades;
-        std::vector<Key> keys;
-        std::vector<Room> rooms;
-    };
-
-    struct InnerConstraint{
-        uint32_t node;
-        uint32_t keys[max_keys];
-    };
-    struct OuterConstraints{
-        std::vector<InnerConstraint> paths;
-    };
-    struct Placement{
-        std::vector<uint64_t> node;
-        uint64_t left;
-    };
-    struct GraphState{
-        std::vector<OuterConstraints> cons;
-        std::vector<Placement> placements;
-    };
-    GraphState generate_state(const Graph& graph){
-        GraphState state;
-        if(graph.n_nodes==0){
-            std::cout<<"WARNING: Graph has 0 nodes\n";
-        }
-        state.cons.resize(graph.n_nodes);
-        for(const auto& block:graph.blockades){
-            if(block.to>=state.cons.size()||block.from>=state.cons.size()){
-                std::cout<<"WARNING: Blockade outside of range, from:"<<block.from<<" to:"<<block.to<<'\n';
-                continue;
-            }
-            auto& node = state.cons[block.to];
-            InnerConstraint inner;
-            inner.node = block.from;
-            for(size_t j = 0;j<max_keys;j++){
-                inner.keys[j]=block.keys[j];
-            }
-            node.paths.push_back(inner);
-        }
-        state.placements.resize(graph.keys.size());
-        for(size_t i = 0;i<graph.keys.size();i++){
-            state.placements[i].left = graph.keys[i].total_amount;
-        }
-        return state;
-    }
-
-    std::vector<size_t> get_valid_nodes(const Graph& graph,const GraphState& state,size_t key_id){
-        Stopwatch clock;
-        std::vector<Door> wait_list;
-        std::vector<Door> active_list;
-        std::vector<bool> valid_nodes;
-        valid_nodes.resize(graph.n_nodes,false);
-        //Mark starting node as valid and expand it
-        valid_nodes[0]=true;
-        for(const auto& b:graph.blockades){
-            if(b.from==0) wait_list.push_back(b);
-        }
-        //std::cout<<"Start algorithm\n";
-        bool done = false;
-        while(!done){
-            active_list=wait_list;
-            wait_list.clear();
-            done=true;
-            while(!active_list.empty()){
-                auto active_block = active_list.back();
-                //std::cout<<"Pop "<<active_block.from<<" "<<active_block.to<<"\n";
-                active_list.pop_back();
-                if(valid_nodes[active_block.to]) continue;
-                bool all_valid = true;
-                bool invalid = false;
-                for(size_t j = 0;j<max_keys;j++){
-                    auto key = active_block.keys[j];
-                    if(key==key_id){
-                        all_valid=false;
-                        invalid = true;
-                        break;
-                    }
-                    auto& key_nodes = state.placements[key].node;
-                    bool repeats=key_nodes.empty();
-                    for(const auto& a :key_nodes){
-                        repeats|=valid_nodes[a];
-                    }
-                    all_valid&=repeats;
-                }
-                if(invalid){
-                    //std::cout<<"Invalid\n";
-                }else if(all_valid){
-                    //std::cout<<"Its valid\n";
-                    valid_nodes[active_block.to]=true;
-                    for(const auto& block:graph.blockades){
-                        if(block.from==active_block.to) active_list.push_back(block);
-                    }
-                    done=false;//Keep iterating
-                }else{
-                    //std::cout<<"Not valid\n";
-                    wait_list.push_back(active_block);
-                }
-            }
-        }
-        std::vector<size_t> compressed_valid;
-        for(size_t i =0;i<valid_nodes.size();i++){
-            if(valid_nodes[i]) compressed_valid.push_back(i);
-        }
-        return compressed_valid;
-
-    }
-
-    //This is a simple solver, and its not part of the randomizer
-    void solve(const Graph& graph,GraphState& state){
-        std::vector<size_t> key_deck;
-        for(size_t i = 1;i<graph.keys.size();i++){//Skip null key
-            key_deck.push_back(i);
-        }
-        std::mt19937_64 generator(34);
-        std::shuffle(key_deck.begin(),key_deck.end(),generator);
-        for(const auto& key_id:key_deck){
-            auto valid_nodes = get_valid_nodes(graph,state,key_id);
-            if(valid_nodes.size()==0){
-                std::cout<<"Can't place, no valid nodes\n";
-            }else{
-                auto random_node = cboyo::random::element(valid_nodes,generator);
-                // for(const auto& possible_node:valid_nodes){
-                //     std::cout<<possible_node<<",";
-                // }
-                //std::cout<<"Placed in node: "<<random_node<<'\n';
-                state.placements[key_id].node.push_back((uint32_t)random_node);
-            }
-        }
-        //std::cout<<"Solved\n";
-    }
-
-    bool check_solution(const Graph& graph,const GraphState& state){
-        size_t left_to_visit = graph.n_nodes-1;
-        std::vector<bool> visited(graph.n_nodes,false);
-        visited[0]=true;
-        std::vector<bool> keys_obtained(graph.keys.size(),false);
-        keys_obtained[0]=true;
-        std::vector<Door> doors;
-        std::vector<Door> stall_doors;
-        for(const auto& a:graph.blockades){
-            if(a.from==0)stall_doors.push_back(a);
-        }
-        for(size_t i = 0;i<state.placements.size();i++){
-            for(const auto& node:state.placements[i].node){
-                if(node==0)keys_obtained[i] = true;
-            }
-        }
-        bool done=false;
-        while(!done){
-            doors=stall_doors;
-            stall_doors.clear();
-            done=true;
-            while(!doors.empty()){
-                auto door = doors.back();
-                doors.pop_back();
-                if(visited[door.to])continue;
-                bool can_open = true;
-                for(size_t j = 0;j<max_keys;j++){
-                    auto key = door.keys[j];
-                    can_open&=keys_obtained[key];
-                }
-                if(can_open){
-                    visited[door.to]=true;
-                    left_to_visit-=1;
-                    if(left_to_visit==0) return true;
-                    for(const auto& block:graph.blockades){
-                        if(block.from==door.to) doors.push_back(block);
-                    }
-                    for(size_t i = 0;i<state.placements.size();i++){
-                        for(const auto& node:state.placements[i].node){
-                            if(node==door.to)keys_obtained[i] = true;
-                        }
-                    }
-                    done=false;//Keep iterating
-                }else{
-                    stall_doors.push_back(door);
-                }
-            }
-        }
-        for(size_t i = 0 ;i<visited.size();i++){
-            if(!visited[i]){
-                std::cout<<"Cant visit: "<<graph.rooms[i].name<<'\n';
-            }
-        }
-        return false;
-
-    }
-
-    void print_solution(const Graph& graph,const GraphState& state){
-        for(size_t i = 1;i<state.placements.size();i++){
-            if(state.placements[i].node.empty()){
-                std::cout<<graph.keys[i].name<<" not placed\n";
-            }else{
-                std::cout<<graph.keys[i].name<<" in ";
-                for(const auto& a:state.placements[i].node){
-                    std::cout<<graph.rooms[a].name;
-                    if(&a!=&state.placements[i].node.back()) std::cout<<',';
-                    else        std::cout<<"\n";
-                }
-            }
-        }
-
-    }
-
-    bool test_graph(const Graph& graph){
-        for(int i = 0;i<1000;i++){
-            auto state = generate_state(graph);
-            solve(graph,state);
-            // print_solution(graph,state);
-            if(!check_solution(graph,state)){
-                std::cout<<"FAILED\n";
-                return false;
-            }
-        }
-        std::cout<<"PASSED\n";
-        return true;
-    }
-
-    size_t room_by_name(const Graph& graph,const std::string& name){
-        for(size_t i = 0;i<graph.rooms.size();i++){
-            if(graph.rooms[i].name==name){
-                return i ;
-            }
-        }
-        std::cout<<"Can't find room with name: "<<name<<'\n';
-        return SIZE_MAX;
-    }
-
-    bool parse_from_file(const std::filesystem::path& file_path,Graph& graph){
-        if(!std::filesystem::exists(file_path)){
-            std::cout<<"File doesn't not exists "<<std::filesystem::absolute(file_path)<<'\n';
-            return false;
-        }
-        std::ifstream file(file_path);
-        if(!file){
-            std::cout<<"Cannot open file: "<<file_path<<'\n';
-            return false;
-        }
-        std::string line;
-        bool keys=false,rooms=false,doors=false;
-        graph.keys.push_back({"NULL",1});
-        while(cboyo::parse::getline(file,line)){
-            std::string_view sview = line;
-            if(sview.front()=='#'){
-                keys = rooms = doors=false;
-                if(sview=="#KEYS") keys=true;
-                else if(sview=="#ROOMS") rooms=true;
-                else if(sview=="#DOORS") doors=true;
-                // std::cout<<keys<<" "<<rooms<<" "<<doors<<"\n";
-            }else if(sview.size()<2){
-                continue;
-            }else{
-                if(keys){
-                    auto tokens = cboyo::parse::split(sview,',');
-                    if(tokens.size()!=2){
-                        std::cout<<"Error reading key: "<<sview<<'\n';
-                    }else{
-                        Key key;
-                        key.name = tokens[0];
-                        cboyo::parse::read_var(tokens[1],key.total_amount);
-                        graph.keys.push_back(std::move(key));
-                    }
-                }else if(rooms){
-                    Room room;
-                    room.name = sview;
-                    room.capacity=99999;
-                    // std::cout<<"Read room: "<<room.name<<"\n";
-                    graph.rooms.push_back(std::move(room));
-                }else if(doors){
-                    auto tokens = cboyo::parse::split(sview,',');
-                    if(tokens.size()!=3){
-                        std::cout<<"Error reading door: "<<sview<<'\n';
-                    }else{
-                        Door door;
-                        door.from = door.to = 999999;
-                        for(size_t i = 0;i<graph.rooms.size();i++){
-                            if(graph.rooms[i].name==tokens[0]){
-                                door.from=(uint32_t)i;
-                            }
-                            if(graph.rooms[i].name==tokens[1]){
-                                door.to=(uint32_t)i;
-                            }
-                        }
-                        if(door.from==999999){
-                            std::cout<<"Error reading door: "<<sview<<" no related room: "<<tokens[0]<<'\n';
-                            return false;
-                        }
-                        if(door.to==999999){
-                            std::cout<<"Error reading door: "<<sview<<" no related room: "<<tokens[1]<<'\n';
-                            return false;
-                        }
-                        if(tokens[2].size()>=2){
-                            tokens[2].remove_prefix(1);
-                            tokens[2].remove_suffix(1);
-                        }
-                        auto key_tokens = cboyo::parse::split(tokens[2],';');
-                        if(key_tokens.size()>max_keys){
-                            std::cout<<"Too many keys, max keys is: "<<max_keys<<" found "<< key_tokens.size()<<"\n";
-                            std::cout<<"Only taking first for from: "<<sview<<'\n';
-                            return false;
-                        }
-                        for(size_t j = 0;j<max_keys;j++){
-                            door.keys[j]=0;//Default to NULL key
-                            if(j<key_tokens.size()){
-                                //std::cout<<"Key "<<j<<" "<<key_tokens[j]<<'\n';
-                                bool found = false;
-                                for(size_t i = 0;i<graph.keys.size();i++){
-                                    if(graph.keys[i].name==key_tokens[j]){
-                                        door.keys[j]=(uint32_t)i;
-                                        found = true;
-                                        break;
-                                    }
-                                }
-                                if(!found){
-                                    std::cout<<"Couldnt match key : "<<key_tokens[j]<<" from: "<<sview<<'\n';
-                                    return false;
-                                }
-                            }
-                        }
-                        graph.blockades.push_back(std::move(door));
-                    }
-                }
-            }
-        }
-        graph.n_nodes = graph.rooms.size();
-        return true;
-    }
-
-    bool solver_test1(){
-        solver::Graph graph;
-        graph.n_nodes=2;
-        graph.blockades.push_back({0u,1u,{1u,0u,0u,0u}});
-        graph.keys.push_back({"Null",0});//Empty for null stuff
-        graph.keys.push_back({"Red key",1});
-        return solver::test_graph(graph);
-    }
-    bool solver_test2(){
-        solver::Graph graph;
-        graph.n_nodes=4;
-        graph.keys.push_back({"Null",0});//Empty for null stuff
-        graph.keys.push_back({"Red key",1});
-        graph.keys.push_back({"Yellow key",1});
-        graph.keys.push_back({"Blue key",1});
-        graph.blockades.push_back({0u,1u,{1u,0u,0u,0u}});
-        graph.blockades.push_back({0u,2u,{2u,0u,0u,0u}});
-        graph.blockades.push_back({0u,3u,{3u,0u,0u,0u}});
-        return solver::test_graph(graph);
-    }
-    bool solver_test3(){
-        solver::Graph graph;
-        graph.n_nodes=5;
-        graph.keys.push_back({"Null",0});//Empty for null stuff
-        graph.keys.push_back({"Red key",1});
-        graph.keys.push_back({"Blue key",1});
-        graph.keys.push_back({"Green key",1});
-        graph.keys.push_back({"Yellow key",1});
-        graph.keys.push_back({"Magenta key",1});
-        graph.blockades.push_back({0u,1u,{5u,0u,0u,0u}});
-        graph.blockades.push_back({1u,4u,{1u,0u,0u,0u}});
-        graph.blockades.push_back({1u,2u,{2u,0u,0u,0u}});
-        graph.blockades.push_back({1u,3u,{4u,0u,0u,0u}});
-        graph.blockades.push_back({2u,3u,{3u,0u,0u,0u}});
-        graph.blockades.push_back({3u,2u,{3u,0u,0u,0u}});
-        return solver::test_graph(graph);
-    }
-    bool parser_test(){
-        solver::Graph graph;
-        if(solver::parse_from_file("build/ParserTest.txt",graph)){
-            auto state = solver::generate_state(graph);
-            solver::solve(graph,state);
-            solver::print_solution(graph,state);
-        }
-        return false;
-    }
-
-
-}
+#include <atomic>
+#include <bit>
 
+namespace item_rando{
 namespace paths{
     const std::filesystem::path configfile = "ir_config.txt";
+    const std::filesystem::path data ="data/item_rando";
     const std::filesystem::path items ="data/item_rando/Items";
     const std::filesystem::path lots ="data/item_rando/ItemLots";
     const std::filesystem::path params ="data/item_rando/Params";
-    const std::filesystem::path out_folder ="Param";
-    const std::filesystem::path cheatsheet_folder ="cheatsheets/items";
     const std::filesystem::path dev_path{"C:\\Program Files (x86)\\Steam\\steamapps\\common\\Dark Souls II Scholar of the First Sin\\Game\\mods\\mod_testing\\Param"};
 }
+//Name the param coordinator knows this module by
+const std::string_view module_name = "items";
 enum class LotType{Shop,Other,Char};
 enum class Infusion:u8{None=0,Fire,Magic,Lightning,Dark,Poison,Bleed,Raw,Enchanted,Mundane};
 enum class InfusionType:s32{None=0,NoElemental,NoPoisonBleed,NoBleed,DarkMagic,DarkLighting,Elemental,All,Basic};
@@ -474,10 +89,99 @@ struct LotData{
     u8 infinite{false};
     u8 reinforcement{0u};
     Infusion infusion{0u};
+    u32 pool_item{UINT32_MAX};//Pool entry this lot took from, if any
+    s32 drawn{0};
 };
 struct Item{
     s32 id;
     s32 quantity;
+    u32 dense{UINT32_MAX};
+};
+//Pooled item entries get a dense index at load, what is left of each one lives in a flat array
+//Placements taking from the pool record the entry and the amount, so the ledger can be checked at the end
+struct ItemPool{
+    std::vector<s32> ids;
+    std::vector<s32> allotted;
+    std::vector<s32> left;
+    std::vector<s32> retired;//Taken out of play without a placement, like keys left in their vanilla lots
+    u32 add(const Item& item){
+        ids.push_back(item.id);
+        allotted.push_back(item.quantity);
+        left.push_back(item.quantity);
+        retired.push_back(0);
+        return (u32)(ids.size()-1);
+    }
+    template<typename T>
+    void take(u32 item,s32 amount,T& record){
+        left[item]-=amount;
+        record.pool_item=item;
+        record.drawn=amount;
+    }
+    void retire(u32 item){
+        retired[item]+=left[item];
+        left[item]=0;
+    }
+};
+struct PoolDraw{
+    u32 item;
+    s32 amount;
+    bool pooled;//Filler consumables don't come from the pool
+};
+//Every lot id known at load gets a small index, so lot sets can be flat arrays
+struct LotIndex{
+    std::unordered_map<s32,u32> index;
+    u32 find(s32 lot)const{
+        auto found = index.find(lot);
+        return found==index.end()?UINT32_MAX:found->second;
+    }
+};
+//Lots of one category, erase swaps with the last lot like vector_find_swap_pop so placement order doesn't change
+struct LotSet{
+    std::vector<s32> lots;
+    std::vector<u32> position;//By lot index
+    std::shared_ptr<const LotIndex> lot_index;
+
+    //Repeated lots are dropped, the first one stays
+    void reindex(std::shared_ptr<const LotIndex> new_index){
+        lot_index = std::move(new_index);
+        position.assign(lot_index->index.size(),UINT32_MAX);
+        auto loaded = std::move(lots);
+        lots.clear();
+        for(const auto& lot:loaded) push_back(lot);
+    }
+    bool contains(s32 lot)const{
+        auto index = lot_index->find(lot);
+        return index!=UINT32_MAX&&position[index]!=UINT32_MAX;
+    }
+    void push_back(s32 lot){
+        auto index = lot_index->find(lot);
+        if(index==UINT32_MAX||position[index]!=UINT32_MAX) return;
+        position[index]=(u32)lots.size();
+        lots.push_back(lot);
+    }
+    bool erase(s32 lot){
+        auto index = lot_index->find(lot);
+        if(index==UINT32_MAX||position[index]==UINT32_MAX) return false;
+        auto at = position[index];
+        position[index]=UINT32_MAX;
+        if(at!=lots.size()-1){
+            lots[at]=lots.back();
+            position[lot_index->find(lots[at])]=at;
+        }
+        lots.pop_back();
+        return true;
+    }
+    void shuffle(std::mt19937_64& generator){
+        std::shuffle(lots.begin(),lots.end(),generator);
+        for(u32 i = 0;i<lots.size();i++){
+            position[lot_index->find(lots[i])]=i;
+        }
+    }
+    size_t size()const{return lots.size();}
+    bool empty()const{return lots.empty();}
+    s32 operator[](size_t i)const{return lots[i];}
+    auto begin()const{return lots.begin();}
+    auto end()const{return lots.end();}
 };
 struct WeaponSpecs{
     s32 id{0};
@@ -531,9 +235,11 @@ struct GameItems{
     std::vector<Item> unused_items;
     std::vector<Item> special_lots;
     std::unordered_map<s32,std::string> names;
+    std::unordered_map<std::string,s32> ids_by_name;
     std::vector<ItemDropQuantity> item_drop_quantity;
     std::vector<size_t> item_drop_index;//This vector is parallel to the consumables one
     std::vector<GearSpecs> gear_specs;
+    ItemPool pool;
 };
 struct ShopSlot{
     s32 lot_id;
@@ -541,6 +247,8 @@ struct ShopSlot{
     float price_mult;
     u8 quantity;
     bool infinite;
+    u32 pool_item{UINT32_MAX};
+    s32 drawn{0};
 };
 struct Shops{
     std::vector<ShopSlot> ornifex_trades;
@@ -549,20 +257,86 @@ struct Shops{
     std::vector<s32> to_remove;
     std::unordered_map<s32,std::string> original_items;
 };
+struct LotRow{
+    s32 row;
+    u32 index;
+    bool operator<(const LotRow& other)const{return row<other.row;}
+};
+//Vanilla params read once at load, every seed copies them and writes its changes on top
+//Lot slots come already cleared, except for lots that must not change
+struct VanillaItemParams{
+    ParamFile<ShopItem> shop;
+    ParamFile<ItemLot> other;
+    ParamFile<ItemLot> chr;
+    ParamFile<PlayerStatus> classes;
+    std::unordered_map<s32,size_t> shop_rows;
+    //Lots that can change, sorted by row
+    std::vector<LotRow> other_rows;
+    std::vector<LotRow> chr_rows;
+};
+//Drangleic.txt compiled once, every seed starts from a copy of state and frontier
+struct KeyGraph{
+    solver::Graph graph;
+    solver::GraphState state;
+    solver::Frontier frontier;
+    std::vector<size_t> key_deck;
+    std::vector<size_t> early_blacksmith_loc;
+    size_t lenigrast_key{SIZE_MAX};
+    //Unmissable lots of room i are room_lots[room_lot_begin[i]..room_lot_begin[i+1]]
+    std::vector<u32> room_lot_begin;
+    std::vector<s32> room_lots;
+};
+//Gear specs split by GearPiece bit and sorted by weight, a query only scans the pieces light enough
+struct GearIndex{
+    struct Bucket{
+        std::vector<u32> gear;//Index into gear_specs
+        std::vector<float> weight;
+        //Highest str, dex, int and fth of the first i+1 pieces, if those are met nothing else needs checking
+        std::vector<std::array<u16,4>> max_requirement;
+    };
+    std::array<Bucket,10> buckets;
+    std::unordered_map<s32,u32> by_id;
+    //Fills valid with the gear_specs indices that fit, in gear_specs order
+    void query(const std::vector<GearSpecs>& specs,GearPiece gear_type,float weight_allowed,const std::array<u16,4>& stats,std::vector<size_t>& valid)const{
+        valid.clear();
+        for(size_t b = 0;b<buckets.size();b++){
+            if(!(gear_type&(GearPiece)(1u<<b))) continue;
+            const auto& bucket = buckets[b];
+            size_t end = std::lower_bound(bucket.weight.begin(),bucket.weight.end(),weight_allowed)-bucket.weight.begin();
+            if(end==0) continue;
+            const auto& max = bucket.max_requirement[end-1];
+            if(max[0]<=stats[0]&&max[1]<=stats[1]&&max[2]<=stats[2]&&max[3]<=stats[3]){
+                valid.insert(valid.end(),bucket.gear.begin(),bucket.gear.begin()+end);
+                continue;
+            }
+            for(size_t i = 0;i<end;i++){
+                const auto& piece = specs[bucket.gear[i]];
+                if(piece.strength<=stats[0]&&piece.dexterity<=stats[1]&&piece.intelligence<=stats[2]&&piece.faith<=stats[3]){
+                    valid.push_back(bucket.gear[i]);
+                }
+            }
+        }
+        std::sort(valid.begin(),valid.end());
+    }
+    const GearSpecs* find(const std::vector<GearSpecs>& specs,s32 id)const{
+        auto found = by_id.find(id);
+        return found==by_id.end()?nullptr:&specs[found->second];
+    }
+};
 struct ItemRandoData{
     std::vector<LotData> lots;
-    std::vector<s32> unmissable_lots;
-    std::vector<s32> missable_lots;
-    std::vector<s32> nochange_lots;
+    LotSet unmissable_lots;
+    LotSet missable_lots;
+    LotSet nochange_lots;
     std::unordered_map<s32,std::string> lot_name_other;
 
     std::vector<SpecialLot> key_lots;
 
     std::vector<LotData> chr_lots;
     std::vector<LotData> enemy_drop_lots;
-    std::vector<s32> chr_remove;
-    std::vector<s32> safe_chr_drop;
-    std::vector<s32> enemy_lots;
+    LotSet chr_remove;
+    LotSet safe_chr_drop;
+    LotSet enemy_lots;
     std::unordered_map<s32,std::string> enemy_names;
     std::unordered_map<s32,std::string> lot_name;
 
@@ -571,7 +345,16 @@ struct ItemRandoData{
     GameItems items;
     Shops shops;
     std::vector<ClassSpecs> classes;
+    //Hash of the vanilla data all of this came from, for cache keys of every run
+    uint64_t data_hash{0u};
+    //Stats take_class_stats put in classes, the cache key needs them since they aren't in the data folder
+    std::string taken_class_stats;
     std::vector<std::vector<Item>> starting_gifts;
+    std::shared_ptr<const KeyGraph> key_graph;
+    std::shared_ptr<const VanillaItemParams> vanilla;
+    std::shared_ptr<const GearIndex> gear_index;
+    //Where this seed's keys went, for the playthrough
+    solver::GraphState key_state;
 };
 
 //Bunch of loading functions should compress some functions
@@ -596,9 +379,9 @@ bool load_equivalents(ItemRandoData& data){
     }
     //Only works well when there are no repeats, which there shouldnt be
     for(const auto& ids:data.equivalents){
-        vector_find_swap_pop(data.unmissable_lots,ids.second);
-        vector_find_swap_pop(data.missable_lots,ids.second);
-        vector_find_swap_pop(data.safe_chr_drop,ids.second);
+        data.unmissable_lots.erase(ids.second);
+        data.missable_lots.erase(ids.second);
+        data.safe_chr_drop.erase(ids.second);
     }
 
     return true;
@@ -622,7 +405,7 @@ bool load_location_lots(ItemRandoData& data){
             for(const auto& t:tokens){
                 s32 value=0;
                 if(cboyo::parse::read_var(t,value)){
-                    if(vector_contains(data.unmissable_lots,value)){
+                    if(data.unmissable_lots.contains(value)){
                         data.location_lots[last_location].push_back(value);
                     }
                 }
@@ -639,7 +422,7 @@ bool load_location_lots(ItemRandoData& data){
         }
         s32 value=0;
         if(cboyo::parse::read_var(tokens.front(),value)){
-            if(vector_contains(data.unmissable_lots,value)){
+            if(data.unmissable_lots.contains(value)){
                 data.location_lots[std::string(tokens[1])].push_back(value);
             }
         }
@@ -657,9 +440,9 @@ bool load_location_lots(ItemRandoData& data){
     return true;
 }
 bool load_lots(ItemRandoData& data){
-    data.missable_lots.reserve(400);
-    data.safe_chr_drop.reserve(600);
-    data.unmissable_lots.reserve(950);
+    data.missable_lots.lots.reserve(400);
+    data.safe_chr_drop.lots.reserve(600);
+    data.unmissable_lots.lots.reserve(950);
     data.lot_name_other.reserve(2048);
     std::filesystem::path chr_lots_path   = paths::lots/"CharacterLots.txt";
     std::filesystem::path other_lots_path = paths::lots/"OtherLots.txt";
@@ -683,11 +466,11 @@ bool load_lots(ItemRandoData& data){
             s32 value=0;
             if(cboyo::parse::read_var(tokens.front(),value)){
                 if(missable){
-                    data.missable_lots.push_back(value);
+                    data.missable_lots.lots.push_back(value);
                 }else if(unmissable){
-                    data.unmissable_lots.push_back(value);
+                    data.unmissable_lots.lots.push_back(value);
                 }else if(nochange){
-                    data.nochange_lots.push_back(value);
+                    data.nochange_lots.lots.push_back(value);
                 }
                 data.lot_name_other[value]=tokens[1];
             }
@@ -716,23 +499,32 @@ bool load_lots(ItemRandoData& data){
                 continue;
             }
             if(chr){
-                data.safe_chr_drop.push_back(value);
+                data.safe_chr_drop.lots.push_back(value);
                 data.lot_name[value]=tokens[1];
             }else if(enemy){
                 s32 enemy_id = value/10000;
                 data.enemy_names[enemy_id]=tokens[1];
-                data.enemy_lots.push_back(value);
+                data.enemy_lots.lots.push_back(value);
             }else if(remove){
-                data.chr_remove.push_back(value);
+                data.chr_remove.lots.push_back(value);
             }else{
                 std::cout<<"No category set: "<<line<<'\n';
             }
 
         }
     }
-    vector_remove_duplicates(data.missable_lots);
-    vector_remove_duplicates(data.unmissable_lots);
-    vector_remove_duplicates(data.safe_chr_drop);
+    vector_remove_duplicates(data.missable_lots.lots);
+    vector_remove_duplicates(data.unmissable_lots.lots);
+    vector_remove_duplicates(data.safe_chr_drop.lots);
+    auto lot_index = std::make_shared<LotIndex>();
+    for(auto* set:{&data.unmissable_lots,&data.missable_lots,&data.nochange_lots,&data.chr_remove,&data.safe_chr_drop,&data.enemy_lots}){
+        for(const auto& lot:set->lots){
+            lot_index->index.emplace(lot,(u32)lot_index->index.size());
+        }
+    }
+    for(auto* set:{&data.unmissable_lots,&data.missable_lots,&data.nochange_lots,&data.chr_remove,&data.safe_chr_drop,&data.enemy_lots}){
+        set->reindex(lot_index);
+    }
     return true;
 }
 bool load_key_lots(ItemRandoData& data){
@@ -838,12 +630,17 @@ bool load_items(GameItems& items){
                 else std::cout<<"Unknown item drop type: "<<tokens[2]<<" in line"<<line<<'\n';
                 items.item_drop_index.push_back(item_drop_type);
                 items.names[item.id]=tokens[3];
+                items.ids_by_name.emplace(tokens[3],item.id);
             }else{
                 items.names[item.id]=tokens[2];
+                items.ids_by_name.emplace(tokens[2],item.id);
             }
             item_ptr->push_back(std::move(item));
         }
     }
+    for(auto* category:{&items.keys,&items.consumables,&items.rings,&items.weapons,&items.spells,&items.armor,&items.special_lots}){
+        for(auto& item:*category) item.dense = items.pool.add(item);
+    }
     return true;
 }
 bool load_weapon_data(GameItems& items){
@@ -1065,6 +862,30 @@ bool load_gear_data(GameItems& items){
     if(!load_ring_data(items))return false;
     return true;
 }
+bool load_gear_index(ItemRandoData& data){
+    auto index = std::make_shared<GearIndex>();
+    const auto& gear = data.items.gear_specs;
+    index->by_id.reserve(gear.size());
+    for(u32 i = 0;i<gear.size();i++){
+        index->by_id.emplace(gear[i].id,i);
+        if(gear[i].id==40510000) continue;//King's Ring is never given to a class
+        auto bit = (u32)std::countr_zero((u32)gear[i].gear_type);
+        if(bit>=index->buckets.size()) continue;//No gear type, never valid
+        index->buckets[bit].gear.push_back(i);
+    }
+    for(auto& bucket:index->buckets){
+        std::stable_sort(bucket.gear.begin(),bucket.gear.end(),[&gear](u32 a,u32 b){return gear[a].weight<gear[b].weight;});
+        std::array<u16,4> max{};
+        for(auto i:bucket.gear){
+            const auto& piece = gear[i];
+            max = {std::max(max[0],piece.strength),std::max(max[1],piece.dexterity),std::max(max[2],piece.intelligence),std::max(max[3],piece.faith)};
+            bucket.weight.push_back(piece.weight);
+            bucket.max_requirement.push_back(max);
+        }
+    }
+    data.gear_index = std::move(index);
+    return true;
+}
 
 std::string generate_config_file(ItemRandoConfig& config){
     std::stringstream ss;
@@ -1087,6 +908,7 @@ std::string generate_config_file(ItemRandoConfig& config){
     ss<<"#EARLY_BLACKSMITH "<<config.early_blacksmith<<'\n';
     ss<<"#CHEATSHEET "<<config.write_cheatsheet<<'\n';
     ss<<"#RANDO_KEYS "<<config.randomize_key_items<<'\n';
+    ss<<"#VERIFY_LEDGER "<<config.verify_ledger<<'\n';
     return ss.str();
 }
 
@@ -1099,8 +921,9 @@ void write_config_file(ItemRandoConfig& config){
         file.close();
     }
 }
-void read_config_file(ItemRandoConfig& config){
-    config.seed=cboyo::random::integer<u64>(0u,999999999999999u,cboyo::random::m_gen);
+void parse_config(std::istream& file,ItemRandoConfig& config);
+void default_config(ItemRandoConfig& config){
+    config.seed=cboyo::random::new_seed();
     config.weight_limit=70u;
     config.unlock_common_shop=false;
     config.unlock_straid_trades=true;
@@ -1119,13 +942,23 @@ void read_config_file(ItemRandoConfig& config){
     config.early_blacksmith=false;
     config.write_cheatsheet=true;
     config.randomize_key_items=true;
+    config.verify_ledger=false;
     config.valid=false;
-
+}
+void read_config(std::istream& file,ItemRandoConfig& config){
+    default_config(config);
+    parse_config(file,config);
+}
+void read_config_file(ItemRandoConfig& config){
+    default_config(config);
     std::ifstream file;
     if(!open_file(file,paths::configfile)){
         std::cout<<"No item rando configuration file found, using default settings\n";
         return;
     }
+    parse_config(file,config);
+}
+void parse_config(std::istream& file,ItemRandoConfig& config){
     std::string line;
     while(cboyo::parse::getline(file,line)){
         std::string_view view = line;
@@ -1158,18 +991,115 @@ void read_config_file(ItemRandoConfig& config){
         else if(command=="#EARLY_BLACKSMITH")  config.early_blacksmith=value1;
         else if(command=="#CHEATSHEET")        config.write_cheatsheet=value1;
         else if(command=="#RANDO_KEYS")        config.randomize_key_items=value1;
+        else if(command=="#VERIFY_LEDGER")     config.verify_ledger=value1;
         else{
             std::cout<<"Unknow option in "<<paths::configfile<<" "<<command<<'\n';
         }
     }
 }
 
+template<typename T>
+bool load_param(ParamFile<T>& param,const std::filesystem::path& path){
+    if(!std::filesystem::exists(path)){
+        std::cout<<"Missing param file: "<<path<<'\n';
+        return false;
+    }
+    param = read_param_file<T>(get_file_contents_binary(path));
+    return true;
+}
+bool load_vanilla_params(ItemRandoData& data){
+    auto vanilla = std::make_shared<VanillaItemParams>();
+    if(!load_param(vanilla->shop,paths::params/"ShopLineupParam.param"))      return false;
+    if(!load_param(vanilla->other,paths::params/"ItemLotParam2_Other.param")) return false;
+    if(!load_param(vanilla->chr,paths::params/"ItemLotParam2_Chr.param"))     return false;
+    if(!load_param(vanilla->classes,paths::params/"PlayerStatusParam.param")) return false;
+    vanilla->shop_rows.reserve(vanilla->shop.data.size());
+    for(size_t i = 0;i<vanilla->shop.data.size();i++){
+        vanilla->shop_rows[(s32)vanilla->shop.row_info[i].row]=i;
+    }
+    auto clear_lots = [&data](ParamFile<ItemLot>& param,std::vector<LotRow>& rows){
+        rows.reserve(param.data.size());
+        for(size_t i = 0;i<param.data.size();i++){
+            s32 row = (s32)param.row_info[i].row;
+            if(data.nochange_lots.contains(row)) continue;//Don't overwrite estus flask
+            rows.push_back({row,(u32)i});
+            auto& lot = param.data[i];
+            std::fill(std::begin(lot.item_id),std::end(lot.item_id),10);
+            std::fill(std::begin(lot.amount),std::end(lot.amount),0u);
+            std::fill(std::begin(lot.chance),std::end(lot.chance),0.f);
+            std::fill(std::begin(lot.infusion),std::end(lot.infusion),0u);
+            std::fill(std::begin(lot.reinforcement),std::end(lot.reinforcement),0u);
+        }
+        std::stable_sort(rows.begin(),rows.end());
+    };
+    clear_lots(vanilla->other,vanilla->other_rows);
+    clear_lots(vanilla->chr,vanilla->chr_rows);
+    data.vanilla = std::move(vanilla);
+    return true;
+}
+bool load_key_graph(ItemRandoData& data){
+    auto key_graph = std::make_shared<KeyGraph>();
+    auto& graph = key_graph->graph;
+    if(!solver::parse_from_file(paths::lots/"Drangleic.txt",graph)){
+        std::cout<<"Failed to parse graph file\n";
+        return false;
+    }
+    //Mistakes in the graph file show up here instead of as seeds that can't be placed
+    if(!solver::report_analysis(graph,solver::analyze(graph))) return false;
+    //A room holds as many keys as it has unmissable lots
+    key_graph->room_lot_begin.push_back(0);
+    for(auto& room:graph.rooms){
+        auto found = data.location_lots.find(room.name);
+        if(found!=data.location_lots.end()){
+            key_graph->room_lots.insert(key_graph->room_lots.end(),found->second.begin(),found->second.end());
+        }
+        room.capacity = key_graph->room_lots.size()-key_graph->room_lot_begin.back();
+        key_graph->room_lot_begin.push_back((u32)key_graph->room_lots.size());
+    }
+    auto& state = key_graph->state;
+    state = solver::generate_state(graph);
+    //Bosses are keys that never move
+    const std::pair<std::string,std::string> static_keys[]={
+        {"Kill Fume Knight","Active Brume Tower"},
+        {"Kill Lost Sinner","Sinner Rise"},
+        {"Kill Iron King","Iron Keep"},
+        {"Kill The Rotten","The Gutter"},
+        {"Kill Freja","Tseldora"},
+        {"Kill Giant Lord","Giant Lord Memory"},
+        {"Kill Vendrick","Undead Crypt"}
+    };
+    for(size_t i = 1;i<graph.keys.size();i++){
+        bool is_static = false;
+        for(const auto& [key,room]:static_keys){
+            if(graph.keys[i].name!=key) continue;
+            auto node = solver::room_by_name(graph,room);
+            if(node==SIZE_MAX) return false;
+            state.placements[i].node.push_back(node);
+            is_static = true;
+            break;
+        }
+        if(!is_static) key_graph->key_deck.push_back(i);
+    }
+    //All of these are always accesible so they are always valid nodes
+    for(const auto& room:{"Things Betwixt","Majula","Heides Tower","Unseen path to Heide","No Mans Warf","Forest Fallen Giants"}){
+        auto node = solver::room_by_name(graph,room);
+        if(node==SIZE_MAX) return false;
+        key_graph->early_blacksmith_loc.push_back(node);
+    }
+    auto lenigrast = graph.key_ids.find("Lenigrast's Key");
+    if(lenigrast!=graph.key_ids.end()) key_graph->lenigrast_key = lenigrast->second;
+    key_graph->frontier = solver::generate_frontier(graph,state);
+    data.key_graph = std::move(key_graph);
+    return true;
+}
+
 bool load_randomizer_data(IRData& irdata){
     std::cout<<"Loading item randomizer data\n";
     Stopwatch clock;
     read_config_file(irdata.config);
-    irdata.data = new ItemRandoData;
+    irdata.data = std::make_unique<ItemRandoData>();
     auto& data = *irdata.data;
+    data.data_hash = output_cache::hash_folder(paths::data);
     if(!load_lots(data))             return false;
     if(!load_equivalents(data))      return false;
     if(!load_location_lots(data))    return false;
@@ -1177,24 +1107,56 @@ bool load_randomizer_data(IRData& irdata){
     if(!load_items(data.items))      return false;
     if(!load_shop_items(data.shops)) return false;
     if(!load_gear_data(data.items))  return false;
+    if(!load_gear_index(data))       return false;
     if(!load_classes(data.classes))  return false;
+    if(!load_vanilla_params(data))   return false;
+    //Runs, search and analyze can want key items the loaded config doesn't, the graph is loaded for them either way
+    if(!load_key_graph(data)&&irdata.config.randomize_key_items) return false;
 
     irdata.config.valid=true;
     auto t = clock.passed();
     std::cout<<"Successful item rando load in: "<<t/1000<<"ms\n";
     return true;
 }
+bool take_class_stats(IRData& irdata,const std::string& classes_param){
+    auto classes = read_param_file<PlayerStatus>(classes_param);
+    if(!irdata.data||classes.header.start_of_data==0) return false;
+    std::string taken;
+    for(auto& mclass:irdata.data->classes){
+        for(size_t i = 0;i<classes.data.size();i++){
+            if(classes.row_info[i].row!=(u64)mclass.id) continue;
+            const auto& stats = classes.data[i];
+            mclass.vigor = stats.vigor;
+            mclass.end   = stats.endurance;
+            mclass.att   = stats.attunement;
+            mclass.vit   = stats.vitality;
+            mclass.str   = stats.strength;
+            mclass.dex   = stats.dexterity;
+            mclass.intll = stats.intelligence;
+            mclass.fth   = stats.faith;
+            mclass.adp   = stats.adaptability;
+        }
+        taken += "#CLASS "+std::to_string(mclass.id);
+        for(auto stat:{mclass.vigor,mclass.end,mclass.att,mclass.vit,mclass.str,mclass.dex,mclass.intll,mclass.fth,mclass.adp}){
+            taken += ' ';
+            taken += std::to_string(stat);
+        }
+        taken += '\n';
+    }
+    irdata.data->taken_class_stats = std::move(taken);
+    return true;
+}
 
 
 //Filling auxiliary functions
-void fill_with_items(std::vector<Item>& item_vector,std::vector<Item*>& out_vector){
-    for(auto& a:item_vector){
-        for(s32 i = 0;i<a.quantity;i++){
-            out_vector.push_back(&a);
+void fill_with_items(const ItemPool& pool,const std::vector<Item>& item_vector,std::vector<u32>& out_vector){
+    for(const auto& a:item_vector){
+        for(s32 i = 0;i<pool.left[a.dense];i++){
+            out_vector.push_back(a.dense);
         }
     }
 }
-void place_enemy_items(ItemRandoData& data,std::vector<s32>& enemies,std::unordered_multimap<s32,s32>& enemy_id_lots,std::vector<Item*>& items){
+void place_enemy_items(ItemRandoData& data,std::vector<s32>& enemies,std::unordered_multimap<s32,s32>& enemy_id_lots,std::vector<u32>& items){
     for(const auto& id:enemies){
         if(items.empty())break;
         auto element = items.back();
@@ -1203,24 +1165,27 @@ void place_enemy_items(ItemRandoData& data,std::vector<s32>& enemies,std::unorde
         lot.amount=1;
         lot.infinite=false;
         lot.chance=5.f;
-        lot.item_id=element->id;
+        lot.item_id=data.items.pool.ids[element];
         auto range = enemy_id_lots.equal_range(id);
+        if(range.first!=range.second) data.items.pool.take(element,1,lot);
         for (auto it = range.first; it != range.second; ++it){
             lot.lot_id=it->second;
             data.enemy_drop_lots.push_back(lot);
+            lot.pool_item=UINT32_MAX;//Other lots of the same enemy are copies
+            lot.drawn=0;
         }
     }
 }
-void place_item_kind(std::vector<Item>& item,std::vector<std::pair<Item*,s32>>& items,float percentage,std::mt19937_64& gen){
-    std::vector<Item*> count;
+void place_item_kind(const ItemPool& pool,std::vector<Item>& item,std::vector<PoolDraw>& items,float percentage,std::mt19937_64& gen){
+    std::vector<u32> count;
     count.reserve(item.size());
     for(auto& a:item){
-        if(a.quantity>0)count.push_back(&a);
+        if(pool.left[a.dense]>0)count.push_back(a.dense);
     }
     std::shuffle(count.begin(),count.end(),gen);
     size_t place_number = static_cast<size_t>(count.size()*percentage);
     for(size_t i =0;i<place_number;i++){
-        items.push_back({count[i],1});
+        items.push_back({count[i],1,true});
     }
 }
 
@@ -1251,6 +1216,7 @@ void remove_key_items(ItemRandoData& data, [[maybe_unused]] ItemRandoConfig& con
         for(size_t i = 0;i<keys.size();i++){
             if(key==keys[i].id){
                 //std::cout<<"removed: "<<key<<" "<<keys[i].quantity<<'\n';
+                data.items.pool.retire(keys[i].dense);
                 vector_remove_index(keys,i);
                 removed=true;
                 last_key_removed=key;
@@ -1275,8 +1241,8 @@ void remove_key_items(ItemRandoData& data, [[maybe_unused]] ItemRandoConfig& con
                 }
             }
         }else if(lot.type==LotType::Other){
-            if(vector_find_swap_pop(data.unmissable_lots,lot.id))    removed=true;
-            else if(vector_find_swap_pop(data.missable_lots,lot.id)) removed=true;
+            if(data.unmissable_lots.erase(lot.id))    removed=true;
+            else if(data.missable_lots.erase(lot.id)) removed=true;
             if(removed){
                 LotData lot_data;
                 lot_data.amount  =lot.amount;
@@ -1287,9 +1253,9 @@ void remove_key_items(ItemRandoData& data, [[maybe_unused]] ItemRandoConfig& con
                 data.lots.push_back(lot_data);
             }
         }else if(lot.type==LotType::Char){
-            if(vector_find_swap_pop(data.safe_chr_drop,lot.id))   removed=true;
-            else if(vector_find_swap_pop(data.enemy_lots,lot.id)) removed=true;
-            else if(vector_find_swap_pop(data.chr_remove,lot.id)) removed=true;
+            if(data.safe_chr_drop.erase(lot.id))   removed=true;
+            else if(data.enemy_lots.erase(lot.id)) removed=true;
+            else if(data.chr_remove.erase(lot.id)) removed=true;
             if(removed){
                 LotData lot_data;
                 lot_data.amount  =lot.amount;
@@ -1302,98 +1268,81 @@ void remove_key_items(ItemRandoData& data, [[maybe_unused]] ItemRandoConfig& con
         }
     }
 }
-bool place_graph_key_items(ItemRandoData& lots,ItemRandoConfig& config){
-    solver::Graph graph;
-    if(!solver::parse_from_file(paths::lots/"Drangleic.txt",graph)){
-        std::cout<<"Failed to parse graph file\n";
+//Key item decisions of a seed, every random draw happens here so they can be checked without touching the lots
+struct KeyPlacement{
+    size_t key_id;
+    size_t node;
+    s32 item_id;
+    s32 lot_id;
+};
+struct KeyPlan{
+    solver::GraphState state;
+    std::vector<KeyPlacement> placements;
+};
+bool plan_key_items(const ItemRandoData& lots,const ItemRandoConfig& config,KeyPlan& plan){
+    if(!lots.key_graph){
+        std::cout<<"Key item graph is not loaded\n";
         return false;
     }
+    const auto& graph = lots.key_graph->graph;
     std::mt19937_64 generator(config.seed);
-    auto state = solver::generate_state(graph);
-    std::vector<size_t> key_deck;
-    for(size_t i = 1;i<graph.keys.size();i++){//Set static keys
-        auto key = graph.keys[i].name;
-        if(key=="Kill Fume Knight"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"Active Brume Tower"));
-        }else if(key=="Kill Lost Sinner"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"Sinner Rise"));
-        }else if(key=="Kill Iron King"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"Iron Keep"));
-        }else if(key=="Kill The Rotten"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"The Gutter"));
-        }else if(key=="Kill Freja"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"Tseldora"));
-        }else if(key=="Kill Giant Lord"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"Giant Lord Memory"));
-        }else if(key=="Kill Vendrick"){
-            state.placements[i].node.push_back(solver::room_by_name(graph,"Undead Crypt"));
-        }else{
-            key_deck.push_back(i);
-        }
-    }
-    //All of these are always accesible so they are always valid nodes
-    std::vector<size_t> early_blacksmith_loc={
-        solver::room_by_name(graph,"Things Betwixt"),
-        solver::room_by_name(graph,"Majula"),
-        solver::room_by_name(graph,"Heides Tower"),
-        solver::room_by_name(graph,"Unseen path to Heide"),
-        solver::room_by_name(graph,"No Mans Warf"),
-        solver::room_by_name(graph,"Forest Fallen Giants")
-    };
+    auto& state = plan.state;
+    state = lots.key_graph->state;
+    auto frontier = lots.key_graph->frontier;
+    auto key_deck = lots.key_graph->key_deck;
+    //Lots left in room i are room_lots[room_lot_begin[i]..room_lot_begin[i]+state.capacity_left[i]]
+    auto room_lots = lots.key_graph->room_lots;
     std::shuffle(key_deck.begin(),key_deck.end(),generator);
     for(const auto& key_id:key_deck){
         std::vector<size_t> valid_nodes;
-        if(config.early_blacksmith&&graph.keys[key_id].name=="Lenigrast's Key"){
-            valid_nodes = early_blacksmith_loc;
+        if(config.early_blacksmith&&key_id==lots.key_graph->lenigrast_key){
+            valid_nodes = lots.key_graph->early_blacksmith_loc;
         }else{
-            valid_nodes = get_valid_nodes(graph,state,key_id);
+            valid_nodes = get_valid_nodes(graph,state,frontier,key_id);
         }
         if(valid_nodes.size()==0){
             std::cout<<"Can't place, no valid nodes\n";
             return false;
         }
-        auto name = graph.keys[key_id].name;
-        s32 item_id = 0;
-        for(const auto& [entry_id,entry_name]:lots.items.names){
-            if(entry_name==name){
-                item_id = entry_id;
-                for(size_t j = 0;j<lots.items.keys.size();j++){
-                    if(lots.items.keys[j].id==item_id){
-                        lots.items.keys.erase(lots.items.keys.begin()+j);
-                        break;
-                    }
-                }
-                break;
-            }
-        }
-        if(!item_id){
+        const auto& name = graph.keys[key_id].name;
+        auto found_id = lots.items.ids_by_name.find(name);
+        if(found_id==lots.items.ids_by_name.end()){
             std::cout<<"Cant find key: "<<name<<'\n';
             return false;
         }
-        s32 lot_id = 0;
-        size_t placing_node = 0;
-        while(true){
-            placing_node = cboyo::random::element(valid_nodes,generator);
-            auto& room_lots = lots.location_lots[graph.rooms[placing_node].name];
-            if(!room_lots.empty()){
-                lot_id = cboyo::random::element(room_lots,generator);
-                if(!vector_find_swap_pop(room_lots,lot_id)){
-                    std::cout<<"Waht?\n";
-                }
-                if(!vector_find_swap_pop(lots.unmissable_lots,lot_id)){
-                    std::cout<<"Cant remove item, not found: "<<lot_id<<'\n';
-                }
-                break;
-            }else{
-                vector_find_swap_pop(valid_nodes,placing_node);
-                if(valid_nodes.empty()){
-                    std::cout<<"No space for item: "<<name<<'\n';
-                    return false;
-                }
-            }
+        s32 item_id = found_id->second;
+        //Every free lot of the valid rooms is equally likely
+        auto slot = solver::pick_slot(state,valid_nodes,generator);
+        if(slot.room==SIZE_MAX){
+            std::cout<<"No space for item: "<<name<<'\n';
+            return false;
         }
+        auto placing_node = slot.room;
+        std::span<s32> lots_left(room_lots.data()+lots.key_graph->room_lot_begin[placing_node],state.capacity_left[placing_node]);
+        s32 lot_id = lots_left[slot.index];
+        lots_left[slot.index] = lots_left.back();
+        plan.placements.push_back({key_id,placing_node,item_id,lot_id});
+        solver::place_key(graph,state,frontier,key_id,placing_node);
+    }
+    //solver::print_solution(graph,state);
+    if(!check_solution(graph,state)){
+        std::cout<<"ERROR: INVALID SOLUTION\n";
+        return false;
+    }
+    return true;
+}
+bool place_graph_key_items(ItemRandoData& lots,ItemRandoConfig& config){
+    KeyPlan plan;
+    if(!plan_key_items(lots,config,plan)) return false;
+    lots.key_state = plan.state;
+    std::unordered_map<s32,std::vector<size_t>> placed_keys;//Item id to the lots placing it
+    for(const auto& placement:plan.placements){
+        if(!lots.unmissable_lots.erase(placement.lot_id)){
+            std::cout<<"Cant remove item, not found: "<<placement.lot_id<<'\n';
+        }
+        placed_keys[placement.item_id].push_back(lots.lots.size());
         LotData ld;
-        ld.item_id =item_id;
+        ld.item_id =placement.item_id;
         if(ld.item_id==60537000){//Branches
             ld.amount=25u;
         }else if(ld.item_id==60536000){//Pharros
@@ -1403,36 +1352,41 @@ bool place_graph_key_items(ItemRandoData& lots,ItemRandoConfig& config){
         }
 
         ld.chance  =100.f;
-        ld.lot_id  =lot_id;
+        ld.lot_id  =placement.lot_id;
         ld.infinite=1u;
         lots.lots.push_back(std::move(ld));
-        state.placements[key_id].node.push_back((uint32_t)placing_node);
-    }
-    //solver::print_solution(graph,state);
-    if(!check_solution(graph,state)){
-        std::cout<<"ERROR: INVALID SOLUTION\n";
-        return false;
     }
+    //Placed keys leave the pool, only the first copy of each one like before
+    std::erase_if(lots.items.keys,[&placed_keys,&lots](const Item& key){
+        auto found = placed_keys.find(key.id);
+        if(found==placed_keys.end()||found->second.empty()) return false;
+        auto& pool = lots.items.pool;
+        pool.take(key.dense,pool.left[key.dense],lots.lots[found->second.back()]);
+        found->second.pop_back();
+        return true;
+    });
     return true;
-
 }
 bool place_rest_keys(ItemRandoData& lots,ItemRandoConfig& config){
     std::mt19937_64 generator(config.seed);
+    auto& pool = lots.items.pool;
     for(const auto& key:lots.items.keys){
-        for(s32 i =0;i<key.quantity;i++){
+        auto copies = pool.left[key.dense];
+        for(s32 i =0;i<copies;i++){
             if(lots.unmissable_lots.empty()){
                 std::cout<<"No more unmissable lots to place keys\n";
                 return false;
             }
-            auto lot_id = cboyo::random::element(lots.unmissable_lots,generator);
+            auto lot_id = cboyo::random::element(lots.unmissable_lots.lots,generator);
             LotData ld;
             ld.amount  =1u;
             ld.chance  =100.f;
             ld.lot_id  =lot_id;
             ld.item_id =key.id;
             ld.infinite=1u;
+            pool.take(key.dense,1,ld);
             lots.lots.push_back(std::move(ld));
-            vector_find_swap_pop(lots.unmissable_lots,lot_id);
+            lots.unmissable_lots.erase(lot_id);
         }
     }
     return true;
@@ -1445,17 +1399,18 @@ void place_shop_items(ItemRandoData& lots,ItemRandoConfig& config){
     // std::cout<<"Rings:"<<lots.items.rings.size()<<'\n';
     // std::cout<<"Spells:"<<lots.items.spells.size()<<'\n';
     // std::cout<<"Armor:"<<lots.items.armor.size()<<'\n';
-    std::vector<Item*> wars;//Weapon,armor,rings,spells
-    fill_with_items(lots.items.weapons,wars);
-    fill_with_items(lots.items.armor,wars);
-    fill_with_items(lots.items.rings,wars);
-    fill_with_items(lots.items.spells,wars);
+    auto& pool = lots.items.pool;
+    std::vector<u32> wars;//Weapon,armor,rings,spells
+    fill_with_items(pool,lots.items.weapons,wars);
+    fill_with_items(pool,lots.items.armor,wars);
+    fill_with_items(pool,lots.items.rings,wars);
+    fill_with_items(pool,lots.items.spells,wars);
     std::shuffle(wars.begin(),wars.end(),generator);
     for(auto& a:shops.straid_trades){
         if(wars.empty()) break;
         auto element = wars.back();
-        a.item_id=element->id;
-        element->quantity-=1;
+        a.item_id=pool.ids[element];
+        pool.take(element,1,a);
         a.quantity=255u;
         a.infinite=true;
         a.price_mult=cboyo::random::real(0.5f,1.5f,generator);
@@ -1464,8 +1419,8 @@ void place_shop_items(ItemRandoData& lots,ItemRandoConfig& config){
     for(auto& a:shops.ornifex_trades){
         if(wars.empty()) break;
         auto element = wars.back();
-        a.item_id=element->id;
-        element->quantity-=1;
+        a.item_id=pool.ids[element];
+        pool.take(element,1,a);
         a.quantity=255u;
         a.infinite=true;
         a.price_mult=cboyo::random::real(0.5f,1.5f,generator);
@@ -1477,6 +1432,8 @@ void place_shop_items(ItemRandoData& lots,ItemRandoConfig& config){
         ShopSlot free_version = trade;
         free_version.price_mult=0.f;
         free_version.lot_id+=1000;//This is how they are arranged
+        free_version.pool_item=UINT32_MAX;
+        free_version.drawn=0;
         shops.ornifex_trades.push_back(free_version);
     }
     std::vector<size_t> shop_index(shops.common.size());
@@ -1505,8 +1462,8 @@ void place_shop_items(ItemRandoData& lots,ItemRandoConfig& config){
         shop_index.pop_back();
         auto element = wars.back();
         wars.pop_back();
-        slot.item_id=element->id;
-        element->quantity-=1;
+        slot.item_id=pool.ids[element];
+        pool.take(element,1,slot);
         slot.infinite=false;
         slot.quantity=1;
         slot.price_mult = cboyo::random::real(0.5f,1.5f,generator);
@@ -1562,11 +1519,12 @@ void place_shop_items(ItemRandoData& lots,ItemRandoConfig& config){
 void place_dyna_tillo_items(ItemRandoData& lots,ItemRandoConfig& config){
     s32 initial_lot_id = 50000000;
     std::mt19937_64 generator(config.seed);
-    std::vector<Item*> wars;//Weapon,armor,rings,spells
-    fill_with_items(lots.items.weapons,wars);
-    fill_with_items(lots.items.armor,wars);
-    fill_with_items(lots.items.rings,wars);
-    fill_with_items(lots.items.spells,wars);
+    auto& pool = lots.items.pool;
+    std::vector<u32> wars;//Weapon,armor,rings,spells
+    fill_with_items(pool,lots.items.weapons,wars);
+    fill_with_items(pool,lots.items.armor,wars);
+    fill_with_items(pool,lots.items.rings,wars);
+    fill_with_items(pool,lots.items.spells,wars);
     std::shuffle(wars.begin(),wars.end(),generator);
 
     //All 4 items have 4 drop categories
@@ -1575,15 +1533,17 @@ void place_dyna_tillo_items(ItemRandoData& lots,ItemRandoConfig& config){
     //All 4 categories use the same items but different chance
     for(s32 i = 0;i<4;i++){
         s32 items_ids[10];
+        u32 pool_items[10];
+        std::fill(std::begin(pool_items),std::end(pool_items),UINT32_MAX);
         items_ids[0]=cboyo::random::element(lots.items.consumables,generator).id;
         items_ids[1]=cboyo::random::element(lots.items.consumables,generator).id;
         items_ids[2]=cboyo::random::element(lots.items.consumables,generator).id;
         items_ids[3]=cboyo::random::element(lots.items.consumables,generator).id;
         for(size_t j = 4;j<10;j++){
             if(wars.empty())break;
-            auto ptr = cboyo::random::element(wars,generator);
-            items_ids[j] = ptr->id;
-            ptr->quantity-=1;
+            auto item = cboyo::random::element(wars,generator);
+            items_ids[j] = pool.ids[item];
+            pool_items[j] = item;
         }
         LotData lot;
         lot.amount=1;
@@ -1593,7 +1553,11 @@ void place_dyna_tillo_items(ItemRandoData& lots,ItemRandoConfig& config){
             for(s32 j = 0;j<400;j+=100){
                 lot.chance=cboyo::random::real(0.5f,3.f,generator);
                 lot.lot_id=initial_lot_id+i+j;
+                //Only the first drop category takes from the pool, the others are the same item
+                if(j==0&&pool_items[h]!=UINT32_MAX) pool.take(pool_items[h],1,lot);
                 lots.lots.push_back(lot);
+                lot.pool_item=UINT32_MAX;
+                lot.drawn=0;
             }
         }
     }
@@ -1613,50 +1577,51 @@ void place_items(ItemRandoData& data,ItemRandoConfig& config){
     for(const auto& unmissable:data.unmissable_lots){
         data.missable_lots.push_back(unmissable);
     }
-    //Use pointer to real item so we can keep track of which items have already been placed
-    std::vector<std::pair<Item*,s32>> cc;
+    //Use the pool entry so we can keep track of which items have already been placed
+    auto& pool = items.pool;
+    std::vector<PoolDraw> cc;
     cc.reserve(3000);//Ballpark
     for(size_t i=0;i<items.consumables.size();i++){
         auto& mitem = items.consumables[i];
         auto& possible_quantities = items.item_drop_quantity[items.item_drop_index[i]];
-        s32 remaining = mitem.quantity;
+        s32 remaining = pool.left[mitem.dense];
         while(remaining>0){
             s32 quantity = cboyo::random::element(possible_quantities,generator);
             quantity = std::min(remaining,quantity);
             remaining-=quantity;
-            cc.push_back({&mitem,quantity});
+            cc.push_back({mitem.dense,quantity,true});
         }
     }
     //TODO CHANGE FOR SPECIAL DROPS
     for(auto& a:items.special_lots){
-        cc.push_back({&a,a.quantity});
+        cc.push_back({a.dense,pool.left[a.dense],true});
     }
-    place_item_kind(items.rings,cc,0.9f,generator);
-    place_item_kind(items.spells,cc,0.9f,generator);
-    place_item_kind(items.armor,cc,0.8f,generator);
-    place_item_kind(items.weapons,cc,0.7f,generator);
+    place_item_kind(pool,items.rings,cc,0.9f,generator);
+    place_item_kind(pool,items.spells,cc,0.9f,generator);
+    place_item_kind(pool,items.armor,cc,0.8f,generator);
+    place_item_kind(pool,items.weapons,cc,0.7f,generator);
 
     //@CAUTION NEED TO MAKE SURE THERE ARE ENOUGH ITEMS TO PUT IN EVERY LOT
     auto lots_to_fill = data.missable_lots.size()+data.safe_chr_drop.size();
     while(lots_to_fill>cc.size()){
         auto& random_item = cboyo::random::element(items.consumables,generator);
-        cc.push_back({&random_item,1});
+        cc.push_back({random_item.dense,1,false});
     }
 
     std::shuffle(cc.begin(),cc.end(),generator);
-    std::shuffle(data.missable_lots.begin(),data.missable_lots.end(),generator);
-    std::shuffle(data.safe_chr_drop.begin(),data.safe_chr_drop.end(),generator);
+    data.missable_lots.shuffle(generator);
+    data.safe_chr_drop.shuffle(generator);
     while(!cc.empty()){
         for(size_t i = 0;i<data.missable_lots.size();i++){
             if(cc.empty()) break;
             auto element = cc.back();
             cc.pop_back();
-            element.first->quantity-=element.second;
             LotData lot;
-            lot.amount=static_cast<u8>(element.second);
+            lot.amount=static_cast<u8>(element.amount);
             lot.chance=100.f;
             lot.infinite=true;
-            lot.item_id=element.first->id;
+            lot.item_id=pool.ids[element.item];
+            if(element.pooled) pool.take(element.item,element.amount,lot);
             lot.lot_id=data.missable_lots[i];
             data.lots.push_back(std::move(lot));
         }
@@ -1664,12 +1629,12 @@ void place_items(ItemRandoData& data,ItemRandoConfig& config){
             if(cc.empty()) break;
             auto element = cc.back();
             cc.pop_back();
-            element.first->quantity-=element.second;
             LotData lot;
-            lot.amount=static_cast<u8>(element.second);
+            lot.amount=static_cast<u8>(element.amount);
             lot.chance=100.f;
             lot.infinite=false;
-            lot.item_id=element.first->id;
+            lot.item_id=pool.ids[element.item];
+            if(element.pooled) pool.take(element.item,element.amount,lot);
             lot.lot_id=data.safe_chr_drop[i];
             data.chr_lots.push_back(std::move(lot));
         }
@@ -1678,17 +1643,18 @@ void place_items(ItemRandoData& data,ItemRandoConfig& config){
 void place_enemy_drops(ItemRandoData& data,ItemRandoConfig& config){
     std::mt19937_64 generator(config.seed);
     //Kind of a mess
-    std::vector<Item*> rings;
-    fill_with_items(data.items.rings,rings);
+    const auto& pool = data.items.pool;
+    std::vector<u32> rings;
+    fill_with_items(pool,data.items.rings,rings);
     std::shuffle(rings.begin(),rings.end(),generator);
-    std::vector<Item*> spells;
-    fill_with_items(data.items.spells,spells);
+    std::vector<u32> spells;
+    fill_with_items(pool,data.items.spells,spells);
     std::shuffle(spells.begin(),spells.end(),generator);
-    std::vector<Item*> armor;
-    fill_with_items(data.items.armor,armor);
+    std::vector<u32> armor;
+    fill_with_items(pool,data.items.armor,armor);
     std::shuffle(armor.begin(),armor.end(),generator);
-    std::vector<Item*> weapons;
-    fill_with_items(data.items.weapons,weapons);
+    std::vector<u32> weapons;
+    fill_with_items(pool,data.items.weapons,weapons);
     std::shuffle(weapons.begin(),weapons.end(),generator);
 
     std::vector<s32> enemies;
@@ -1696,11 +1662,11 @@ void place_enemy_drops(ItemRandoData& data,ItemRandoConfig& config){
     enemies.reserve(data.enemy_names.size());
     for(const auto& [id,name]:data.enemy_names){
         enemies.push_back(id);
-        for(const auto& lot_id:data.enemy_lots){
-            s32 enemy_id = lot_id/10000;
-            if(id==enemy_id){
-                enemy_id_lots.insert({id,lot_id});
-            }
+    }
+    for(const auto& lot_id:data.enemy_lots){
+        s32 enemy_id = lot_id/10000;
+        if(data.enemy_names.contains(enemy_id)){
+            enemy_id_lots.insert({enemy_id,lot_id});
         }
     }
     //Place armaments
@@ -1724,6 +1690,43 @@ void place_enemy_drops(ItemRandoData& data,ItemRandoConfig& config){
         }
     }
 }
+//Every pool entry must end with placed, retired and left adding up to what it had at load
+bool check_item_ledger(const ItemRandoData& data){
+    const auto& pool = data.items.pool;
+    std::vector<s32> placed(pool.ids.size(),0);
+    size_t bad_records = 0;
+    auto count = [&placed,&bad_records](const auto& records){
+        for(const auto& record:records){
+            if(record.pool_item==UINT32_MAX) continue;
+            if(record.pool_item>=placed.size()){
+                bad_records++;
+                continue;
+            }
+            placed[record.pool_item]+=record.drawn;
+        }
+    };
+    count(data.lots);
+    count(data.chr_lots);
+    count(data.enemy_drop_lots);
+    count(data.shops.straid_trades);
+    count(data.shops.ornifex_trades);
+    count(data.shops.common);
+    size_t overdrawn = 0,mismatched = 0;
+    s32 first_overdrawn = 0,first_mismatched = 0;
+    int64_t total_placed = 0,total_retired = 0,total_left = 0;
+    for(size_t i = 0;i<pool.ids.size();i++){
+        if(pool.left[i]<0&&overdrawn++==0) first_overdrawn = pool.ids[i];
+        if(placed[i]+pool.retired[i]+pool.left[i]!=pool.allotted[i]&&mismatched++==0) first_mismatched = pool.ids[i];
+        total_placed+=placed[i];
+        total_retired+=pool.retired[i];
+        total_left+=std::max(pool.left[i],0);
+    }
+    std::cout<<"Item ledger: "<<pool.ids.size()<<" entries, "<<total_placed<<" placed, "<<total_retired<<" retired, "<<total_left<<" left in pool\n";
+    if(bad_records) std::cout<<"LEDGER ERROR: "<<bad_records<<" placements point outside the item pool\n";
+    if(overdrawn) std::cout<<"LEDGER ERROR: "<<overdrawn<<" items placed more times than allotted, first: "<<first_overdrawn<<'\n';
+    if(mismatched) std::cout<<"LEDGER ERROR: "<<mismatched<<" items don't add up to their allotment, first: "<<first_mismatched<<'\n';
+    return bad_records==0&&overdrawn==0&&mismatched==0;
+}
 void randomize_weapon_infusion(ItemRandoData& data,ItemRandoConfig& config){
     const std::vector<Infusion> dark_lightin{Infusion::Dark,Infusion::Lightning};
     const std::vector<Infusion> dark_magic{Infusion::Dark,Infusion::Magic};
@@ -1735,16 +1738,9 @@ void randomize_weapon_infusion(ItemRandoData& data,ItemRandoConfig& config){
     std::mt19937_64 generator(config.seed);
     auto change_weapon=[&](LotData& lot){
         if(lot.item_id<1000000||lot.item_id>11850000) return;
-        s32 weapon_id = lot.item_id;
-        size_t index = SIZE_MAX;
-        for(size_t i = 0;i<data.items.gear_specs.size();i++){
-            if(weapon_id==data.items.gear_specs[i].id){
-                index=i;
-                break;
-            }
-        }
-        if(index==SIZE_MAX) return;
-        auto& weapon_specs = data.items.gear_specs[index];
+        auto found = data.gear_index->find(data.items.gear_specs,lot.item_id);
+        if(!found) return;
+        auto& weapon_specs = *found;
         auto roll = cboyo::random::integer(0,999,generator);
         if(weapon_specs.max_reinforce_lvl>5){//Weapons that go to +10
                  if(roll>990) lot.reinforcement=4;
@@ -1777,32 +1773,14 @@ void randomize_weapon_infusion(ItemRandoData& data,ItemRandoConfig& config){
 }
 void randomize_classes(ItemRandoData& data,ItemRandoConfig& config){
     auto& classes = data.classes;
-    auto& gear = data.items.gear_specs;
-    //Remove King's Ring from item pool
-    //40510000 -> King's Ring id
-    for(size_t i = 0;i<gear.size();i++){
-        if(gear[i].id==40510000){
-            vector_remove_index(gear,i);
-            break;
-        }
-    }
+    const auto& gear = data.items.gear_specs;
+    const auto& gear_index = *data.gear_index;//King's Ring is left out of the index
     enum class Equipment{Head,Chest,Hand,Feet,RHand,LHand,Spell,Ring};
     std::vector<Equipment> equipment{Equipment::Head,Equipment::Chest,Equipment::Hand,Equipment::Feet,Equipment::RHand,Equipment::LHand,Equipment::Spell,Equipment::Ring};
     std::mt19937_64 generator(config.seed);
     std::vector<size_t> valid_index;
-    auto valid_gear=[&generator,&gear,&valid_index](GearPiece gear_type,ClassSpecs& specs,s32& gear_piece){
-        valid_index.clear();
-        float weight_allowed = specs.max_weight-specs.weight;
-        for(size_t i =0;i<gear.size();i++){
-            auto& piece = gear[i];
-            bool w   = piece.weight<weight_allowed;
-            bool str = specs.str>=piece.strength;
-            bool dex = specs.dex>=piece.dexterity;
-            bool fth = specs.fth>=piece.faith;
-            bool intll = specs.intll>=piece.intelligence;
-            bool valid_piece = gear_type&piece.gear_type;
-            if(valid_piece&&str&&dex&&intll&&fth&&w) valid_index.push_back(i);
-        }
+    auto valid_gear=[&generator,&gear,&gear_index,&valid_index](GearPiece gear_type,ClassSpecs& specs,s32& gear_piece){
+        gear_index.query(gear,gear_type,specs.max_weight-specs.weight,{specs.str,specs.dex,specs.intll,specs.fth},valid_index);
         if(!valid_index.empty()){
             auto& piece = gear[cboyo::random::element(valid_index,generator)];
             gear_piece=piece.id;
@@ -1922,33 +1900,73 @@ void randomize_starting_gifts(ItemRandoData& data,ItemRandoConfig& config){
 }
 
 //Writing stuff
-struct IdCount{size_t index;int count=0;};
-void write_lots(ParamFile<ItemLot>& param,std::unordered_map<s32,IdCount>& id_to_index_count,std::vector<LotData>& lots){
-    for(const auto& a:lots){
-        auto ref = id_to_index_count.find((u32)a.lot_id);
-        if(ref==id_to_index_count.end()){
-            std::cout<<"WARNING: Unknown item lot:"<<a.lot_id<<". Ignoring this lot\n";
+//Stable LSD radix sort on the upper 32 bits, the lower bits keep their order
+void radix_sort_high(std::vector<u64>& keys){
+    std::vector<u64> buffer(keys.size());
+    for(u32 shift = 32;shift<64;shift+=8){
+        std::array<size_t,257> start{};
+        for(const auto& key:keys) start[((key>>shift)&0xFF)+1]++;
+        if(std::find(start.begin(),start.end(),keys.size())!=start.end()) continue;//Everything in one bucket
+        for(size_t i = 1;i<start.size();i++) start[i]+=start[i-1];
+        for(const auto& key:keys) buffer[start[(key>>shift)&0xFF]++]=key;
+        keys.swap(buffer);
+    }
+}
+//Placements sorted by lot id and merged with the sorted rows in one pass, placement order is kept inside a lot
+void write_lots(ParamFile<ItemLot>& param,const std::vector<LotRow>& rows,const std::vector<const std::vector<LotData>*>& sources,std::string_view name){
+    std::vector<const LotData*> placements;
+    for(const auto* source:sources){
+        for(const auto& lot:*source) placements.push_back(&lot);
+    }
+    //Sign bit flipped so negative lot ids sort before positive ones, as the signed rows are
+    std::vector<u64> keys(placements.size());
+    for(size_t i = 0;i<placements.size();i++){
+        keys[i]=((u64)((u32)placements[i]->lot_id^0x80000000u)<<32)|i;
+    }
+    radix_sort_high(keys);
+    size_t unknown = 0,overflow = 0;
+    s32 first_unknown = 0,first_overflow = 0;
+    size_t row = 0;
+    u8 used = 0;
+    for(const auto& key:keys){
+        const auto& a = *placements[key&0xFFFFFFFFu];
+        auto lot_id = (s32)((u32)(key>>32)^0x80000000u);
+        if(row<rows.size()&&rows[row].row<lot_id){
+            while(row<rows.size()&&rows[row].row<lot_id) row++;
+            used = 0;
+        }
+        if(row==rows.size()||rows[row].row!=lot_id){
+            if(unknown++==0) first_unknown = lot_id;
             continue;//Unknown item lot?
         }
-        IdCount& index_count = ref->second;
-        if(index_count.count==10){
-            std::cout<<"WARNING: Item overflow, lot:"<<a.lot_id<<" has more than 10 items. Ignoring new items\n";
+        if(used==10){
+            if(overflow++==0) first_overflow = lot_id;
             continue;//Item overflow
         }
-        auto& lot = param.data[index_count.index];
-        auto j = index_count.count;
+        auto& lot = param.data[rows[row].index];
+        auto j = used++;
         lot.amount[j] = a.amount;
         lot.chance[j] = a.chance;
         lot.item_id[j] = a.item_id;
         lot.infinite[j] = a.infinite;
         lot.infusion[j] = (u8)a.infusion;
         lot.reinforcement[j] = a.reinforcement;
-        index_count.count+=1;
+    }
+    if(unknown){
+        std::cout<<"WARNING: "<<name<<": "<<unknown<<" items in unknown lots were ignored, first lot: "<<first_unknown<<'\n';
+    }
+    if(overflow){
+        std::cout<<"WARNING: "<<name<<": "<<overflow<<" items did not fit in lots with more than 10 items, first lot: "<<first_overflow<<'\n';
     }
 }
-void write_shop_lots(ParamFile<ShopItem>& shop_data,std::unordered_map<s32,size_t>& id_to_index,const std::vector<ShopSlot>& slots,bool enable_all){
+void write_shop_lots(ParamFile<ShopItem>& shop_data,const std::unordered_map<s32,size_t>& id_to_index,const std::vector<ShopSlot>& slots,bool enable_all){
     for(const auto& a:slots){
-        auto& lot = shop_data.data[id_to_index[a.lot_id]];
+        auto found = id_to_index.find(a.lot_id);
+        if(found==id_to_index.end()){
+            std::cout<<"WARNING: Unknown shop lot:"<<a.lot_id<<". Ignoring this lot\n";
+            continue;
+        }
+        auto& lot = shop_data.data[found->second];
         lot.quantity=a.quantity;
         if(a.infinite) lot.quantity=255;
         lot.item_id=a.item_id;
@@ -1957,31 +1975,165 @@ void write_shop_lots(ParamFile<ShopItem>& shop_data,std::unordered_map<s32,size_
         if(enable_all) lot.enable_flag=-1;
     }
 }
-void write_item_params(ItemRandoData& rando_data,ItemRandoConfig& config,bool devmode){
-    const std::string chr_param = "ItemLotParam2_Chr.param";
-    const std::string shop_param = "ShopLineupParam.param";
+//Everything the params need from a seed, the lots keep their order so the params come out the same
+struct ItemPlan{
+    ItemRandoConfig config;
+    std::vector<LotData> lots;
+    std::vector<LotData> chr_lots;
+    std::vector<LotData> enemy_drop_lots;
+    std::vector<ShopSlot> common;
+    std::vector<ShopSlot> straid_trades;
+    std::vector<ShopSlot> ornifex_trades;
+    std::vector<s32> shop_removed;
+    std::vector<ClassSpecs> classes;
+    std::vector<std::vector<Item>> gifts;
+};
+ItemPlan make_item_plan(const ItemRandoData& data,const ItemRandoConfig& config){
+    ItemPlan plan;
+    plan.config = config;
+    plan.lots = data.lots;
+    plan.chr_lots = data.chr_lots;
+    plan.enemy_drop_lots = data.enemy_drop_lots;
+    plan.common = data.shops.common;
+    plan.straid_trades = data.shops.straid_trades;
+    plan.ornifex_trades = data.shops.ornifex_trades;
+    plan.shop_removed = data.shops.to_remove;
+    plan.classes = data.classes;
+    plan.gifts = data.starting_gifts;
+    return plan;
+}
+//Plan files keep the item config as text in "ICFG" and the decisions in "ITEM"
+std::string encode_item_plan(const ItemPlan& plan){
+    plan_file::Writer out;
+    auto lots = [&out](const std::vector<LotData>& lots){
+        out.u(lots.size());
+        int64_t previous = 0;
+        for(const auto& lot:lots){
+            out.s((int64_t)lot.lot_id-previous);//Lots are placed mostly in order, deltas stay small
+            previous = (int64_t)lot.lot_id;
+            out.s(lot.item_id);
+            out.f(lot.chance);
+            out.u(lot.amount);
+            out.u(lot.infinite);
+            out.u(lot.reinforcement);
+            out.u((u8)lot.infusion);
+        }
+    };
+    auto slots = [&out](const std::vector<ShopSlot>& slots){
+        out.u(slots.size());
+        for(const auto& slot:slots){
+            out.s(slot.lot_id);
+            out.s(slot.item_id);
+            out.f(slot.price_mult);
+            out.u(slot.quantity);
+            out.u(slot.infinite);
+        }
+    };
+    lots(plan.lots);
+    lots(plan.chr_lots);
+    lots(plan.enemy_drop_lots);
+    slots(plan.common);
+    slots(plan.straid_trades);
+    slots(plan.ornifex_trades);
+    out.u(plan.shop_removed.size());
+    for(const auto& lot:plan.shop_removed) out.s(lot);
+    out.u(plan.classes.size());
+    for(const auto& mclass:plan.classes){
+        out.s(mclass.id);
+        for(auto stat:{mclass.vigor,mclass.end,mclass.att,mclass.vit,mclass.str,mclass.dex,mclass.intll,mclass.fth,mclass.adp}) out.u(stat);
+        const auto& gear = mclass.gear;
+        for(auto id:{gear.head,gear.chest,gear.arms,gear.legs,gear.right_hand,gear.left_hand,gear.ring,gear.spell,gear.extra_arrow,gear.extra_bolt}) out.s(id);
+    }
+    out.u(plan.gifts.size());
+    for(const auto& gifts:plan.gifts){
+        out.u(gifts.size());
+        for(const auto& gift:gifts){
+            out.s(gift.id);
+            out.s(gift.quantity);
+        }
+    }
+    return out.data;
+}
+bool decode_item_plan(std::string_view data,ItemPlan& plan){
+    plan_file::Reader in{data};
+    auto lots = [&in](std::vector<LotData>& lots){
+        lots.resize(std::min<u64>(in.u(),in.data.size()));
+        int64_t previous = 0;
+        for(auto& lot:lots){
+            previous+=in.s();
+            lot.lot_id = (u64)previous;
+            lot.item_id = (s32)in.s();
+            lot.chance = in.f();
+            lot.amount = (u8)in.u();
+            lot.infinite = (u8)in.u();
+            lot.reinforcement = (u8)in.u();
+            lot.infusion = (Infusion)in.u();
+        }
+    };
+    auto slots = [&in](std::vector<ShopSlot>& slots){
+        slots.resize(std::min<u64>(in.u(),in.data.size()));
+        for(auto& slot:slots){
+            slot.lot_id = (s32)in.s();
+            slot.item_id = (s32)in.s();
+            slot.price_mult = in.f();
+            slot.quantity = (u8)in.u();
+            slot.infinite = in.u()!=0;
+        }
+    };
+    lots(plan.lots);
+    lots(plan.chr_lots);
+    lots(plan.enemy_drop_lots);
+    slots(plan.common);
+    slots(plan.straid_trades);
+    slots(plan.ornifex_trades);
+    plan.shop_removed.resize(std::min<u64>(in.u(),in.data.size()));
+    for(auto& lot:plan.shop_removed) lot = (s32)in.s();
+    plan.classes.resize(std::min<u64>(in.u(),in.data.size()));
+    for(auto& mclass:plan.classes){
+        mclass.id = (s32)in.s();
+        for(auto* stat:{&mclass.vigor,&mclass.end,&mclass.att,&mclass.vit,&mclass.str,&mclass.dex,&mclass.intll,&mclass.fth,&mclass.adp}) *stat = (u16)in.u();
+        auto& gear = mclass.gear;
+        for(auto* id:{&gear.head,&gear.chest,&gear.arms,&gear.legs,&gear.right_hand,&gear.left_hand,&gear.ring,&gear.spell,&gear.extra_arrow,&gear.extra_bolt}) *id = (s32)in.s();
+    }
+    plan.gifts.resize(std::min<u64>(in.u(),in.data.size()));
+    for(auto& gifts:plan.gifts){
+        gifts.resize(std::min<u64>(in.u(),in.data.size()));
+        for(auto& gift:gifts){
+            gift.id = (s32)in.s();
+            gift.quantity = (s32)in.s();
+        }
+    }
+    if(!in.ok||!in.done()){
+        std::cout<<"Item plan is damaged\n";
+        return false;
+    }
+    return true;
+}
+struct ItemParams{
+    ParamFile<ShopItem> shop;
+    ParamFile<ItemLot> other;
+    ParamFile<ItemLot> chr;
+    ParamFile<PlayerStatus> classes;
+};
+//Applies a plan on top of the vanilla params
+ItemParams materialize_items(const ItemRandoData& rando_data,const ItemPlan& plan){
     const std::string other_param = "ItemLotParam2_Other.param";
-    const std::string classes_param = "PlayerStatusParam.param";
-
-    std::filesystem::path chr_path     = paths::params/chr_param;
-    std::filesystem::path shop_path    = paths::params/shop_param;
-    std::filesystem::path other_path   = paths::params/other_param;
-    std::filesystem::path classes_path = paths::params/classes_param;
-
-    ParamFile<ShopItem> shop_data = read_param_file<ShopItem>(get_file_contents_binary(shop_path));
-    std::unordered_map<s32,size_t> id_to_index;
-    id_to_index.reserve(shop_data.data.size());
-    for(size_t i = 0;i<shop_data.data.size();i++){
-        id_to_index[(u32)shop_data.row_info[i].row]=i;
-    }
-    write_shop_lots(shop_data,id_to_index,rando_data.shops.common,config.unlock_common_shop);
-    write_shop_lots(shop_data,id_to_index,rando_data.shops.straid_trades,config.unlock_straid_trades);
-    write_shop_lots(shop_data,id_to_index,rando_data.shops.ornifex_trades,config.unlock_ornifex_trades);
-    for(const auto& a:rando_data.shops.to_remove){
-        auto& lot = shop_data.data[id_to_index[a]];
-        lot.enable_flag=1;//Items won't show up with this
-    }
-    if(config.melentia_lifegems){
+    const std::string chr_param = "ItemLotParam2_Chr.param";
+    const auto& vanilla = *rando_data.vanilla;
+    ItemParams params;
+
+    auto& shop_data = params.shop;
+    shop_data = vanilla.shop;
+    const auto& id_to_index = vanilla.shop_rows;
+    write_shop_lots(shop_data,id_to_index,plan.common,plan.config.unlock_common_shop);
+    write_shop_lots(shop_data,id_to_index,plan.straid_trades,plan.config.unlock_straid_trades);
+    write_shop_lots(shop_data,id_to_index,plan.ornifex_trades,plan.config.unlock_ornifex_trades);
+    for(const auto& a:plan.shop_removed){
+        auto found = id_to_index.find(a);
+        if(found==id_to_index.end()) continue;
+        shop_data.data[found->second].enable_flag=1;//Items won't show up with this
+    }
+    if(plan.config.melentia_lifegems){
         ShopItem item;
         item.item_id=60010000;
         item.unk=500;
@@ -1998,56 +2150,32 @@ void write_item_params(ItemRandoData& rando_data,ItemRandoConfig& config,bool de
             std::cout<<"Failed to add Melentia infinite lifegems\n";
         }
     }
-    ParamFile<ItemLot> other = read_param_file<ItemLot>(get_file_contents_binary(other_path));
-    std::unordered_map<s32,IdCount> id_to_index_count;
-    id_to_index_count.reserve(other.data.size());
-
-    for(size_t i = 0;i<other.data.size();i++){
-        auto row = other.row_info[i].row;
-        if(vector_contains(rando_data.nochange_lots,(s32)row)) continue;//Don't overwrite estus flask
-        id_to_index_count[(u32)row]={i,0};
-        auto& lot = other.data[i];
-        for(size_t j = 0;j<10;j++){
-            lot.item_id[j]=10;
-            lot.amount[j]=0u;
-            lot.chance[j]=0.f;
-            lot.infusion[j]=0;
-            lot.reinforcement[j]=0;
-        }
-    }
-    write_lots(other,id_to_index_count,rando_data.lots);
+    auto& other = params.other;
+    other = vanilla.other;
+    write_lots(other,vanilla.other_rows,{&plan.lots},other_param);
+    auto find_row = [](const std::vector<LotRow>& rows,s32 row){
+        auto found = std::lower_bound(rows.begin(),rows.end(),LotRow{row,0});
+        return (found!=rows.end()&&found->row==row)?found->index:UINT32_MAX;
+    };
     for(const auto& a:rando_data.equivalents){
-        auto original_index = id_to_index_count[a.first].index;
-        auto copy_index = id_to_index_count[a.second].index;
-        other.data[copy_index]=other.data[original_index];
+        auto original = find_row(vanilla.other_rows,a.first);
+        auto copy = find_row(vanilla.other_rows,a.second);
+        if(original==UINT32_MAX||copy==UINT32_MAX) continue;
+        other.data[copy]=other.data[original];
     }
 
-    ParamFile<ItemLot> chr = read_param_file<ItemLot>(get_file_contents_binary(chr_path));
-    id_to_index_count.clear();
-    id_to_index_count.reserve(chr.data.size());
-    for(size_t i = 0;i<chr.data.size();i++){
-        s32 row = chr.row_info[i].row;
-        if(vector_contains(rando_data.nochange_lots,row)) continue;//Don't overwrite estus flask
-        id_to_index_count[(u32)chr.row_info[i].row]={i,0};
-        auto& lot = chr.data[i];
-        for(size_t j = 0;j<10;j++){
-            lot.item_id[j]=10;
-            lot.amount[j]=0u;
-            lot.chance[j]=0.f;
-            lot.infusion[j]=0;
-            lot.reinforcement[j]=0;
-        }
-    }
-    write_lots(chr,id_to_index_count,rando_data.chr_lots);
-    write_lots(chr,id_to_index_count,rando_data.enemy_drop_lots);
+    auto& chr = params.chr;
+    chr = vanilla.chr;
+    write_lots(chr,vanilla.chr_rows,{&plan.chr_lots,&plan.enemy_drop_lots},chr_param);
 
 
-    ParamFile<PlayerStatus> classes = read_param_file<PlayerStatus>(get_file_contents_binary(classes_path));
-    if(config.randomize_classes){
+    auto& classes = params.classes;
+    classes = vanilla.classes;
+    if(plan.config.randomize_classes){
         for(size_t i =0;i<classes.data.size();i++){
             auto row   = classes.row_info[i].row;
             auto& data = classes.data[i];
-            for(const auto& mclass:rando_data.classes){
+            for(const auto& mclass:plan.classes){
                 assert( mclass.id >= 0 );
                 if(static_cast< unsigned >(mclass.id)==row){
                     data.soul_level  = mclass.vigor+mclass.end+mclass.vit+mclass.att+mclass.str+mclass.dex+mclass.adp+mclass.intll+mclass.fth-53;
@@ -2095,13 +2223,14 @@ void write_item_params(ItemRandoData& rando_data,ItemRandoConfig& config,bool de
             }
         }
     }
-    if(config.randomize_gifts){
+    if(plan.config.randomize_gifts){
         for(size_t i =0;i<classes.data.size();i++){
             auto row   = classes.row_info[i].row;
             auto& data = classes.data[i];
             if(row>=510&&row<=570){
                 size_t gift_index = (row-510)/10;
-                auto& gifts = rando_data.starting_gifts[gift_index];
+                if(gift_index>=plan.gifts.size()) continue;
+                const auto& gifts = plan.gifts[gift_index];
                 data.ring_id[0]=-1;//Remove the life ring from that one lot
                 for(size_t j=0;j<10;j++){
                     if(j<gifts.size()){
@@ -2116,22 +2245,62 @@ void write_item_params(ItemRandoData& rando_data,ItemRandoConfig& config,bool de
         }
     }
 
-    if(!std::filesystem::exists(paths::out_folder)){
-        std::filesystem::create_directories(paths::out_folder);
+    return params;
+}
+//Every param file of the run by name, player classes are edited by the start module too so they are never linked
+std::vector<output_cache::Contents> item_param_files(ItemParams& params){
+    return {
+        {"ShopLineupParam.param",write_param_file(params.shop),true},
+        {"ItemLotParam2_Chr.param",write_param_file(params.chr),true},
+        {"ItemLotParam2_Other.param",write_param_file(params.other),true},
+        {"PlayerStatusParam.param",write_param_file(params.classes),false}
+    };
+}
+//Player classes go in as the vanilla file and the rows this run changed, so the start module's stats can go on top
+void submit_item_param(param_writes::Coordinator& writes,const ItemRandoData& data,const std::string& name,std::string contents){
+    if(name!="PlayerStatusParam.param"){
+        writes.submit_file(module_name,name,std::move(contents));
+        return;
+    }
+    auto vanilla = data.vanilla->classes;
+    auto base = write_param_file(vanilla);
+    std::vector<param_writes::Edit> edits;
+    if(!param_writes::diff(base,contents,edits)){
+        writes.submit_file(module_name,name,std::move(contents));
+        return;
+    }
+    writes.submit_file(module_name,name,std::move(base));
+    writes.submit_edits(module_name,name,std::move(edits));
+}
+//Returns the files for the cache, with a coordinator they are handed to it and written when it commits
+std::vector<output_cache::Contents> write_item_params(const ItemRandoData& data,ItemParams params,const std::filesystem::path& out_folder,bool devmode,param_writes::Coordinator* writes){
+    auto files = item_param_files(params);
+    if(writes){
+        for(const auto& file:files) submit_item_param(*writes,data,file.name,file.data);
+    }else{
+        if(!std::filesystem::exists(out_folder)){
+            std::filesystem::create_directories(out_folder);
+        }
+        for(const auto& file:files) write_to_file_binary(out_folder/file.name,file.data);
     }
-    write_to_file_binary(paths::out_folder/shop_param,write_param_file(shop_data));
-    write_to_file_binary(paths::out_folder/chr_param,write_param_file(chr));
-    write_to_file_binary(paths::out_folder/other_param,write_param_file(other));
-    write_to_file_binary(paths::out_folder/classes_param,write_param_file(classes));
     if(devmode){
-        std::filesystem::path dev_path{"C:\\Program Files (x86)\\Steam\\steamapps\\common\\Dark Souls II Scholar of the First Sin\\Game\\mods\\mod_testing\\Param"};
-        write_to_file_binary(dev_path/shop_param,write_param_file(shop_data));
-        write_to_file_binary(dev_path/chr_param,write_param_file(chr));
-        write_to_file_binary(dev_path/other_param,write_param_file(other));
-        write_to_file_binary(dev_path/classes_param,write_param_file(classes));
+        for(const auto& file:files) write_to_file_binary(paths::dev_path/file.name,file.data);
     }
+    return files;
 }
-void write_cheatsheet(ItemRandoData& data,ItemRandoConfig& config){
+//Cached params go to the coordinator when the run has one, otherwise straight to the out folder
+bool serve_cached(const ItemRandoData& data,output_cache::Cache& cache,const std::string& key,const Run& run){
+    if(!run.writes) return cache.serve(key,run.out_folder);
+    std::vector<output_cache::File> files;
+    if(!cache.lookup(key,files)) return false;
+    for(const auto& file:files){
+        auto name = file.path.filename().string();
+        if(file.link) run.writes->submit_link(module_name,name,file.path);
+        else submit_item_param(*run.writes,data,name,get_file_contents_binary(file.path));
+    }
+    return true;
+}
+void write_cheatsheet(ItemRandoData& data,ItemRandoConfig& config,const std::filesystem::path& folder){
     std::stringstream ss;
     ss<<"---CONFIGURATION FILE---\n";
     ss<<generate_config_file(config);
@@ -2177,6 +2346,12 @@ void write_cheatsheet(ItemRandoData& data,ItemRandoConfig& config){
     // for(const auto& [id,name] : data.enemy_names){
     //     std::cout<<id<<" "<<name<<'\n';
     // }
+    if(data.key_graph&&!data.key_state.placements.empty()){
+        const auto& graph = data.key_graph->graph;
+        ss<<"\n\n---KEY ITEM SPHERES---\n";
+        solver::print_playthrough(graph,data.key_state,solver::playthrough(graph,data.key_state),ss);
+        ss<<"\n\n";
+    }
     std::unordered_map<u64,u8> enemy_used;
     enemy_used.reserve(512);
     for(const auto& lot:data.enemy_drop_lots){
@@ -2190,23 +2365,126 @@ void write_cheatsheet(ItemRandoData& data,ItemRandoConfig& config){
         }
     }
 
-    if(!std::filesystem::exists(paths::cheatsheet_folder)){
-        std::filesystem::create_directories(paths::cheatsheet_folder);
+    if(!std::filesystem::exists(folder)){
+        std::filesystem::create_directories(folder);
     }
-    auto path = paths::cheatsheet_folder/("items"+time_string_now()+".txt");
+    auto path = folder/("items"+time_string_now()+"_"+std::to_string(config.seed)+".txt");
     std::ofstream out_file(path);
     if(out_file) out_file<<ss.str();
     else std::cout<<"Cannot write cheatsheet: "<<path<<'\n';
     out_file.close();
 }
 
-bool add_item_shop(s32 item_id,bool devmode){
+//lots, enemy_drops, shops, classes and gifts sections of the spoiler log, names come from the loaded data
+void write_item_spoiler(const ItemRandoData& data,const ItemPlan& plan,spoiler_log::Writer& log){
+    auto text = [](const std::unordered_map<s32,std::string>& names,s32 id)->std::string_view{
+        auto found = names.find(id);
+        return found==names.end()?std::string_view{}:std::string_view{found->second};
+    };
+    auto item = [&](s32 item_id){
+        log.field("item",item_id);
+        log.field("name",text(data.items.names,item_id));
+    };
+    log.field("item_seed",plan.config.seed);
+    log.section("lots");
+    for(const auto& lot:plan.lots){
+        log.begin_record();
+        log.field("lot",lot.lot_id);
+        item(lot.item_id);
+        log.field("amount",lot.amount);
+        if(lot.lot_id>=50000000&&lot.lot_id<=50000303){
+            auto kind = lot.lot_id%1000;
+            if(kind<100) log.field("location","Dyna & Tillo Small Smooth and Silky Stone drop");
+            else if(kind<200) log.field("location","Dyna & Tillo Smooth and Silky Stone drop");
+            else if(kind<300) log.field("location","Dyna & Tillo Petrified Something drop");
+            else log.field("location","Dyna & Tillo Prism Stone drop");
+        }else{
+            log.field("location",text(data.lot_name_other,(s32)lot.lot_id));
+        }
+        log.end_record();
+    }
+    for(const auto& lot:plan.chr_lots){
+        log.begin_record();
+        log.field("lot",lot.lot_id);
+        item(lot.item_id);
+        log.field("amount",lot.amount);
+        log.field("location",text(data.lot_name,(s32)lot.lot_id));
+        log.field("character",true);
+        log.end_record();
+    }
+    log.section("enemy_drops");
+    for(const auto& lot:plan.enemy_drop_lots){
+        auto enemy = (s32)(lot.lot_id/10000u);
+        log.begin_record();
+        log.field("lot",lot.lot_id);
+        log.field("enemy",enemy);
+        log.field("enemy_name",text(data.enemy_names,enemy));
+        item(lot.item_id);
+        log.field("amount",lot.amount);
+        log.field("chance",(double)lot.chance);
+        log.end_record();
+    }
+    log.section("shops");
+    auto shop = [&](const char* vendor,const std::vector<ShopSlot>& slots){
+        for(const auto& slot:slots){
+            log.begin_record();
+            log.field("shop",vendor);
+            log.field("lot",slot.lot_id);
+            item(slot.item_id);
+            log.field("quantity",slot.quantity);
+            log.field("infinite",slot.infinite);
+            log.field("price_mult",(double)slot.price_mult);
+            log.field("replaces",text(data.shops.original_items,slot.lot_id));
+            log.end_record();
+        }
+    };
+    shop("Straid",plan.straid_trades);
+    shop("Ornifex",plan.ornifex_trades);
+    shop("common",plan.common);
+    log.section("classes");
+    for(const auto& specs:plan.classes){
+        log.begin_record();
+        log.field("class",specs.id);
+        log.field("name",specs.name);
+        log.field("vigor",specs.vigor);
+        log.field("endurance",specs.end);
+        log.field("vitality",specs.vit);
+        log.field("attunement",specs.att);
+        log.field("strength",specs.str);
+        log.field("dexterity",specs.dex);
+        log.field("adaptability",specs.adp);
+        log.field("intelligence",specs.intll);
+        log.field("faith",specs.fth);
+        const auto& gear = specs.gear;
+        std::pair<const char*,s32> pieces[]{{"head",gear.head},{"chest",gear.chest},{"arms",gear.arms},{"legs",gear.legs},
+            {"right_hand",gear.right_hand},{"left_hand",gear.left_hand},{"ring",gear.ring},{"spell",gear.spell},
+            {"arrows",gear.extra_arrow},{"bolts",gear.extra_bolt}};
+        for(const auto& [piece,id]:pieces){
+            if(id==-1) continue;
+            log.field(piece,id);
+            log.field(std::string(piece)+"_name",text(data.items.names,id));
+        }
+        log.end_record();
+    }
+    log.section("gifts");
+    for(size_t i = 0;i<plan.gifts.size();i++){
+        for(const auto& gift:plan.gifts[i]){
+            log.begin_record();
+            log.field("gift",i);
+            item(gift.id);
+            log.field("quantity",gift.quantity);
+            log.end_record();
+        }
+    }
+}
+
+bool add_item_shop(s32 item_id,const Run& run,bool devmode){
     if(item_id==0){
         std::cout<<"Invalid item ID\n";
         return false;
     }
     //In this case is we need to get the output param as it will need to change the already modified file
-    std::filesystem::path shop_path = paths::out_folder/"ShopLineupParam.param";
+    std::filesystem::path shop_path = run.out_folder/"ShopLineupParam.param";
     if(devmode){
         shop_path = paths::dev_path/"ShopLineupParam.param";
     }
@@ -2234,55 +2512,131 @@ bool add_item_shop(s32 item_id,bool devmode){
     return false;
 }
 
-bool randomize_items(IRData& irdata,bool devmode){
+//Plan phase, every decision ends up in data
+bool run_item_stages(ItemRandoData& data,ItemRandoConfig& config,size_t threads){
+    //Every stage seeds its own generator, so running them at the same time gives the same result
+    //Lot placement shares the item pool and the lot sets so it stays a chain, classes and gifts don't touch lots
+    stages::Scheduler scheduler;
+    auto keys = scheduler.add("keys",[&](){
+        if(!config.randomize_key_items){
+            remove_key_items(data,config);
+            return true;
+        }
+        if(!place_graph_key_items(data,config)){
+            std::cout<<"Failed to place key items\n";
+            return false;
+        }
+        return true;
+    });
+    auto rest_keys = scheduler.add("rest keys",[&](){
+        if(!place_rest_keys(data,config)){
+            std::cout<<"Failed to place key items\n";
+            return false;
+        }
+        return true;
+    },{keys});
+    auto shop = scheduler.add("shop",[&](){place_shop_items(data,config);return true;},{rest_keys});
+    auto dyna_tillo = scheduler.add("dyna and tillo",[&](){place_dyna_tillo_items(data,config);return true;},{shop});
+    auto items = scheduler.add("items",[&](){place_items(data,config);return true;},{dyna_tillo});
+    auto enemy_drops = scheduler.add("enemy drops",[&](){place_enemy_drops(data,config);return true;},{items});
+    auto infusion = scheduler.add("infusion",[&](){
+        if(config.infuse_weapons) randomize_weapon_infusion(data,config);
+        return true;
+    },{items});
+    scheduler.add("ledger",[&](){
+        if(config.verify_ledger) check_item_ledger(data);
+        return true;
+    },{enemy_drops,infusion});
+    scheduler.add("classes",[&](){
+        if(config.randomize_classes) randomize_classes(data,config);
+        return true;
+    });
+    scheduler.add("gifts",[&](){
+        if(config.randomize_gifts) randomize_starting_gifts(data,config);
+        return true;
+    });
+    return scheduler.run(threads);
+}
+bool randomize_items(const IRData& irdata,const Run& run,bool devmode){
     Stopwatch clock;
-    auto& config = irdata.config;
-    if(!config.valid){
+    auto config = run.config;
+    auto cache = run.cache;
+    auto spoiler = run.spoiler;
+    if(!irdata.config.valid||!config.valid){
         std::cout<<"Item loading went wrong, item randomizer skipped\n";
         return false;
     }
+    std::string cache_key;
+    if(cache&&!devmode){
+        cache_key = output_cache::make_key("items",generate_config_file(config)+irdata.data->taken_class_stats,config.seed,irdata.data->data_hash);
+        //The cache only keeps params, a cheatsheet or spoiler log needs the seed made again
+        if(!config.write_cheatsheet&&!spoiler&&serve_cached(*irdata.data,*cache,cache_key,run)){
+            std::cout<<"Item params of seed "<<config.seed<<" taken from the cache\n";
+            return true;
+        }
+    }
     //Makes a copy of data so there is no need to reload eveything after a new randomization during same session
     //This makes a copy of more things than needed but its fast enough so I dont care
     auto data = *irdata.data;
-    if(config.randomize_key_items){
-        if(!place_graph_key_items(data,config)){
-            std::cout<<"Failed to place key items\n";
-            return false;
-        }
-    }else{
-        remove_key_items(data,config);
-    }
-    if(!place_rest_keys(data,config)){
-        std::cout<<"Failed to place key items\n";
-        return false;
-    }
-    place_shop_items(data,config);
-    place_dyna_tillo_items(data,config);
-    place_items(data,config);
-    place_enemy_drops(data,config);
-    if(config.infuse_weapons) randomize_weapon_infusion(data,config);
-    if(config.randomize_classes) randomize_classes(data,config);
-    if(config.randomize_gifts) randomize_starting_gifts(data,config);
-    write_item_params(data,config,devmode);
+    if(!run_item_stages(data,config,run.stage_threads)) return false;
+    auto plan = make_item_plan(data,config);
+    if(spoiler) write_item_spoiler(*irdata.data,plan,*spoiler);
+    auto files = write_item_params(data,materialize_items(data,plan),run.out_folder,devmode,run.writes);
+    if(!cache_key.empty()) cache->store(cache_key,files);
     if(config.write_cheatsheet){
-        write_cheatsheet(data,config);
+        write_cheatsheet(data,config,run.cheatsheet_folder);
     }
     auto t = clock.passed();
     std::cout<<"Randomized items in "<<t/1000<<"ms\n";
     return true;
 }
-bool restore_default_params(){
+bool save_item_plan(const IRData& irdata,const std::string& path,const Run& run){
+    auto config = run.config;
+    if(!irdata.config.valid||!config.valid){
+        std::cout<<"Item loading went wrong, item plan not saved\n";
+        return false;
+    }
+    auto data = *irdata.data;
+    if(!run_item_stages(data,config,run.stage_threads)) return false;
+    auto plan = encode_item_plan(make_item_plan(data,config));
+    if(!plan_file::save(path,{{"ICFG",generate_config_file(config)},{"ITEM",plan}})) return false;
+    std::cout<<"Saved item plan of seed "<<config.seed<<" to "<<path<<", "<<plan.size()<<" bytes\n";
+    return true;
+}
+bool materialize_item_plan(const IRData& irdata,const std::string& path,const Run& run,bool devmode){
+    if(!irdata.config.valid){
+        std::cout<<"Item loading went wrong, item plan not materialized\n";
+        return false;
+    }
+    std::vector<plan_file::Section> sections;
+    if(!plan_file::load(path,sections)) return false;
+    auto config_text = plan_file::find(sections,"ICFG");
+    auto decisions = plan_file::find(sections,"ITEM");
+    if(!config_text||!decisions){
+        std::cout<<"No item plan in "<<path<<'\n';
+        return false;
+    }
+    ItemPlan plan;
+    std::istringstream config_stream(config_text->data);
+    plan.config = irdata.config;//Anything the plan doesn't mention keeps the current value
+    parse_config(config_stream,plan.config);
+    if(!decode_item_plan(decisions->data,plan)) return false;
+    if(run.spoiler) write_item_spoiler(*irdata.data,plan,*run.spoiler);
+    write_item_params(*irdata.data,materialize_items(*irdata.data,plan),run.out_folder,devmode,run.writes);
+    std::cout<<"Materialized item plan of seed "<<plan.config.seed<<'\n';
+    return true;
+}
+bool restore_default_params(const Run& run){
     const std::string chr_param = "ItemLotParam2_Chr.param";
     const std::string shop_param = "ShopLineupParam.param";
     const std::string other_param = "ItemLotParam2_Other.param";
     const std::string classes_param = "PlayerStatusParam.param";
     //Cppref wasnt clear if this thing returns false or throws when it fails so idk
     try{
-        auto ow = std::filesystem::copy_options::overwrite_existing;
-        std::filesystem::copy_file(paths::params/chr_param,paths::out_folder/chr_param,ow);
-        std::filesystem::copy_file(paths::params/shop_param,paths::out_folder/shop_param,ow);
-        std::filesystem::copy_file(paths::params/other_param,paths::out_folder/other_param,ow);
-        std::filesystem::copy_file(paths::params/classes_param,paths::out_folder/classes_param,ow);
+        copy_file_replacing(paths::params/chr_param,run.out_folder/chr_param);
+        copy_file_replacing(paths::params/shop_param,run.out_folder/shop_param);
+        copy_file_replacing(paths::params/other_param,run.out_folder/other_param);
+        copy_file_replacing(paths::params/classes_param,run.out_folder/classes_param);
     }catch (std::filesystem::filesystem_error& e){
         std::cout << "Could not restore defaults: " << e.what() << '\n';
         return false;
@@ -2723,10 +3077,112 @@ void get_itemlots_description(){
 
 
 
-//Housekeeping
-void free_rando_data(IRData& data){
-    if(data.data)delete data.data;
+//Seed search, only the key item plan is made, nothing is written
+bool is_item_predicate(const search::Predicate& predicate){
+    return predicate.kind=="key-in"||predicate.kind=="key-before";
+}
+//Room names split on '|'
+std::vector<std::string_view> split_rooms(std::string_view value){
+    std::vector<std::string_view> rooms;
+    size_t begin = 0;
+    while(begin<=value.size()){
+        auto end = value.find('|',begin);
+        if(end==std::string_view::npos) end = value.size();
+        rooms.push_back(value.substr(begin,end-begin));
+        begin = end+1;
+    }
+    return rooms;
+}
+bool validate_item_predicate(const IRData& irdata,const search::Predicate& predicate){
+    if(!irdata.data||!irdata.data->key_graph){
+        std::cout<<"Key item graph is not loaded, can't check: "<<predicate.text<<'\n';
+        return false;
+    }
+    const auto& graph = irdata.data->key_graph->graph;
+    if(!graph.key_ids.contains(predicate.subject)){
+        std::cout<<"Unknown key: "<<predicate.subject<<'\n';
+        return false;
+    }
+    auto rooms = split_rooms(predicate.value);
+    if(predicate.kind=="key-before"&&rooms.size()!=1){
+        std::cout<<"key-before takes a single room: "<<predicate.text<<'\n';
+        return false;
+    }
+    for(const auto& room:rooms){
+        if(!graph.room_ids.contains(std::string(room))){
+            std::cout<<"Unknown room: "<<room<<'\n';
+            return false;
+        }
+    }
+    return true;
 }
+bool check_item_predicates(const IRData& irdata,uint64_t seed,const std::vector<search::Predicate>& predicates){
+    auto config = irdata.config;
+    config.seed = seed;
+    KeyPlan plan;
+    if(!plan_key_items(*irdata.data,config,plan)) return false;
+    const auto& graph = irdata.data->key_graph->graph;
+    for(const auto& predicate:predicates){
+        if(!is_item_predicate(predicate)) continue;
+        size_t key_id = graph.key_ids.at(predicate.subject);
+        bool match = false;
+        if(predicate.kind=="key-in"){
+            auto rooms = split_rooms(predicate.value);
+            for(const auto& placement:plan.placements){
+                if(placement.key_id!=key_id) continue;
+                for(const auto& room:rooms){
+                    if(graph.room_ids.at(std::string(room))==placement.node) match = true;
+                }
+            }
+        }else{//key-before, the key can be picked up without going through the room
+            auto reachable = solver::reachable_rooms(graph,plan.state,graph.room_ids.at(predicate.value));
+            for(const auto& placement:plan.placements){
+                if(placement.key_id==key_id&&reachable.test(placement.node)) match = true;
+            }
+        }
+        if(!match) return false;
+    }
+    return true;
+}
+bool analyze_key_placement(const IRData& irdata,const search::Options& options,const std::string& folder){
+    if(!irdata.config.valid||!irdata.data||!irdata.data->key_graph){
+        std::cout<<"Item loading went wrong, key placement not analyzed\n";
+        return false;
+    }
+    const auto& graph = irdata.data->key_graph->graph;
+    //One copy per worker, merged once they are done
+    std::vector<solver::PlacementStats> stats(search::thread_count(options));
+    std::atomic<uint64_t> failed{0};
+    search::each(options,[&](size_t worker,uint64_t seed){
+        auto config = irdata.config;
+        config.seed = seed;
+        KeyPlan plan;
+        if(plan_key_items(*irdata.data,config,plan)) stats[worker].add(graph,plan.state,solver::playthrough(graph,plan.state));
+        else failed++;
+    });
+    for(size_t i = 1;i<stats.size();i++) stats[0].merge(stats[i]);
+    std::filesystem::create_directories(folder);
+    std::ofstream depths(std::filesystem::path(folder)/"depths.csv");
+    std::ofstream key_rooms(std::filesystem::path(folder)/"key_rooms.csv");
+    std::ofstream rooms(std::filesystem::path(folder)/"rooms.csv");
+    if(!depths||!key_rooms||!rooms){
+        std::cout<<"Can't write the analysis to "<<folder<<'\n';
+        return false;
+    }
+    stats[0].depths.write_csv(graph,depths);
+    stats[0].write_key_rooms_csv(graph,key_rooms);
+    stats[0].write_rooms_csv(graph,rooms);
+    std::cout<<"Key placement of "<<stats[0].depths.seeds<<" seeds written to "<<folder;
+    if(failed) std::cout<<", "<<failed<<" seeds couldn't place every key";
+    std::cout<<'\n';
+    return true;
+}
+
+//Housekeeping
+IRData::IRData()=default;
+IRData::~IRData()=default;
+IRData::IRData(IRData&&) noexcept=default;
+IRData& IRData::operator=(IRData&&) noexcept=default;
 
 // int main(){
     // lots_test();
@@ -389,5 +389,13 @@ T* get_entry_ptr(ParamFile<T>& params,size_t row){
     std::cout<<"Cannot find entry for row "<<row<<" in "<<params.header.filename<<'\n';
     return nullptr;
 }
+template<typename T>
+const T* get_entry_ptr(const ParamFile<T>& params,size_t row){
+    for(size_t i =0;i<params.row_info.size();i++){
+        if(params.row_info[i].row==row) return &params.data[i];
+    }
+    std::cout<<"Cannot find entry for row "<<row<<" in "<<params.header.filename<<'\n';
+    return nullptr;
+}
 
 #endif
@@ -0,0 +1,45 @@
+#ifndef CBOYO_DS2SRANDOMIZER_PLAN_FILE_HPP
+#define CBOYO_DS2SRANDOMIZER_PLAN_FILE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Randomization plans, the decisions of a seed without the params they turn into
+//File: "DS2P", u16 version, then sections of 4 byte tag + varint size + payload, then a FNV-1a 32 of everything before it
+//Each module owns its tags, readers skip the ones they don't know so modules can be saved to the same file
+namespace plan_file{
+    constexpr uint16_t version = 1;
+    struct Section{
+        std::string tag;//Always 4 characters
+        std::string data;
+    };
+    //Little endian base 128 integers, signed ones zigzag encoded so small negatives stay small
+    struct Writer{
+        std::string data;
+        void u(uint64_t value);
+        void s(int64_t value);
+        void f(float value);
+        void str(std::string_view value);
+    };
+    struct Reader{
+        std::string_view data;
+        size_t at{0};
+        bool ok{true};
+        uint64_t u();
+        int64_t s();
+        float f();
+        std::string str();
+        bool done()const{return at==data.size();}
+    };
+    std::string write(const std::vector<Section>& sections);
+    bool read(std::string_view file,std::vector<Section>& sections);
+    //Replaces the sections with the same tags already in the file and keeps the rest
+    bool save(const std::filesystem::path& path,const std::vector<Section>& sections);
+    bool load(const std::filesystem::path& path,std::vector<Section>& sections);
+    const Section* find(const std::vector<Section>& sections,std::string_view tag);
+}
+
+#endif
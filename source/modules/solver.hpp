@@ -0,0 +1,179 @@
+#ifndef CBOYO_DS2SRANDOMIZER_SOLVER_HPP
+#define CBOYO_DS2SRANDOMIZER_SOLVER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <random>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace item_rando{
+//This thing is used to place the keys so no softlocks happen
+namespace solver{
+    //Rooms the graph file doesn't give a capacity to
+    constexpr uint64_t default_capacity=99999;
+    //Keys needed together, NULL key is ignored
+    using Requirement = std::vector<uint32_t>;
+    struct Door{
+        uint32_t from,to;
+        //Any one requirement opens the door, a door without any is always open
+        std::vector<Requirement> requirements;
+    };
+    struct Key{
+        std::string name;
+        uint64_t total_amount;
+    };
+    struct Room{
+        std::string name;
+        uint64_t capacity;//Keys the room can hold
+    };
+
+    struct Graph{
+        uint64_t n_nodes;
+        std::vector<Door> blockades;
+        std::vector<Key> keys;
+        std::vector<Room> rooms;
+        //Name lookups, filled by parse_from_file
+        std::unordered_map<std::string,uint32_t> room_ids;
+        std::unordered_map<std::string,uint32_t> key_ids;
+    };
+
+    //One bit per room or per key, stored in 64 bit words so sets can be tested a word at a time
+    struct Bits{
+        std::vector<uint64_t> words;
+        Bits()=default;
+        explicit Bits(size_t n_bits):words((n_bits+63)/64,0){}
+        bool test(size_t i)const{return (words[i>>6]>>(i&63))&1;}
+        void set(size_t i){words[i>>6]|=uint64_t(1)<<(i&63);}
+        void reset(size_t i){words[i>>6]&=~(uint64_t(1)<<(i&63));}
+        size_t count()const;
+    };
+    inline size_t word_count(size_t n_bits){return (n_bits+63)/64;}
+
+    struct Placement{
+        std::vector<uint64_t> node;
+        uint64_t left;
+    };
+    struct GraphState{
+        //Rooms joined both ways by doors needing no key are one node for the expansion
+        //Rooms of node i are node_rooms[node_begin[i]..node_begin[i+1]]
+        std::vector<uint32_t> node_of_room;
+        std::vector<uint32_t> node_begin;
+        std::vector<uint32_t> node_rooms;
+        //Doors leaving node i for another node are door_list[door_begin[i]..door_begin[i+1]]
+        std::vector<uint32_t> door_begin;
+        std::vector<uint32_t> door_list;
+        //Requirements of door i are requirement_begin[i]..requirement_begin[i+1], an open door has one with no keys
+        std::vector<uint32_t> requirement_begin;
+        std::vector<uint32_t> requirement_door;
+        //Keys needed by each requirement, key_words words per requirement, NULL key is never stored
+        std::vector<uint64_t> requirement_keys;
+        size_t key_words{0};
+        std::vector<Placement> placements;
+        //Keys each room can still take, place_key takes one
+        std::vector<uint64_t> capacity_left;
+    };
+    //Rooms reachable with the keys placed so far, kept between placements so only what a new key unlocks is expanded
+    struct Frontier{
+        Bits rooms;
+        Bits keys;
+        //Requirements of doors leaving a visited room wait on their first missing key, linked per key through waiting_next
+        std::vector<uint32_t> waiting_head;
+        std::vector<uint32_t> waiting_next;
+        //Placed keys by room, key_words words per room
+        std::vector<uint64_t> room_keys;
+    };
+    //What the graph allows before any key is placed
+    struct Analysis{
+        //Strongly connected components of all doors, numbered in reverse topological order
+        std::vector<uint32_t> component;
+        uint32_t components{0};
+        //Same for the doors needing no key, these are the nodes generate_state joins
+        std::vector<uint32_t> free_component;
+        uint32_t free_components{0};
+        //Rooms not reachable even with every key
+        Bits unreachable;
+        //Rooms every route to needs key i, the rooms each key dominates
+        std::vector<Bits> behind_key;
+    };
+    Analysis analyze(const Graph& graph);
+    //Prints a summary and the problems found, false when some room can never be reached
+    bool report_analysis(const Graph& graph,const Analysis& analysis);
+    //join_free_rooms false keeps one node per room, needed to expand around a single room
+    GraphState generate_state(const Graph& graph,bool join_free_rooms=true);
+    Frontier generate_frontier(const Graph& graph,const GraphState& state);
+    std::vector<size_t> get_valid_nodes(const Graph& graph,const GraphState& state,size_t key_id);
+    std::vector<size_t> get_valid_nodes(const Graph& graph,const GraphState& state,const Frontier& frontier,size_t key_id);
+    struct Slot{
+        size_t room;
+        uint64_t index;//Which of the room's capacity_left free places
+    };
+    //One free place out of every one left in valid_nodes, uniformly, so fuller rooms are picked more
+    //room is SIZE_MAX when all of them are full
+    Slot pick_slot(const GraphState& state,const std::vector<size_t>& valid_nodes,std::mt19937_64& generator);
+    void place_key(const Graph& graph,GraphState& state,Frontier& frontier,size_t key_id,size_t node);
+    void solve(const Graph& graph,GraphState& state);
+    void solve(const Graph& graph,GraphState& state,uint64_t seed);
+    bool check_solution(const Graph& graph,const GraphState& state);
+    //check_solution for many placements on the same graph, 64 at a time with one bit lane per state
+    //Returns the rooms each state can't visit, so a state passes when its Bits count is 0
+    std::vector<Bits> check_solutions(const Graph& graph,std::span<const GraphState> states);
+    //Rooms reachable with the placed keys without ever entering excluded_room
+    Bits reachable_rooms(const Graph& graph,const GraphState& state,size_t excluded_room=SIZE_MAX);
+    void print_solution(const Graph& graph,const GraphState& state);
+
+    //What opens as the keys of each sphere are picked up, sphere 0 is what the start reaches without keys
+    struct Sphere{
+        std::vector<uint32_t> rooms;//Rooms first reached in this sphere
+        std::vector<uint32_t> keys;//Keys picked up in those rooms, they count from the next sphere on
+    };
+    struct Playthrough{
+        std::vector<Sphere> spheres;
+        //Sphere each key is picked up in, no_sphere when it never is
+        std::vector<uint32_t> key_sphere;
+        //Keys that can't be left out when visiting every room, by sphere, none of them can be dropped
+        std::vector<uint32_t> required;
+    };
+    constexpr uint32_t no_sphere = UINT32_MAX;
+    Playthrough playthrough(const Graph& graph,const GraphState& state);
+    void print_playthrough(const Graph& graph,const GraphState& state,const Playthrough& result,std::ostream& out);
+    //Sphere of every key over many seeds, merged from per thread copies
+    struct DepthStats{
+        uint64_t seeds{0};
+        //seeds_at[key][sphere], spheres past the end never happened, the last column counts seeds the key was never picked
+        std::vector<std::vector<uint64_t>> seeds_at;
+        std::vector<uint64_t> required;//Seeds the key was required in
+        void add(const Playthrough& result);
+        void merge(const DepthStats& other);
+        //key,seeds,required,never,mean,sphere 0,sphere 1,...
+        void write_csv(const Graph& graph,std::ostream& out)const;
+    };
+    //Where keys go over many seeds, on top of their depths
+    struct PlacementStats{
+        DepthStats depths;
+        //Seeds key i went to room j, graph.n_nodes counts per key
+        std::vector<uint64_t> key_rooms;
+        //Seeds each room held a key of the required playthrough
+        std::vector<uint64_t> required_stops;
+        void add(const Graph& graph,const GraphState& state,const Playthrough& result);
+        void merge(const PlacementStats& other);
+        //key,room,seeds,fraction for every pair that happened
+        void write_key_rooms_csv(const Graph& graph,std::ostream& out)const;
+        //room,required stop seeds,fraction,keys placed per seed
+        void write_rooms_csv(const Graph& graph,std::ostream& out)const;
+    };
+    bool test_graph(const Graph& graph);
+    size_t room_by_name(const Graph& graph,const std::string& name);
+    size_t key_by_name(const Graph& graph,const std::string& name);
+    bool parse_from_file(const std::filesystem::path& file_path,Graph& graph);
+    bool solver_test1();
+    bool solver_test2();
+    bool solver_test3();
+    bool parser_test();
+}
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CBOYO_DS2SRANDOMIZER_STAGES_HPP
+#define CBOYO_DS2SRANDOMIZER_STAGES_HPP
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Runs the steps of a pipeline as a dependency graph, every stage whose dependencies are done can run at the same time
+//Stages must not share random generators, each one seeds its own so results don't depend on the order they run
+namespace stages{
+    enum class Status{Pending,Done,Failed,Skipped};
+    //Tables a stage touches, a stage runs after every earlier stage that writes what it reads or touches what it writes
+    struct Resources{
+        std::vector<std::string> reads;
+        std::vector<std::string> writes;
+    };
+    struct Stage{
+        std::string group;//Stage this task belongs to, timings are added up per group
+        std::string name;
+        std::function<bool()> run;
+        std::vector<size_t> after;//Stages that must finish first, always added before this one
+        Status status{Status::Pending};
+        double ms{0.0};
+    };
+    class Scheduler{
+    public:
+        size_t add(std::string name,std::function<bool()> run,std::vector<size_t> after={});
+        size_t add(std::string group,std::string name,std::function<bool()> run,const Resources& resources,std::vector<size_t> after={});
+        //False if a stage failed, stages depending on a failed one are skipped
+        bool run(size_t threads=0);
+        const std::vector<Stage>& get_stages()const{return stages;}
+        //Longest chain of dependent stages by time, only meaningful after run
+        std::vector<size_t> critical_path()const;
+        std::string to_dot()const;
+        void print_timings(std::ostream& out)const;
+    private:
+        std::vector<Stage> stages;
+        std::unordered_map<std::string,size_t> last_writer;
+        std::unordered_map<std::string,std::vector<size_t>> readers;//Since the last write
+        double wall_ms{0.0};
+    };
+}
+
+#endif
@@ -1,14 +1,17 @@
 #ifndef CBOYO_DS2SRANDOMIZER_UTILS_HPP
 #define CBOYO_DS2SRANDOMIZER_UTILS_HPP
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <random>
+#include <span>
 #include <unordered_map>
 
 class Stopwatch {
@@ -64,13 +67,34 @@ inline auto get_file_contents_binary(const std::filesystem::path &path) -> std::
     return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
 }
 
+// Written next to the file and renamed over it, so a reader never sees half a file and a hardlinked old file is left alone
 inline void write_to_file_binary(const std::filesystem::path &path, const std::string &data) {
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file: " << path << std::endl;
-        return;
+    auto temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open file: " << temp << std::endl;
+            return;
+        }
+        file.write(data.data(), data.size());
+        if (!file) {
+            std::cerr << "Failed to write file: " << temp << std::endl;
+            return;
+        }
     }
-    file.write(data.data(), data.size());
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+    if (error) {
+        std::cerr << "Failed to replace file: " << path << " " << error.message() << std::endl;
+        std::filesystem::remove(temp, error);
+    }
+}
+
+// copy_file overwriting writes through the old file, removing it first leaves hardlinks to it alone
+inline bool copy_file_replacing(const std::filesystem::path &from, const std::filesystem::path &to) {
+    std::filesystem::remove(to);
+    return std::filesystem::copy_file(from, to);
 }
 
 inline auto time_string_now() -> std::string {
@@ -121,7 +145,12 @@ namespace cboyo::parse {
 }
 
 namespace cboyo::random {
-    inline auto m_gen = std::mt19937_64(std::random_device{}());
+    //A seed for configs that don't give one, each call has its own generator so threads can draw at the same time
+    inline uint64_t new_seed(){
+        std::random_device device;
+        std::mt19937_64 generator((uint64_t(device())<<32)|device());
+        return std::uniform_int_distribution<uint64_t>(0u,999999999999999u)(generator);
+    }
 
     auto element(auto &&container, auto &&generator) -> decltype(auto) {
         std::uniform_int_distribution<size_t> dist(0, container.size() - 1);
@@ -0,0 +1,207 @@
+#include "modules/output_cache.hpp"
+#include "modules/utils.hpp"
+
+#include <chrono>
+#include <random>
+#include <sstream>
+
+//The build gives the version and a hash of the code, without it every build is taken for a different program
+#ifndef DS2SRAND_VERSION
+#define DS2SRAND_VERSION __DATE__ " " __TIME__
+#endif
+
+namespace output_cache{
+    const std::string manifest_name = "files.txt";
+    const std::string metrics_name = "metrics.txt";
+
+    uint64_t fnv1a(std::string_view data,uint64_t hash = 14695981039346656037ull){
+        for(char c:data){
+            hash^=(uint8_t)c;
+            hash*=1099511628211ull;
+        }
+        return hash;
+    }
+    std::string hex(uint64_t value){
+        std::string out(16,'0');
+        for(int i = 15;i>=0;i--,value>>=4) out[i] = "0123456789abcdef"[value&15];
+        return out;
+    }
+
+    std::string make_key(std::string_view module,std::string_view config_text,uint64_t seed,uint64_t data_hash){
+        std::stringstream canonical;
+        canonical<<module<<'\n'<<DS2SRAND_VERSION<<'\n'<<seed<<'\n'<<hex(data_hash)<<'\n'<<config_text;
+        auto text = canonical.str();
+        //Two differently seeded hashes, 128 bits so different inputs don't end up on the same folder
+        return std::string(module)+'-'+hex(fnv1a(text))+hex(fnv1a(text,0x6a09e667f3bcc909ull));
+    }
+    uint64_t hash_folder(const std::filesystem::path& folder){
+        std::vector<std::filesystem::path> files;
+        if(std::filesystem::exists(folder)){
+            for(const auto& entry:std::filesystem::recursive_directory_iterator(folder)){
+                if(entry.is_regular_file()) files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(),files.end());
+        uint64_t hash = fnv1a(folder.generic_string());
+        for(const auto& file:files){
+            hash = fnv1a(std::filesystem::relative(file,folder).generic_string(),hash);
+            hash = fnv1a(get_file_contents_binary(file),hash);
+        }
+        return hash;
+    }
+
+    Cache::Cache(std::filesystem::path folder_,uint64_t max_bytes_):folder(std::move(folder_)),max_bytes(max_bytes_){
+        std::ifstream file(folder/metrics_name);
+        std::string name;
+        uint64_t value = 0;
+        while(file>>name>>value){
+            if(name=="hits")           hits = value;
+            else if(name=="misses")    misses = value;
+            else if(name=="evictions") evictions = value;
+        }
+    }
+    bool Cache::lookup(const std::string& key,std::vector<File>& files){
+        std::lock_guard lock(mutex);
+        return find(key,files);
+    }
+    bool Cache::find(const std::string& key,std::vector<File>& files){
+        files.clear();
+        auto entry = folder/key;
+        std::ifstream manifest(entry/manifest_name);
+        if(!manifest){
+            misses++;
+            run_misses++;
+            save_metrics();
+            return false;
+        }
+        std::string line;
+        while(cboyo::parse::getline(manifest,line)){
+            if(line.size()<3) continue;
+            files.push_back({entry/line.substr(2),line[0]=='L'});
+        }
+        std::error_code error;
+        std::filesystem::last_write_time(entry,std::filesystem::file_time_type::clock::now(),error);//Most recently used
+        hits++;
+        run_hits++;
+        save_metrics();
+        return true;
+    }
+    bool Cache::serve(const std::string& key,const std::filesystem::path& out_folder){
+        std::lock_guard lock(mutex);
+        std::vector<File> files;
+        if(!find(key,files)) return false;
+        if(!std::filesystem::exists(out_folder)){
+            std::filesystem::create_directories(out_folder);
+        }
+        for(const auto& file:files){
+            auto to = out_folder/file.path.filename();
+            std::error_code error;
+            std::filesystem::remove(to,error);//Never write through an old link into another entry
+            if(file.link){
+                std::filesystem::create_hard_link(file.path,to,error);
+                if(!error) continue;
+            }
+            error.clear();
+            std::filesystem::copy_file(file.path,to,error);
+            if(error){
+                std::cout<<"Failed to take "<<file.path.filename()<<" from the cache: "<<error.message()<<'\n';
+                hits--;
+                run_hits--;
+                misses++;
+                run_misses++;
+                save_metrics();
+                return false;
+            }
+        }
+        return true;
+    }
+    //One file of a new entry, copied from a path or written from memory
+    struct Staged{
+        std::string name;
+        bool link;
+        const std::filesystem::path* from;
+        const std::string* data;
+    };
+    //Filled under a temporary name and renamed, so other processes never see half an entry
+    bool stage(const std::filesystem::path& folder,const std::string& key,const std::vector<Staged>& files){
+        auto entry = folder/key;
+        auto temp = folder/(".tmp-"+key+"-"+std::to_string(std::random_device{}()));
+        std::error_code error;
+        std::filesystem::create_directories(temp,error);
+        std::ofstream manifest(temp/manifest_name);
+        for(const auto& file:files){
+            if(file.from){
+                std::filesystem::copy_file(*file.from,temp/file.name,error);
+            }else{
+                std::ofstream out(temp/file.name,std::ios::binary);
+                out.write(file.data->data(),(std::streamsize)file.data->size());
+                if(!out) error = std::make_error_code(std::errc::io_error);
+            }
+            if(error) break;
+            manifest<<(file.link?'L':'C')<<' '<<file.name<<'\n';
+        }
+        manifest.close();
+        if(!error) std::filesystem::rename(temp,entry,error);
+        if(error){
+            std::cout<<"Failed to store seed in the cache: "<<error.message()<<'\n';
+            std::filesystem::remove_all(temp,error);
+            return false;
+        }
+        return true;
+    }
+    void Cache::store(const std::string& key,const std::vector<File>& files){
+        std::lock_guard lock(mutex);
+        if(std::filesystem::exists(folder/key/manifest_name)) return;
+        std::vector<Staged> staged;
+        for(const auto& file:files) staged.push_back({file.path.filename().string(),file.link,&file.path,nullptr});
+        if(stage(folder,key,staged)) evict();
+    }
+    void Cache::store(const std::string& key,const std::vector<Contents>& files){
+        std::lock_guard lock(mutex);
+        if(std::filesystem::exists(folder/key/manifest_name)) return;
+        std::vector<Staged> staged;
+        for(const auto& file:files) staged.push_back({file.name,file.link,nullptr,&file.data});
+        if(stage(folder,key,staged)) evict();
+    }
+    void Cache::evict(){
+        struct Entry{
+            std::filesystem::path path;
+            std::filesystem::file_time_type used;
+            uint64_t bytes;
+        };
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        for(const auto& dir:std::filesystem::directory_iterator(folder)){
+            if(!dir.is_directory()||dir.path().filename().string().starts_with(".tmp-")) continue;
+            Entry entry{dir.path(),dir.last_write_time(),0};
+            for(const auto& file:std::filesystem::directory_iterator(dir.path())){
+                if(file.is_regular_file()) entry.bytes+=file.file_size();
+            }
+            total+=entry.bytes;
+            entries.push_back(std::move(entry));
+        }
+        std::sort(entries.begin(),entries.end(),[](const Entry& a,const Entry& b){return a.used<b.used;});
+        for(const auto& entry:entries){
+            if(total<=max_bytes) break;
+            std::error_code error;
+            std::filesystem::remove_all(entry.path,error);
+            if(error) continue;
+            total-=entry.bytes;
+            evictions++;
+        }
+        save_metrics();
+    }
+    void Cache::save_metrics()const{
+        std::error_code error;
+        std::filesystem::create_directories(folder,error);
+        std::ofstream file(folder/metrics_name);
+        file<<"hits "<<hits<<"\nmisses "<<misses<<"\nevictions "<<evictions<<'\n';
+    }
+    void Cache::print_metrics()const{
+        std::lock_guard lock(mutex);
+        auto lookups = hits+misses;
+        std::cout<<"Cache: "<<run_hits<<" hits and "<<run_misses<<" misses this run, "<<hits<<" hits, "<<misses<<" misses";
+        if(lookups) std::cout<<" ("<<(100*hits/lookups)<<"% hit rate)";
+        std::cout<<" and "<<evictions<<" evictions in total\n";
+    }
+}
@@ -0,0 +1,228 @@
+#include "modules/param_writes.hpp"
+#include "modules/param_editor.hpp"
+#include "modules/utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+namespace param_writes{
+    //Where a row's data is in a param file
+    struct RowSpan{
+        uint64_t row;
+        uint64_t begin;
+        uint64_t size;
+    };
+    //Rows are read the way read_param_file does, one after another from their initial byte
+    bool rows_of(const std::string& file,std::vector<RowSpan>& rows){
+        rows.clear();
+        if(file.size()<sizeof(ParamHeader)) return false;
+        ParamHeader header;
+        std::memcpy(&header,file.data(),sizeof(ParamHeader));
+        size_t n_rows = header.n_rows;
+        if(sizeof(ParamHeader)+sizeof(ParamRowInfo)*n_rows>file.size()) return false;
+        std::vector<ParamRowInfo> info(n_rows);
+        std::memcpy(info.data(),file.data()+sizeof(ParamHeader),sizeof(ParamRowInfo)*n_rows);
+        uint64_t stride = n_rows>1?info[1].initial_byte-info[0].initial_byte:0;
+        for(size_t i = 0;i<n_rows;i++){
+            auto begin = info[i].initial_byte;
+            uint64_t size = stride;
+            if(i+1<n_rows&&info[i+1].initial_byte>begin) size = info[i+1].initial_byte-begin;
+            else if(n_rows==1&&header.end_of_file>begin) size = header.end_of_file-begin;
+            if(begin>file.size()||size>file.size()-begin) return false;
+            rows.push_back({info[i].row,begin,size});
+        }
+        return true;
+    }
+
+    bool diff(const std::string& base,const std::string& contents,std::vector<Edit>& edits){
+        std::vector<RowSpan> from,to;
+        if(!rows_of(base,from)||!rows_of(contents,to)||from.size()!=to.size()) return false;
+        for(size_t i = 0;i<from.size();i++){
+            if(from[i].row!=to[i].row||from[i].size!=to[i].size) return false;
+        }
+        for(size_t i = 0;i<from.size();i++){
+            const char* a = base.data()+from[i].begin;
+            const char* b = contents.data()+to[i].begin;
+            for(uint64_t j = 0;j<from[i].size;){
+                if(a[j]==b[j]){
+                    j++;
+                    continue;
+                }
+                auto start = j;
+                while(j<from[i].size&&a[j]!=b[j]) j++;
+                edits.push_back({from[i].row,(uint32_t)start,std::string(b+start,j-start)});
+            }
+        }
+        return true;
+    }
+
+    Coordinator::Coordinator(std::filesystem::path out_folder,std::vector<std::string> modules):out_folder(std::move(out_folder)),modules(std::move(modules)){}
+
+    void Coordinator::add(const std::string& name,Submission submission){
+        std::lock_guard lock(mutex);
+        auto known = std::find(modules.begin(),modules.end(),submission.module);
+        submission.rank = (size_t)(known-modules.begin());
+        submission.order = submitted.size();
+        submitted.emplace_back(name,std::move(submission));
+    }
+    void Coordinator::submit_file(std::string_view module,const std::string& name,std::string contents){
+        Submission submission{};
+        submission.module = module;
+        submission.kind = Submission::File;
+        submission.contents = std::move(contents);
+        add(name,std::move(submission));
+    }
+    void Coordinator::submit_link(std::string_view module,const std::string& name,const std::filesystem::path& from){
+        Submission submission{};
+        submission.module = module;
+        submission.kind = Submission::Link;
+        submission.from = from;
+        add(name,std::move(submission));
+    }
+    void Coordinator::submit_edits(std::string_view module,const std::string& name,std::vector<Edit> edits){
+        Submission submission{};
+        submission.module = module;
+        submission.kind = Submission::Edits;
+        submission.edits = std::move(edits);
+        add(name,std::move(submission));
+    }
+    void Coordinator::submit_at(std::string_view module,const std::string& name,uint64_t file_offset,std::string bytes){
+        Submission submission{};
+        submission.module = module;
+        submission.kind = Submission::At;
+        submission.file_offset = file_offset;
+        submission.edits.push_back({0,0,std::move(bytes)});
+        add(name,std::move(submission));
+    }
+
+    //Earlier modules first, and a module's own submissions in the order it made them
+    void Coordinator::sort(std::vector<Submission>& submissions){
+        std::stable_sort(submissions.begin(),submissions.end(),[](const Submission& a,const Submission& b){
+            return a.rank!=b.rank?a.rank<b.rank:a.order<b.order;
+        });
+    }
+    std::vector<std::filesystem::path> Coordinator::commit(){
+        std::lock_guard lock(mutex);
+        std::map<std::string,std::vector<Submission>> files;//Sorted by name so files go out in the same order too
+        for(auto& [name,submission]:submitted) files[name].push_back(std::move(submission));
+        submitted.clear();
+        if(!files.empty()&&!std::filesystem::exists(out_folder)){
+            std::filesystem::create_directories(out_folder);
+        }
+        std::vector<std::filesystem::path> written;
+        for(auto& [name,submissions]:files){
+            sort(submissions);
+            auto path = out_folder/name;
+            //Only one module gave the file and nothing edits it, a cached file is linked instead of copied
+            if(submissions.size()==1&&submissions[0].kind==Submission::Link){
+                std::error_code error;
+                std::filesystem::remove(path,error);//Never write through an old link
+                std::filesystem::create_hard_link(submissions[0].from,path,error);
+                if(error){
+                    error.clear();
+                    std::filesystem::copy_file(submissions[0].from,path,error);
+                }
+                if(error) std::cout<<"Failed to write "<<path<<": "<<error.message()<<'\n';
+                else written.push_back(path);
+                continue;
+            }
+            std::string contents;
+            if(!merge(name,submissions,contents,found)) continue;
+            write_to_file_binary(path,contents);
+            written.push_back(path);
+        }
+        return written;
+    }
+    bool Coordinator::preview(const std::string& name,std::string& contents){
+        std::vector<Submission> submissions;
+        {
+            std::lock_guard lock(mutex);
+            for(const auto& [file,submission]:submitted){
+                if(file==name) submissions.push_back(submission);
+            }
+        }
+        sort(submissions);
+        std::vector<Conflict> ignored;
+        return merge(name,submissions,contents,ignored);
+    }
+
+    bool Coordinator::merge(const std::string& name,std::vector<Submission>& submissions,std::string& base,std::vector<Conflict>& conflicts)const{
+        auto path = out_folder/name;
+        auto whole = [](const Submission& s){return s.kind==Submission::File||s.kind==Submission::Link;};
+        std::string base_module;
+        for(auto& s:submissions){
+            if(!whole(s)) continue;
+            auto contents = s.kind==Submission::Link?get_file_contents_binary(s.from):std::move(s.contents);
+            if(base_module.empty()){
+                base = std::move(contents);
+                base_module = s.module;
+                continue;
+            }
+            //Two modules both built the whole file, every byte they disagree on is a conflict
+            std::vector<Edit> theirs;
+            if(!diff(base,contents,theirs)){
+                std::cout<<"Rows of "<<name<<" from "<<s.module<<" don't match the ones from "<<base_module<<", "<<s.module<<"'s file dropped\n";
+                conflicts.push_back({name,0,0,base_module,s.module});
+                continue;
+            }
+            for(const auto& edit:theirs) conflicts.push_back({name,edit.row,edit.offset,base_module,s.module});
+        }
+        if(std::all_of(submissions.begin(),submissions.end(),whole)) return true;
+        if(base_module.empty()) base = get_file_contents_binary(path);
+        std::vector<RowSpan> rows;
+        if(!rows_of(base,rows)){
+            std::cout<<"No param file to edit in "<<path<<'\n';
+            return false;
+        }
+        std::unordered_map<uint64_t,size_t> row_index;
+        for(size_t i = 0;i<rows.size();i++) row_index.emplace(rows[i].row,i);
+
+        //Module that set each byte, an edit changing a byte another module set to something else is dropped whole
+        std::vector<const std::string*> owner(base.size(),nullptr);
+        for(auto& s:submissions){
+            if(whole(s)) continue;
+            if(s.kind==Submission::At){
+                auto row = std::find_if(rows.begin(),rows.end(),[&](const RowSpan& r){
+                    return s.file_offset>=r.begin&&s.file_offset-r.begin<r.size;
+                });
+                if(row==rows.end()){
+                    std::cout<<"Offset "<<s.file_offset<<" of "<<name<<" from "<<s.module<<" is in no row\n";
+                    continue;
+                }
+                s.edits[0].row = row->row;
+                s.edits[0].offset = (uint32_t)(s.file_offset-row->begin);
+            }
+            for(const auto& edit:s.edits){
+                auto found_row = row_index.find(edit.row);
+                if(found_row==row_index.end()||edit.offset+edit.bytes.size()>rows[found_row->second].size){
+                    std::cout<<"Edit of "<<name<<" row "<<edit.row<<" from "<<s.module<<" is outside the file\n";
+                    continue;
+                }
+                auto begin = rows[found_row->second].begin+edit.offset;
+                const std::string* kept = nullptr;
+                for(size_t i = 0;i<edit.bytes.size()&&!kept;i++){
+                    auto by = owner[begin+i];
+                    if(by&&*by!=s.module&&base[begin+i]!=edit.bytes[i]) kept = by;
+                }
+                if(kept){
+                    conflicts.push_back({name,edit.row,edit.offset,*kept,s.module});
+                    continue;
+                }
+                for(size_t i = 0;i<edit.bytes.size();i++){
+                    base[begin+i] = edit.bytes[i];
+                    owner[begin+i] = &s.module;
+                }
+            }
+        }
+        return true;
+    }
+
+    void Coordinator::print_conflicts()const{
+        for(const auto& conflict:found){
+            std::cout<<"Conflicting edit of "<<conflict.file<<" row "<<conflict.row<<" at "<<conflict.offset
+                     <<": kept "<<conflict.kept<<", dropped "<<conflict.dropped<<'\n';
+        }
+    }
+}
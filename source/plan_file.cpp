@@ -0,0 +1,154 @@
+#include "modules/plan_file.hpp"
+#include "modules/utils.hpp"
+
+#include <bit>
+#include <cstring>
+
+namespace plan_file{
+    void Writer::u(uint64_t value){
+        while(value>=0x80){
+            data.push_back((char)((value&0x7f)|0x80));
+            value>>=7;
+        }
+        data.push_back((char)value);
+    }
+    void Writer::s(int64_t value){
+        u(((uint64_t)value<<1)^(uint64_t)(value>>63));
+    }
+    void Writer::f(float value){
+        u(std::bit_cast<uint32_t>(value));
+    }
+    void Writer::str(std::string_view value){
+        u(value.size());
+        data.append(value);
+    }
+
+    uint64_t Reader::u(){
+        uint64_t value = 0;
+        for(unsigned shift = 0;shift<64;shift+=7){
+            if(at>=data.size()){
+                ok = false;
+                return 0;
+            }
+            auto byte = (uint8_t)data[at++];
+            //The tenth byte only has room for the top bit, anything more is a damaged plan
+            if(shift==63&&(byte&0x7e)){
+                ok = false;
+                return 0;
+            }
+            value|=(uint64_t)(byte&0x7f)<<shift;
+            if(!(byte&0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+    int64_t Reader::s(){
+        auto value = u();
+        return (int64_t)(value>>1)^-(int64_t)(value&1);
+    }
+    float Reader::f(){
+        return std::bit_cast<float>((uint32_t)u());
+    }
+    std::string Reader::str(){
+        auto size = u();
+        if(!ok||size>data.size()-at){
+            ok = false;
+            return {};
+        }
+        std::string value(data.substr(at,size));
+        at+=size;
+        return value;
+    }
+
+    uint32_t fnv1a(std::string_view data){
+        uint32_t hash = 2166136261u;
+        for(char c:data){
+            hash^=(uint8_t)c;
+            hash*=16777619u;
+        }
+        return hash;
+    }
+    std::string write(const std::vector<Section>& sections){
+        Writer writer;
+        writer.data = "DS2P";
+        writer.data.push_back((char)(version&0xff));
+        writer.data.push_back((char)(version>>8));
+        for(const auto& section:sections){
+            writer.data.append(section.tag.substr(0,4));
+            writer.data.append(4-std::min<size_t>(section.tag.size(),4),' ');
+            writer.str(section.data);
+        }
+        auto hash = fnv1a(writer.data);
+        for(int i = 0;i<4;i++) writer.data.push_back((char)((hash>>(8*i))&0xff));
+        return writer.data;
+    }
+    bool read(std::string_view file,std::vector<Section>& sections){
+        if(file.size()<10||file.substr(0,4)!="DS2P"){
+            std::cout<<"Not a randomizer plan\n";
+            return false;
+        }
+        uint32_t stored = 0;
+        for(int i = 0;i<4;i++) stored|=(uint32_t)(uint8_t)file[file.size()-4+i]<<(8*i);
+        auto body = file.substr(0,file.size()-4);
+        if(fnv1a(body)!=stored){
+            std::cout<<"Randomizer plan is corrupted\n";
+            return false;
+        }
+        uint16_t file_version = (uint16_t)((uint8_t)body[4]|((uint8_t)body[5]<<8));
+        if(file_version>version){
+            std::cout<<"Randomizer plan version "<<file_version<<" is newer than this randomizer, update it\n";
+            return false;
+        }
+        Reader reader{body,6};
+        while(!reader.done()){
+            if(body.size()-reader.at<4){
+                reader.ok = false;
+                break;
+            }
+            Section section;
+            section.tag = std::string(body.substr(reader.at,4));
+            reader.at+=4;
+            section.data = reader.str();
+            if(!reader.ok) break;
+            sections.push_back(std::move(section));
+        }
+        if(!reader.ok){
+            std::cout<<"Randomizer plan is truncated\n";
+            return false;
+        }
+        return true;
+    }
+    bool save(const std::filesystem::path& path,const std::vector<Section>& sections){
+        std::vector<Section> merged;
+        if(std::filesystem::exists(path)&&!read(get_file_contents_binary(path),merged)){
+            std::cout<<"Overwriting unreadable plan: "<<path<<'\n';
+            merged.clear();
+        }
+        std::erase_if(merged,[&sections](const Section& old){return find(sections,old.tag)!=nullptr;});
+        merged.insert(merged.end(),sections.begin(),sections.end());
+        if(path.has_parent_path()&&!std::filesystem::exists(path.parent_path())){
+            std::filesystem::create_directories(path.parent_path());
+        }
+        std::ofstream file(path,std::ios::binary);
+        if(!file){
+            std::cout<<"Failed to write plan: "<<path<<'\n';
+            return false;
+        }
+        auto bytes = write(merged);
+        file.write(bytes.data(),bytes.size());
+        return true;
+    }
+    bool load(const std::filesystem::path& path,std::vector<Section>& sections){
+        if(!std::filesystem::exists(path)){
+            std::cout<<"Missing plan file: "<<path<<'\n';
+            return false;
+        }
+        return read(get_file_contents_binary(path),sections);
+    }
+    const Section* find(const std::vector<Section>& sections,std::string_view tag){
+        for(const auto& section:sections){
+            if(section.tag==tag) return &section;
+        }
+        return nullptr;
+    }
+}
@@ -1,16 +1,25 @@
+#include <charconv>
+#include <cmath>
 #include "modules/randomizer.hpp"
+#include "modules/output_cache.hpp"
 #include "modules/param_editor.hpp"
+#include "modules/param_writes.hpp"
+#include "modules/plan_file.hpp"
+#include "modules/search.hpp"
+#include "modules/spoiler_log.hpp"
+#include "modules/stages.hpp"
 #include "modules/utils.hpp"
 namespace randomizer{
 
 namespace paths{
     const std::filesystem::path configfile = "er_config.txt";
+    const std::filesystem::path data = "data/enemy_rando";
     const std::filesystem::path enemy_types ="data/enemy_rando/map_enemy_types";
     const std::filesystem::path enemies ="data/enemy_rando/enemies";
     const std::filesystem::path params ="data/enemy_rando/Params";
-    const std::filesystem::path out_folder ="Param";
-    const std::filesystem::path cheatsheet_folder = "cheatsheets/enemies";
 }
+//Name the param coordinator knows this module by
+const std::string_view module_name = "enemy";
 
 namespace common{
     std::vector<std::tuple<u64,std::string,std::string,s32,float>> map_names{
@@ -43,8 +52,6 @@ namespace common{
         {50370000,"m50_37_00_00","Frozen Eleum Loyce",2000,1.4f},
         {50380000,"m50_38_00_00","Memory of the King",9999,1.4f}
     };
-
-    std::string boss_log;
 };
 
 
@@ -181,7 +188,7 @@ size_t get_map(GameData& map_data,const std::string& id){
     }
     return SIZE_MAX;
 }
-size_t get_map(GameData& map_data,u64 id){
+size_t get_map(const GameData& map_data,u64 id){
     for(size_t i = 0;i<map_data.size();i++){
         if(map_data[i].id==id) return i;
     }
@@ -868,12 +875,12 @@ float linear_interpolation(float a,float b,float p){
 
 float scale_hp(float hp,float target,float scale_factor){
     if(hp<target) return hp;
-    return std::powf(hp/target,1.f-scale_factor)*target;
+    return std::pow(hp/target,1.f-scale_factor)*target;
 }
 float scale_dmg(float dmg,float target,float scale_factor){
     if(dmg>target) return 1.f;
     float dmg_ratio =  dmg/target;
-    return linear_interpolation(1.f,std::powf(dmg_ratio,2.75f),scale_factor);
+    return linear_interpolation(1.f,std::pow(dmg_ratio,2.75f),scale_factor);
 }
 
 bool balance_enemy(EnemyTable& enemy_table,s32 enemy_id,float hp_target,float hp_scaling,float dmg_target,float dmg_scaling){
@@ -899,68 +906,75 @@ bool balance_enemy(EnemyTable& enemy_table,s32 enemy_id,float hp_target,float hp
     // std::cout<<"SOULS "<<og_souls<<"->"<<ptr->souls_held<<" "<<souls_mult<<'\n';
     return true;
 }
-bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config& config){
+//What randomize_enemies picks for a seed, kept apart from the params so seeds can be checked without making them
+struct EnemySlot{
+    size_t index;
+    size_t boss_slot;//Into MapEnemyPlan::boss_index
+    size_t variation;//Bosses always use their first one
+    size_t instance;
+    bool replace;
+    bool boss;
+};
+struct MapEnemyPlan{
+    size_t map_index;
+    std::vector<size_t> boss_index;
+    std::vector<EnemySlot> slots;
+    std::vector<size_t> enemy_types;//Enemy table indexes the deck was made of
+    size_t reshuffles{0};//Times the deck ran out and was shuffled again
+};
+struct EnemyPlan{
+    std::vector<MapEnemyPlan> maps;
+    std::vector<std::string> warnings;
+};
+//Indexes of the types not banned by the config
+std::vector<size_t> allowed_indexes(const std::vector<EnemyType>& types,const Config& config){
+    std::vector<size_t> allowed;
+    allowed.reserve(types.size());
+    for(size_t i = 0;i<types.size();i++){
+        if(!vector_contains(config.banned_enemies,(size_t)types[i].id)){
+            allowed.push_back(i);
+        }
+    }
+    return allowed;
+}
+bool select_enemies(const GameData& map_data,const EnemyTable& enemy_table,const Config& config,EnemyPlan& plan){
     //Bless this mess
-    u64 regist_start_row = 1000000000u;
     std::mt19937_64 random_generator;
     std::mt19937_64 boss_chance_generator(config.seed);
     std::mt19937_64 deck_shuffler(config.seed);
-    std::unordered_map<s32,s32> enemy_id_mapping;
     std::vector<size_t> boss_index;
     boss_index.reserve(32);
 
-    float hp_scaling = config.enemy_hp_scaling/100.f;
-    float dmg_scaling = config.enemy_dmg_scaling/100.f;
-
     //Gather the valid indexes of the enemy table
-    std::vector<size_t> allowed_enemies_index;
-    allowed_enemies_index.reserve(enemy_table.enemies.size());
-    for(size_t i = 0;i<enemy_table.enemies.size();i++){
-        if(!vector_contains(config.banned_enemies,(size_t)enemy_table.enemies[i].id)){
-            allowed_enemies_index.push_back(i);
-        }
-    }
-
-    std::vector<size_t> allowed_bosses_index;
-    allowed_bosses_index.reserve(enemy_table.bosses.size());
-    for(size_t i = 0;i<enemy_table.bosses.size();i++){
-        if(!vector_contains(config.banned_enemies,(size_t)enemy_table.bosses[i].id)){
-            allowed_bosses_index.push_back(i);
-        }
-    }
+    std::vector<size_t> allowed_enemies_index = allowed_indexes(enemy_table.enemies,config);
+    std::vector<size_t> allowed_bosses_index = allowed_indexes(enemy_table.bosses,config);
     bool can_bosses_spawn = config.roaming_boss;
     bool boss_only = can_bosses_spawn&&config.roaming_boss_chance==100;
     if(allowed_bosses_index.empty()){
         if(boss_only){
-            std::cout<<"WARNING: All bosses are banned on boss only run, randomization not performed\n";
+            plan.warnings.push_back("WARNING: All bosses are banned on boss only run, randomization not performed\n");
             return false;
         }
-        std::cout<<"WARNING: All bosses are banned, roaming bosses disabled\n";
+        plan.warnings.push_back("WARNING: All bosses are banned, roaming bosses disabled\n");
         can_bosses_spawn=false;
 
     }
     if(allowed_enemies_index.empty()&&!boss_only){
-        std::cout<<"WARNING: All enemies are banned, randomization not performed\n";
+        plan.warnings.push_back("WARNING: All enemies are banned, randomization not performed\n");
         return false;
     }
-    for(auto& map:map_data){
+    for(size_t m = 0;m<map_data.size();m++){
+        const auto& map = map_data[m];
         MapSetting settings = get_settings(map.id,config);
         if(!settings.randomize)continue;
         if(settings.enemy_limit==0) continue;
-        auto& generator = map.generator;
+        const auto& generator = map.generator;
         bool can_bosses_spawn_zone = can_bosses_spawn;
         if(can_bosses_spawn&&settings.enemy_limit==1&&!boss_only){
-            std::cout<<"WARNING: Need at least 2 enemy limit if not using 100% boss replace chance for wandering bosses to spawn.If you want the same one boss use 100% boss replace chance\n";
+            plan.warnings.push_back("WARNING: Need at least 2 enemy limit if not using 100% boss replace chance for wandering bosses to spawn.If you want the same one boss use 100% boss replace chance\n");
             can_bosses_spawn_zone=false;
         }
-        struct EnemyEntry{
-            size_t index;
-            s32 boss_id;
-            EnemyInstance enemy;
-            bool replace;
-            bool boss;
-        };
-        std::vector<EnemyEntry> enemy_slots;
+        std::vector<EnemySlot> enemy_slots;
         enemy_slots.resize(generator.row_info.size());
         size_t replace_count=0;
         for(size_t j = 0;j<generator.row_info.size();j++){
@@ -972,43 +986,37 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
             enemy_slots[j].index=0;
         }
         if(replace_count==0){
-            std::cout<<"WARNING: Can't replace anything in: "<<map.name<<", skipping\n";
+            plan.warnings.push_back("WARNING: Can't replace anything in: "+map.name+", skipping\n");
             continue;
         }
-        //Precalculate some variables and create the necessary bosses
+        //Precalculate some variables, the bosses themselves are created when the plan is applied
         size_t different_enemies = 0;
-        std::vector<s32> new_bosses_ids(settings.enemy_limit,0);
+        boss_index.clear();
         if(boss_only){
             boss_index = cboyo::random::choose_n_elements(allowed_bosses_index,settings.enemy_limit,false,boss_chance_generator);
             for(auto& entry:enemy_slots){
                 if(!entry.replace)continue;
                 size_t random_index = cboyo::random::vindex(boss_index,boss_chance_generator);
-                if(new_bosses_ids[random_index]==0){
-                    s32 new_boss_id = create_new_boss(enemy_table,boss_index[random_index],1.f,1.f,1.f,1.f);
-                    if(new_boss_id==0) return false;
-                    new_bosses_ids[random_index]=new_boss_id;
-                }
                 entry.index=boss_index[random_index];
-                entry.boss_id=new_bosses_ids[random_index];
+                entry.boss_slot=random_index;
                 entry.boss=true;
             }
         }else if (can_bosses_spawn_zone){
-            size_t different_bosses = (size_t)std::ceilf((float)settings.enemy_limit*((float)config.roaming_boss_chance/100.f));
+            size_t different_bosses = (size_t)std::ceil((float)settings.enemy_limit*((float)config.roaming_boss_chance/100.f));
             boss_index = cboyo::random::choose_n_elements(allowed_bosses_index,different_bosses,false,boss_chance_generator);
             //Theres a chance that even if n bosses are used the rolls can spawn less
+            std::vector<bool> used_bosses(boss_index.size(),false);
             size_t different_used_bosses = 0;
             for(auto& entry:enemy_slots){
                 bool good_luck = cboyo::random::roll(config.roaming_boss_chance,boss_chance_generator);
                 if(!entry.replace||!good_luck)continue;
                 size_t random_index = cboyo::random::vindex(boss_index,boss_chance_generator);
-                if(new_bosses_ids[random_index]==0){
-                    s32 new_boss_id = create_new_boss(enemy_table,boss_index[random_index],1.f,1.f,1.f,1.f);
-                    if(new_boss_id==0) return false;
-                    new_bosses_ids[random_index]=new_boss_id;
+                if(!used_bosses[random_index]){
+                    used_bosses[random_index]=true;
                     different_used_bosses+=1;
                 }
                 entry.index=boss_index[random_index];
-                entry.boss_id=new_bosses_ids[random_index];
+                entry.boss_slot=random_index;
                 entry.boss=true;
             }
             different_enemies=settings.enemy_limit-different_used_bosses;
@@ -1016,8 +1024,8 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
             different_enemies=settings.enemy_limit;
         }
         if(different_enemies>allowed_enemies_index.size()){
-            std::cout<<"WARNING: Not enough allowed enemies to fill area types.\n";
-            std::cout<<different_enemies<<" types and "<<allowed_enemies_index.size()<<" allowed enemies\n";
+            plan.warnings.push_back("WARNING: Not enough allowed enemies to fill area types.\n");
+            plan.warnings.push_back(std::to_string(different_enemies)+" types and "+std::to_string(allowed_enemies_index.size())+" allowed enemies\n");
         }
         //Select the enemy types for this zone
         //Need to salt the seed for each different map to keep each map independent
@@ -1025,6 +1033,7 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
         //random_generator.seed(config.seed+hash_str_uint32(map.name));
         random_generator.seed(combine_seed_with_zone(config.seed, map.name));
         std::vector<size_t> enemies_id = cboyo::random::choose_n_elements(allowed_enemies_index,different_enemies,false,random_generator);
+        size_t reshuffles=0;
         if(!enemies_id.empty()){
             bool single_deck = config.enemy_shuffling==0;
             bool fit_deck    = config.enemy_shuffling==1;
@@ -1044,7 +1053,7 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
                 std::shuffle(enemy_deck.begin(),enemy_deck.end(),deck_shuffler);
             }else{
                 if(!random_deck){
-                    std::cout<<"Unkown shuffling mode, using random\n";
+                    plan.warnings.push_back("Unkown shuffling mode, using random\n");
                 }
                 enemy_deck.resize(replace_count);
                 for(auto& card:enemy_deck){
@@ -1056,14 +1065,12 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
             for(auto& slot:enemy_slots){
                 if(!slot.replace) continue;
                 auto enemy_index = enemy_deck[deck_index];
-                // if(map.name=="Shrine of Amana"){
-                //     std::cout<<enemy_index<<'\n';
-                // }
                 deck_index+=1;
                 if(deck_index==enemy_deck.size()){//Guarantees an even distribution of enemies
                     //This should only happen on single deck scenario
                     std::shuffle(enemy_deck.begin(),enemy_deck.end(),deck_shuffler);
                     deck_index=0;
+                    reshuffles+=1;
                 }
                 if(!slot.boss) slot.index=enemy_index;
             }
@@ -1075,14 +1082,53 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
             if(slot.boss){
                 const auto& boss_variation = enemy_table.bosses[slot.index].variations.front();
                 random_generator.discard(1);//Make it so replacing the enemy for a boss doesn't change the generator state
-                slot.enemy = cboyo::random::element(boss_variation.instances,random_generator);
-                slot.enemy.regist.enemy_id=slot.boss_id;//Replace by the created boss
+                slot.variation = 0;
+                slot.instance = cboyo::random::vindex(boss_variation.instances,random_generator);
             }else{
                 const auto& variations = enemy_table.enemies[slot.index].variations;
-                const auto& instances  = cboyo::random::element(variations,random_generator).instances;
-                slot.enemy = cboyo::random::element(instances,random_generator);
+                slot.variation = cboyo::random::vindex(variations,random_generator);
+                slot.instance  = cboyo::random::vindex(variations[slot.variation].instances,random_generator);
             }
         }
+        plan.maps.push_back({m,boss_index,std::move(enemy_slots),std::move(enemies_id),reshuffles});
+    }
+    return true;
+}
+const EnemyInstance& slot_instance(const EnemyTable& enemy_table,const EnemySlot& slot){
+    const auto& type = slot.boss?enemy_table.bosses[slot.index]:enemy_table.enemies[slot.index];
+    return type.variations[slot.variation].instances[slot.instance];
+}
+bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config& config,const EnemyPlan& plan){
+    u64 regist_start_row = 1000000000u;
+    std::unordered_map<s32,s32> enemy_id_mapping;
+
+    float hp_scaling = config.enemy_hp_scaling/100.f;
+    float dmg_scaling = config.enemy_dmg_scaling/100.f;
+    for(const auto& map_plan:plan.maps){
+        auto& map = map_data[map_plan.map_index];
+        auto& generator = map.generator;
+        struct EnemyEntry{
+            EnemyInstance enemy;
+            size_t boss_slot;
+            bool replace;
+            bool boss;
+        };
+        std::vector<EnemyEntry> enemy_slots;
+        enemy_slots.reserve(map_plan.slots.size());
+        for(const auto& slot:map_plan.slots){
+            enemy_slots.push_back({slot.replace?slot_instance(enemy_table,slot):EnemyInstance{},slot.boss_slot,slot.replace,slot.boss});
+        }
+        //Create the necessary bosses, in the order they first show up
+        std::vector<s32> new_bosses_ids(map_plan.boss_index.size(),0);
+        for(auto& slot:enemy_slots){
+            if(!slot.replace||!slot.boss)continue;
+            if(new_bosses_ids[slot.boss_slot]==0){
+                s32 new_boss_id = create_new_boss(enemy_table,map_plan.boss_index[slot.boss_slot],1.f,1.f,1.f,1.f);
+                if(new_boss_id==0) return false;
+                new_bosses_ids[slot.boss_slot]=new_boss_id;
+            }
+            slot.enemy.regist.enemy_id=new_bosses_ids[slot.boss_slot];//Replace by the created boss
+        }
         //Scaling
         if(config.enemy_scaling&&map.enemy_scaling<2000){//Only scale certain zones
             enemy_id_mapping.clear();
@@ -1091,10 +1137,11 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
             for(auto& slot : enemy_slots){
                 if(!slot.replace)continue;
                 if(slot.boss){
-                    auto iter = enemy_id_mapping.find(slot.boss_id);
+                    auto boss_id = new_bosses_ids[slot.boss_slot];
+                    auto iter = enemy_id_mapping.find(boss_id);
                     if(iter==enemy_id_mapping.end()){//Balance boss if not already balanced
                         balance_enemy(enemy_table,slot.enemy.regist.enemy_id,hp_target,hp_scaling,dmg_target,dmg_scaling);
-                        enemy_id_mapping[slot.boss_id]=slot.boss_id;
+                        enemy_id_mapping[boss_id]=boss_id;
                     }
                 }else{
                     auto enemy_id = slot.enemy.regist.enemy_id;
@@ -1152,66 +1199,64 @@ bool randomize_enemies(GameData& map_data,EnemyTable& enemy_table,const Config&
     return true;
 }
 
-void remove_invaders_summons_invis(GameData& map_data,const Config& config){
-    for(auto& map:map_data){
-        MapSetting settings = get_settings(map.id,config);
-        if(!settings.randomize) continue;
-        auto& generator = map.generator;
-        [[maybe_unused]] size_t deleted_count=0;
-        for(size_t j = 0;j<generator.data.size();j++){
-            auto entity_type = map.entity_info[generator.row_info[j].row].type;
-            bool need_to_delete = false;
-                 if(entity_type==EntityType::INVADER&&config.remove_invaders) need_to_delete=true;
-            else if(entity_type==EntityType::SUMMON &&config.remove_summons)  need_to_delete=true;
-            else if(entity_type==EntityType::HOLLOW &&config.remove_invis)    need_to_delete=true;
-            if(need_to_delete){
-                delete_entry(j,map.generator);
-                j-=1;
-                deleted_count+=1;
-            }
+void remove_invaders_summons_invis(MapData& map,const Config& config){
+    auto& generator = map.generator;
+    [[maybe_unused]] size_t deleted_count=0;
+    for(size_t j = 0;j<generator.data.size();j++){
+        auto entity_type = map.entity_info[generator.row_info[j].row].type;
+        bool need_to_delete = false;
+             if(entity_type==EntityType::INVADER&&config.remove_invaders) need_to_delete=true;
+        else if(entity_type==EntityType::SUMMON &&config.remove_summons)  need_to_delete=true;
+        else if(entity_type==EntityType::HOLLOW &&config.remove_invis)    need_to_delete=true;
+        if(need_to_delete){
+            delete_entry(j,map.generator);
+            j-=1;
+            deleted_count+=1;
         }
     }
 }
-void npc_cloning(GameData& map_data,EnemyTable& enemy_table,const Config& config){
-    u64 regist_start_row = 1100000000u;
-    std::mt19937_64 random_generator;
-    random_generator.seed(config.seed);
-    auto npc_index = cboyo::random::vindex(enemy_table.npcs,random_generator);
-    for(auto& map:map_data){
-        auto& generator = map.generator;
-        //Change all NCPS to use the same model
-        for(size_t j = 0;j<generator.data.size();j++){
-            auto& entity_info = map.entity_info[generator.row_info[j].row];
-            auto entity_type = entity_info.type;
-            bool valid_entity = false;
-            if(entity_type==EntityType::NPC)valid_entity=true;
-            if(!valid_entity)continue;
-            //Make a copy cause we need to change the draw group
-            auto random_enemy = enemy_table.npcs[npc_index];
-            if(map.code=="m10_16_00_00"){
-                random_enemy=enemy_table.straid;
-            }
-            //Change the enemy
-            //Dont change ai for NPCS
-            //Changing their item lot is necessary though
-            for(size_t k =0;k<map.regist.data.size();k++){
-                if(map.regist.row_info[k].row==generator.data[j].generator_regist_param){
-                    auto id = map.regist.data[k].enemy_id;
-                    auto e_params = find_enemy_param(enemy_table.enemy_params,id);
-                    // std::cout<<"Setting up: "<<id<<" "<<e_params.item_lot<<'\n';
-                    //40 means no item
-                    if(e_params.item_lot!=40) generator.data[j].item_lot_id[0]=e_params.item_lot;
-                    break;
-                }
+size_t count_npcs(const MapData& map){
+    size_t count = 0;
+    for(const auto& row:map.generator.row_info){
+        if(map.entity_info[row.row].type==EntityType::NPC) count+=1;
+    }
+    return count;
+}
+//Every NPC in the map becomes npcs[npc_index], their registers are added from regist_start_row
+void npc_cloning(MapData& map,const EnemyTable& enemy_table,size_t npc_index,u64 regist_start_row){
+    auto& generator = map.generator;
+    //Change all NCPS to use the same model
+    for(size_t j = 0;j<generator.data.size();j++){
+        auto& entity_info = map.entity_info[generator.row_info[j].row];
+        auto entity_type = entity_info.type;
+        bool valid_entity = false;
+        if(entity_type==EntityType::NPC)valid_entity=true;
+        if(!valid_entity)continue;
+        //Make a copy cause we need to change the draw group
+        auto random_enemy = enemy_table.npcs[npc_index];
+        if(map.code=="m10_16_00_00"){
+            random_enemy=enemy_table.straid;
+        }
+        //Change the enemy
+        //Dont change ai for NPCS
+        //Changing their item lot is necessary though
+        for(size_t k =0;k<map.regist.data.size();k++){
+            if(map.regist.row_info[k].row==generator.data[j].generator_regist_param){
+                auto id = map.regist.data[k].enemy_id;
+                auto e_params = find_enemy_param(enemy_table.enemy_params,id);
+                // std::cout<<"Setting up: "<<id<<" "<<e_params.item_lot<<'\n';
+                //40 means no item
+                if(e_params.item_lot!=40) generator.data[j].item_lot_id[0]=e_params.item_lot;
+                break;
             }
-            generator.data[j].generator_regist_param=(u32)regist_start_row;
-            //Change the draw group so it actually shows up
-            random_enemy.regist.draw_group=entity_info.draw_group;
-            random_enemy.regist.display_group=entity_info.display_group;
-            //Add the register of the enemy
-            add_entry(regist_start_row,random_enemy.regist,map.regist);
-            regist_start_row+=1;
         }
+        generator.data[j].generator_regist_param=(u32)regist_start_row;
+        //Change the draw group so it actually shows up
+        random_enemy.regist.draw_group=entity_info.draw_group;
+        random_enemy.regist.display_group=entity_info.display_group;
+        //Add the register of the enemy
+        add_entry(regist_start_row,random_enemy.regist,map.regist);
+        regist_start_row+=1;
     }
 }
 
@@ -1233,6 +1278,7 @@ struct BossHolder{
         size_t boss_table_index;
         size_t arena_index;
         size_t arena_boss_index;
+        size_t instance{SIZE_MAX};//Picked by select_bosses, SIZE_MAX when the generator is not replaced
         bool skip;
     };
     size_t huge=0,big=0,mid=0;
@@ -1240,9 +1286,10 @@ struct BossHolder{
 
     bool skip_mid=false,skip_big=false,skip_all=false;
     std::vector<BossReplacementData> rando_data;
+    std::vector<std::string> warnings;
 };
 
-BossHolder calculate_boss_holder(EnemyTable& enemy_table,const Config& config){
+BossHolder calculate_boss_holder(const EnemyTable& enemy_table,const Config& config){
     BossHolder holder;
     [[maybe_unused]] size_t bosses_to_randomize = 0;
     for(const auto& arena:enemy_table.boss_arenas){
@@ -1256,9 +1303,9 @@ BossHolder calculate_boss_holder(EnemyTable& enemy_table,const Config& config){
         else if(arena.size==2) holder.big +=boss_count;
         else                   holder.mid +=boss_count;
     }
-    auto& bosses = enemy_table.bosses;
+    const auto& bosses = enemy_table.bosses;
     for(size_t i = 0;i<bosses.size();i++){
-        auto& b = bosses[i];
+        const auto& b = bosses[i];
         if(vector_contains(config.banned_enemies,(size_t)b.id)) continue;
         if(b.size>=3)      holder.huge_index.push_back(i);
         else if(b.size==2) holder.big_index.push_back(i);
@@ -1266,20 +1313,20 @@ BossHolder calculate_boss_holder(EnemyTable& enemy_table,const Config& config){
     }
     if(holder.mid_index.empty()&&holder.mid>0){
         holder.skip_mid=true;
-        std::cout<<"WARNING: No medium size bosses available, medium size boss arenas will be skipped during randomization\n";
+        holder.warnings.push_back("WARNING: No medium size bosses available, medium size boss arenas will be skipped during randomization\n");
     }
     if(holder.mid_index.empty()&&holder.big_index.empty()&&holder.big>0){
         holder.skip_big=true;
-        std::cout<<"WARNING: No big/medium size bosses available, big size boss arenas will be skipped during randomization\n";
+        holder.warnings.push_back("WARNING: No big/medium size bosses available, big size boss arenas will be skipped during randomization\n");
     }
     if(holder.mid_index.empty()&&holder.big_index.empty()&&holder.big_index.empty()){
         holder.skip_all=true;
-        std::cout<<"WARNING: No bosses available, boss arenas will be skipped during randomization\n";
+        holder.warnings.push_back("WARNING: No bosses available, boss arenas will be skipped during randomization\n");
     }
     return holder;
 }
 
-BossHolder generate_boss_deck(EnemyTable& enemy_table,const Config& config,std::mt19937_64& random_generator){
+BossHolder generate_boss_deck(const EnemyTable& enemy_table,const Config& config,std::mt19937_64& random_generator){
     auto holder = calculate_boss_holder(enemy_table,config);
     if(holder.skip_all) return holder;
 
@@ -1341,13 +1388,33 @@ std::vector<u64> get_random_boss_ids(const BossArena& arena,EnemyTable& enemy_ta
     return replacement_ids;
 }
 
-void randomize_bosses(GameData& map_data,EnemyTable& enemy_table,const Config& config){
+//Boss deck plus the instance of every replaced generator, drawn in the same order randomize_bosses used to
+BossHolder select_bosses(const GameData& map_data,const EnemyTable& enemy_table,const Config& config){
+    std::mt19937_64 random_generator(config.seed);
+    BossHolder holder = generate_boss_deck(enemy_table,config,random_generator);
+    if(holder.skip_all) return holder;
+    for(auto& entry:holder.rando_data){
+        if(entry.skip) continue;
+        const auto& arena = enemy_table.boss_arenas[entry.arena_index];
+        auto map_index = get_map(map_data,arena.map_id);
+        if(map_index>=map_data.size()) continue;
+        if(!get_entry_ptr(map_data[map_index].generator,arena.ids[entry.arena_boss_index])) continue;
+        const auto& variation = enemy_table.bosses[entry.boss_table_index].variations.front();
+        entry.instance = cboyo::random::vindex(variation.instances,random_generator);
+    }
+    return holder;
+}
+//Whether randomize_bosses puts the entry's boss in, the map, generator and instance select_bosses looked for all exist
+bool boss_placed(const EnemyTable& enemy_table,const BossHolder::BossReplacementData& entry){
+    return !entry.skip&&entry.instance<enemy_table.bosses[entry.boss_table_index].variations.front().instances.size();
+}
+
+//boss_log gets the cheatsheet text of the replacements
+void randomize_bosses(GameData& map_data,EnemyTable& enemy_table,const Config& config,const BossHolder& holder,std::string& boss_log){
     std::stringstream log;
-    common::boss_log.clear();
+    boss_log.clear();
     u64 regist_start_row = 1200000000u;
     std::vector<EnemyType>& bosses=enemy_table.bosses;
-    std::mt19937_64 random_generator(config.seed);
-    BossHolder holder = generate_boss_deck(enemy_table,config,random_generator);
     if(holder.skip_all){
         std::cout<<"SKIPPING BOSS RANDOMIZATION\n";
         return;
@@ -1383,7 +1450,11 @@ void randomize_bosses(GameData& map_data,EnemyTable& enemy_table,const Config& c
 
         log<<row<<" REPLACEMENT:"<<boss.id<<" "<<boss.name<<'\n';
         const auto& variation = boss.variations.front();
-        auto random_enemy = cboyo::random::element(variation.instances,random_generator);
+        if(entry.instance>=variation.instances.size()){
+            log<<"No instance picked for: "<<row<<'\n';
+            continue;
+        }
+        auto random_enemy = variation.instances[entry.instance];
         if(arena.name=="Twin Dragonrider"&&twins&&row==864){ //864 is the bow guy
             auto ep = find_enemy_param(enemy_table.enemy_params,random_enemy.regist.enemy_id);
             // std::cout<<ep.ng_hp<<" "<<ep.behavior_id<<" "<<ep.id<<" "<<ep.dmg_mult<<"\n";
@@ -1439,7 +1510,7 @@ void randomize_bosses(GameData& map_data,EnemyTable& enemy_table,const Config& c
             float og_dmg = enemy_table.ngp_dmg_scaling[ptr->dmg_table]/100.f;
             float hp_scaling=linear_interpolation(ptr->hp,arena.hp_target,1.f)/ptr->hp;
             float dmg_ratio = og_dmg/arena.dmg_target;
-            float dmg_scaling= linear_interpolation(1.f,std::powf(dmg_ratio,3.f),1.f);
+            float dmg_scaling= linear_interpolation(1.f,std::pow(dmg_ratio,3.f),1.f);
             auto boss_new_id = create_new_boss(enemy_table,entry.boss_table_index,hp_scaling,dmg_scaling,1.f,0.f);
             if(boss_new_id==0) continue;
             random_enemy.regist.enemy_id=boss_new_id;
@@ -1451,7 +1522,7 @@ void randomize_bosses(GameData& map_data,EnemyTable& enemy_table,const Config& c
             float og_dmg = enemy_table.ngp_dmg_scaling[ptr->dmg_table]/100.f;
             float hp_scaling=linear_interpolation(ptr->hp,arena.hp_target,hp_scale)/ptr->hp;
             float dmg_ratio = og_dmg/arena.dmg_target;
-            float dmg_scaling= linear_interpolation(1.f,std::powf(dmg_ratio,2.66f),dmg_scale);
+            float dmg_scaling= linear_interpolation(1.f,std::pow(dmg_ratio,2.66f),dmg_scale);
             float og_def = ptr->defense;
             float def_scaling = linear_interpolation(og_def,arena.def_target,hp_scale)/ptr->defense;
             auto boss_new_id = create_new_boss(enemy_table,entry.boss_table_index,hp_scaling,dmg_scaling,def_scaling,0.f);
@@ -1502,99 +1573,222 @@ void randomize_bosses(GameData& map_data,EnemyTable& enemy_table,const Config& c
         regist_start_row+=1;
     }
     if(config.write_cheatsheet){
-        common::boss_log=log.str();
-    }
-}
-
-void set_belfry_rush(GameData& map_data,const Config& config){
-    for(auto&map:map_data){
-        if(map.id==10160000){
-            if(!get_settings(map.id,config).randomize)continue;
-            auto& generator = map.generator;
-            u32 event_id = 116020093;//116020092 is the gargoyles fog gate
-            for(size_t j = 0;j<generator.data.size();j++){
-                auto& gen_data = generator.data[j];
-                auto row = generator.row_info[j].row;
-                if(row==8000){
-                    gen_data.death_event_id=event_id;
-                }else if(row==8001){
-                    gen_data.death_event_id=event_id+1;
-                    gen_data.activation_event_id[0]=event_id;
-                }else if(row==8002){
-                    gen_data.death_event_id=event_id+2;
-                    gen_data.activation_event_id[0]=event_id+1;
-                }else if(row==8003){
-                    gen_data.death_event_id=event_id+3;
-                    gen_data.activation_event_id[0]=event_id+2;
-                }else if(row==8004){
-                    gen_data.activation_event_id[0]=event_id+3;
-                }
-            }
+        boss_log=log.str();
+    }
+}
+
+//Belfry Luna map only
+void set_belfry_rush(MapData& map){
+    auto& generator = map.generator;
+    u32 event_id = 116020093;//116020092 is the gargoyles fog gate
+    for(size_t j = 0;j<generator.data.size();j++){
+        auto& gen_data = generator.data[j];
+        auto row = generator.row_info[j].row;
+        if(row==8000){
+            gen_data.death_event_id=event_id;
+        }else if(row==8001){
+            gen_data.death_event_id=event_id+1;
+            gen_data.activation_event_id[0]=event_id;
+        }else if(row==8002){
+            gen_data.death_event_id=event_id+2;
+            gen_data.activation_event_id[0]=event_id+1;
+        }else if(row==8003){
+            gen_data.death_event_id=event_id+3;
+            gen_data.activation_event_id[0]=event_id+2;
+        }else if(row==8004){
+            gen_data.activation_event_id[0]=event_id+3;
         }
     }
 }
 
-void easy_congregation(GameData& map_data,const Config& config){
+//Tseldora map only
+void easy_congregation(MapData& map){
     std::vector<u64> congregation_ids{2520,2521,2522,2530,2531,2532,2533,2534};
-    for(auto& map:map_data){
-        if(map.id!=10140000)continue;
-        MapSetting settings = get_settings(map.id,config);
-        if(!settings.randomize) continue;
-        auto& generator = map.generator;
-        [[maybe_unused]] size_t deleted_count=0;
-        for(size_t j = 0;j<generator.data.size();j++){
-            auto row = generator.row_info[j].row;
-            if(vector_contains(congregation_ids,row)){
-                delete_entry(j,map.generator);
-                j-=1;
-                deleted_count+=1;
-            }
+    auto& generator = map.generator;
+    [[maybe_unused]] size_t deleted_count=0;
+    for(size_t j = 0;j<generator.data.size();j++){
+        auto row = generator.row_info[j].row;
+        if(vector_contains(congregation_ids,row)){
+            delete_entry(j,map.generator);
+            j-=1;
+            deleted_count+=1;
         }
     }
 }
 
-void reposition_enemies(GameData& map_data,EnemyTable& enemy_table,const Config& config){
+void reposition_enemies(MapData& map,const EnemyTable& enemy_table){
     const auto& repos = enemy_table.reposition;
-    for(auto& map:map_data){
-        MapSetting settings = get_settings(map.id,config);
-        if(!settings.randomize) continue;
-        auto range = repos.equal_range(map.id);
-        for (auto it = range.first; it != range.second; ++it){
-            // std::cout << it->first << ' ' << it->second.enemy_row << '\n';
-            EnemyRepositioning repo_data = it->second;
-            auto& location = map.location;
-            for(size_t j = 0;j<location.data.size();j++){
-                if(location.row_info[j].row==(u64)repo_data.enemy_row){
-                    // std::cout<<"Repositioned\n";
-                    location.data[j].position[0]=repo_data.position[0];
-                    location.data[j].position[1]=repo_data.position[1];
-                    location.data[j].position[2]=repo_data.position[2];
-                    break;
-                }
+    auto range = repos.equal_range(map.id);
+    for (auto it = range.first; it != range.second; ++it){
+        // std::cout << it->first << ' ' << it->second.enemy_row << '\n';
+        EnemyRepositioning repo_data = it->second;
+        auto& location = map.location;
+        for(size_t j = 0;j<location.data.size();j++){
+            if(location.row_info[j].row==(u64)repo_data.enemy_row){
+                // std::cout<<"Repositioned\n";
+                location.data[j].position[0]=repo_data.position[0];
+                location.data[j].position[1]=repo_data.position[1];
+                location.data[j].position[2]=repo_data.position[2];
+                break;
             }
         }
     }
 }
 
-void full_random(GameData& map_data,EnemyTable& enemy_table,const Config& config){
+//Every random decision of a seed, full_random only applies them
+struct EnemyRandoPlan{
+    Config config;
+    bool enemies_selected{false};
+    EnemyPlan enemies;
+    BossHolder bosses;
+    size_t npc_index{0};
+};
+//Made from the unchanged maps, the enemy stage ran first and boss arenas are never removed so the picks are the same
+EnemyRandoPlan plan_enemy_rando(const GameData& map_data,const EnemyTable& enemy_table,const Config& config){
+    EnemyRandoPlan plan;
+    plan.config = config;
     if(config.randomize_enemies){
-        randomize_enemies(map_data,enemy_table,config);
+        plan.enemies_selected = select_enemies(map_data,enemy_table,config,plan.enemies);
+        for(const auto& warning:plan.enemies.warnings) std::cout<<warning;
+    }
+    if(config.replace_npcs){
+        std::mt19937_64 random_generator;
+        random_generator.seed(config.seed);
+        plan.npc_index = cboyo::random::vindex(enemy_table.npcs,random_generator);
+    }
+    if(config.randomize_bosses){
+        plan.bosses = select_bosses(map_data,enemy_table,config);
+        for(const auto& warning:plan.bosses.warnings) std::cout<<warning;
+    }
+    return plan;
+}
+
+//generators and arenas sections of the spoiler log, from the plan and the unchanged maps
+void write_enemy_spoiler(const GameData& map_data,const EnemyTable& enemy_table,const EnemyRandoPlan& plan,spoiler_log::Writer& log){
+    log.field("enemy_seed",plan.config.seed);
+    if(plan.enemies_selected){
+        log.section("generators");
+        for(const auto& map_plan:plan.enemies.maps){
+            const auto& map = map_data[map_plan.map_index];
+            for(size_t j = 0;j<map_plan.slots.size();j++){
+                const auto& slot = map_plan.slots[j];
+                if(!slot.replace) continue;
+                const auto& type = slot.boss?enemy_table.bosses[slot.index]:enemy_table.enemies[slot.index];
+                const auto& variation = type.variations[slot.variation];
+                log.begin_record();
+                log.field("map",map.code);
+                log.field("generator",map.generator.row_info[j].row);
+                log.field("enemy",type.id);
+                log.field("name",type.name);
+                log.field("variation",variation.name);
+                log.field("roaming_boss",slot.boss);
+                log.end_record();
+            }
+        }
+    }
+    if(plan.config.randomize_bosses&&!plan.bosses.skip_all){
+        log.section("arenas");
+        for(const auto& entry:plan.bosses.rando_data){
+            const auto& arena = enemy_table.boss_arenas[entry.arena_index];
+            auto map_index = get_map(map_data,arena.map_id);
+            log.begin_record();
+            log.field("arena",arena.name);
+            if(map_index<map_data.size()) log.field("map",map_data[map_index].code);
+            log.field("generator",arena.ids[entry.arena_boss_index]);
+            log.field("skipped",entry.skip);
+            if(!entry.skip){
+                const auto& boss = enemy_table.bosses[entry.boss_table_index];
+                log.field("boss",boss.id);
+                log.field("name",boss.name);
+            }
+            log.end_record();
+        }
+    }
+}
+
+//Each stage says which map params and tables it reads and writes, the scheduler orders conflicting ones like the old fixed order
+//and runs the rest at the same time. Enemies and bosses carry generators and register rows from one map to the next so they stay whole
+void full_random(GameData& map_data,EnemyTable& enemy_table,const EnemyRandoPlan& plan,std::string& boss_log,const std::filesystem::path& cheatsheet_folder,size_t threads){
+    const auto& config = plan.config;
+    auto generator = [](const MapData& map){return "generator "+map.code;};
+    auto regist    = [](const MapData& map){return "regist "+map.code;};
+    auto location  = [](const MapData& map){return "location "+map.code;};
+    const std::string enemy_params = "enemy params";
+    stages::Scheduler scheduler;
+    if(config.randomize_enemies){
+        stages::Resources resources;
+        for(const auto& map:map_data){
+            resources.writes.push_back(generator(map));
+            resources.writes.push_back(regist(map));
+        }
+        resources.writes.push_back(enemy_params);
+        scheduler.add("randomize enemies","randomize enemies",[&](){
+            if(plan.enemies_selected) randomize_enemies(map_data,enemy_table,config,plan.enemies);
+            return true;
+        },resources);
     }
     if(config.remove_invaders||config.remove_summons||config.remove_invis){
-        remove_invaders_summons_invis(map_data,config);
+        for(auto& map:map_data){
+            if(!get_settings(map.id,config).randomize) continue;
+            scheduler.add("remove invaders summons invis","remove "+map.code,[&map,&config](){
+                remove_invaders_summons_invis(map,config);
+                return true;
+            },{{},{generator(map)}});
+        }
     }
     if(config.replace_npcs){
-        npc_cloning(map_data,enemy_table,config);
+        auto npc_index = plan.npc_index;
+        u64 regist_start_row = 1100000000u;
+        for(auto& map:map_data){
+            //No stage adds or removes NPC generators, so the first row of every map is known up front
+            auto npcs = count_npcs(map);
+            if(npcs==0) continue;
+            scheduler.add("npc cloning","npc cloning "+map.code,[&map,&enemy_table,npc_index,regist_start_row](){
+                npc_cloning(map,enemy_table,npc_index,regist_start_row);
+                return true;
+            },{{enemy_params},{generator(map),regist(map)}});
+            regist_start_row+=npcs;
+        }
     }
     if(config.randomize_bosses){
-        randomize_bosses(map_data,enemy_table,config);
-        if(config.boss_balance.belfry_rush){
-            set_belfry_rush(map_data,config);
+        stages::Resources resources;
+        for(const auto& arena:enemy_table.boss_arenas){
+            auto map_index = get_map(map_data,arena.map_id);
+            if(map_index>=map_data.size()) continue;
+            resources.writes.push_back(generator(map_data[map_index]));
+            resources.writes.push_back(regist(map_data[map_index]));
+        }
+        resources.writes.push_back(enemy_params);
+        resources.writes.push_back("boss log");
+        scheduler.add("randomize bosses","randomize bosses",[&](){
+            randomize_bosses(map_data,enemy_table,config,plan.bosses,boss_log);
+            return true;
+        },resources);
+        for(auto& map:map_data){
+            if(!get_settings(map.id,config).randomize) continue;
+            if(config.boss_balance.belfry_rush&&map.id==10160000){
+                scheduler.add("belfry rush","belfry rush",[&map](){set_belfry_rush(map);return true;},{{},{generator(map)}});
+            }
+            if(config.boss_balance.easy_congregation&&map.id==10140000){
+                scheduler.add("easy congregation","easy congregation",[&map](){easy_congregation(map);return true;},{{},{generator(map)}});
+            }
+            scheduler.add("reposition enemies","reposition "+map.code,[&map,&enemy_table](){
+                reposition_enemies(map,enemy_table);
+                return true;
+            },{{},{location(map)}});
         }
-        if(config.boss_balance.easy_congregation){
-            easy_congregation(map_data,config);
+    }
+    if(!scheduler.run(threads)){
+        std::cout<<"WARNING: Some enemy randomization stages failed\n";
+    }
+    if(config.write_stage_graph){
+        scheduler.print_timings(std::cout);
+        if(!std::filesystem::exists(cheatsheet_folder)){
+            std::filesystem::create_directories(cheatsheet_folder);
         }
-        reposition_enemies(map_data,enemy_table,config);
+        std::ofstream dot{cheatsheet_folder/("stages"+time_string_now()+"_"+std::to_string(config.seed)+".dot")};
+        if(dot) dot<<scheduler.to_dot();
+        else std::cout<<"Failed to write enemy stage graph\n";
     }
 }
 
@@ -1612,36 +1806,47 @@ bool load_map_data(GameData& map_data){
     return true;
 }
 
-bool write_final_params(GameData& data,EnemyTable& enemy_table,bool devmode){
+//Every param file of the run by name, all of them can be linked from a cache
+std::vector<output_cache::Contents> final_params(GameData& data,EnemyTable& enemy_table){
     const std::string generator_prefix{"generatorparam_"};
     const std::string location_prefix{"generatorlocation_"};
     const std::string register_prefix{"generatorregistparam_"};
     const std::string extension{".param"};
 
-    if(!std::filesystem::exists(paths::out_folder)){
-        std::filesystem::create_directories(paths::out_folder);
-    }
+    std::vector<output_cache::Contents> params;
+    params.reserve(data.size()*3+1);
     for(auto& map:data){
-        auto generator_out_path = paths::out_folder/(generator_prefix+map.code+extension);
-        write_to_file_binary(generator_out_path,write_param_file(map.generator));
-        auto regist_out_path = paths::out_folder/(register_prefix+map.code+extension);
-        write_to_file_binary(regist_out_path,write_param_file(map.regist));
-        auto location_out_path = paths::out_folder/(location_prefix+map.code+extension);
-        write_to_file_binary(location_out_path,write_param_file(map.location));
+        params.push_back({generator_prefix+map.code+extension,write_param_file(map.generator),true});
+        params.push_back({register_prefix+map.code+extension,write_param_file(map.regist),true});
+        params.push_back({location_prefix+map.code+extension,write_param_file(map.location),true});
+    }
+    params.push_back({"EnemyParam.param",write_param_file(enemy_table.enemy_params),true});
+    return params;
+}
+//With a coordinator the params are handed to it and written when it commits
+void write_final_params(const std::vector<output_cache::Contents>& params,const std::filesystem::path& out_folder,bool devmode,param_writes::Coordinator* writes){
+    if(writes){
+        for(const auto& param:params) writes->submit_file(module_name,param.name,param.data);
+    }else{
+        if(!std::filesystem::exists(out_folder)){
+            std::filesystem::create_directories(out_folder);
+        }
+        for(const auto& param:params) write_to_file_binary(out_folder/param.name,param.data);
     }
-    write_to_file_binary(paths::out_folder/"EnemyParam.param",write_param_file(enemy_table.enemy_params));
 
     if(devmode){
         const std::filesystem::path out_folder_test{"C:\\Program Files (x86)\\Steam\\steamapps\\common\\Dark Souls II Scholar of the First Sin\\Game\\mods\\mod_testing\\Param"};
-        for(auto& map:data){
-            auto generator_out_path = out_folder_test/(generator_prefix+map.code+extension);
-            write_to_file_binary(generator_out_path,write_param_file(map.generator));
-            auto regist_out_path = out_folder_test/(register_prefix+map.code+extension);
-            write_to_file_binary(regist_out_path,write_param_file(map.regist));
-            auto location_out_path = out_folder_test/(location_prefix+map.code+extension);
-            write_to_file_binary(location_out_path,write_param_file(map.location));
-        }
-        write_to_file_binary(std::filesystem::path{"C:\\Program Files (x86)\\Steam\\steamapps\\common\\Dark Souls II Scholar of the First Sin\\Game\\mods\\mod_testing\\Param\\EnemyParam.param"},write_param_file(enemy_table.enemy_params));
+        for(const auto& param:params) write_to_file_binary(out_folder_test/param.name,param.data);
+    }
+}
+//Cached params go to the coordinator when the run has one, otherwise straight to the out folder
+bool serve_cached(output_cache::Cache& cache,const std::string& key,const Run& run){
+    if(!run.writes) return cache.serve(key,run.out_folder);
+    std::vector<output_cache::File> files;
+    if(!cache.lookup(key,files)) return false;
+    for(const auto& file:files){
+        if(file.link) run.writes->submit_link(module_name,file.path.filename().string(),file.path);
+        else run.writes->submit_file(module_name,file.path.filename().string(),get_file_contents_binary(file.path));
     }
     return true;
 }
@@ -1655,7 +1860,7 @@ void restore_zone_limit_defaults(Config& config){
     }
 }
 
-std::string generate_config_file(Config& config){
+std::string generate_config_file(const Config& config){
     std::stringstream ss;
     ss<<"#VERSION 0\n";
     ss<<"#INV_REPLACE "<<config.replace_invaders<<"\n";
@@ -1665,6 +1870,7 @@ std::string generate_config_file(Config& config){
     ss<<"#NPC_CLONING "<<config.replace_npcs<<"\n";
     ss<<"#SHUFFLE_TYPE "<<config.enemy_shuffling<<'\n';
     ss<<"#CHEATSHEET "<<config.write_cheatsheet<<'\n';
+    ss<<"#STAGE_GRAPH "<<config.write_stage_graph<<'\n';
 
     ss<<"#ENEMY_RANDO "<<config.randomize_enemies<<"\n";
     ss<<"#ENEMY_MIMIC "<<config.randomize_mimics<<"\n";
@@ -1724,7 +1930,8 @@ void write_configfile(Config& config){
     }
 }
 
-bool read_configfile(Config& config){
+//Defaults, then whatever the stream overrides
+bool read_config(std::istream& file,Config& config){
     config.randomize_enemies=true;
     config.randomize_mimics=true;
     config.randomize_lizards=true;
@@ -1764,7 +1971,8 @@ bool read_configfile(Config& config){
     config.remove_summons=true;
     config.replace_npcs=true;
     config.write_cheatsheet=true;
-    config.seed=cboyo::random::integer<u64>(0u,999999999999999u,cboyo::random::m_gen);
+    config.write_stage_graph=false;
+    config.seed=cboyo::random::new_seed();
     config.banned_enemies = {2130,2131,2261,6000};
     for(const auto& entry:common::map_names){
         MapSetting s;
@@ -1775,7 +1983,6 @@ bool read_configfile(Config& config){
         config.map_settings.push_back(s);
     }
     restore_zone_limit_defaults(config);
-    std::ifstream file(paths::configfile);
     std::string line;
     while(cboyo::parse::getline(file,line)){
         std::string_view view = line;
@@ -1815,6 +2022,7 @@ bool read_configfile(Config& config){
         else if(command=="#NPC_CLONING")config.replace_npcs=value1;
         else if(command=="#SHUFFLE_TYPE")config.enemy_shuffling=(u32)value1;
         else if(command=="#CHEATSHEET")config.write_cheatsheet=value1;
+        else if(command=="#STAGE_GRAPH")config.write_stage_graph=value1;
 
         else if(command=="#ENEMY_RANDO" )config.randomize_enemies=value1;
         else if(command=="#ENEMY_MIMIC" )config.randomize_mimics=value1;
@@ -1868,19 +2076,111 @@ bool read_configfile(Config& config){
     return true;
 }
 
+bool read_configfile(Config& config){
+    std::ifstream file(paths::configfile);
+    return read_config(file,config);
+}
 
-void write_cheatsheet(Config& config){
-    if(!std::filesystem::exists(paths::cheatsheet_folder)){
-        std::filesystem::create_directories(paths::cheatsheet_folder);
+//Plan files keep the enemy config as text in "ECFG" and the decisions in "ENMY"
+std::string encode_enemy_plan(const EnemyRandoPlan& plan){
+    plan_file::Writer out;
+    out.u(plan.enemies_selected);
+    out.u(plan.enemies.maps.size());
+    for(const auto& map_plan:plan.enemies.maps){
+        out.u(map_plan.map_index);
+        out.u(map_plan.boss_index.size());
+        for(auto index:map_plan.boss_index) out.u(index);
+        out.u(map_plan.slots.size());
+        for(const auto& slot:map_plan.slots){
+            out.u((u64)slot.replace|((u64)slot.boss<<1));
+            if(!slot.replace) continue;
+            out.u(slot.index);
+            if(slot.boss) out.u(slot.boss_slot);
+            else          out.u(slot.variation);
+            out.u(slot.instance);
+        }
+    }
+    out.u(plan.bosses.skip_all);
+    out.u(plan.bosses.rando_data.size());
+    for(const auto& entry:plan.bosses.rando_data){
+        out.u(entry.arena_index);
+        out.u(entry.arena_boss_index);
+        out.u(entry.skip);
+        if(entry.skip) continue;
+        out.u(entry.boss_table_index);
+        out.u(entry.instance==SIZE_MAX?0:entry.instance+1);
+    }
+    out.u(plan.npc_index);
+    return out.data;
+}
+//Indices are checked against the loaded tables, a plan made with other data files is refused
+bool decode_enemy_plan(std::string_view data,const GameData& map_data,const EnemyTable& enemy_table,EnemyRandoPlan& plan){
+    plan_file::Reader in{data};
+    bool valid = true;
+    auto index = [&in,&valid](size_t size){
+        auto value = in.u();
+        if(value>=size) valid = false;
+        return valid?(size_t)value:0;
+    };
+    plan.enemies_selected = in.u()!=0;
+    plan.enemies.maps.resize(std::min<u64>(in.u(),map_data.size()));
+    for(auto& map_plan:plan.enemies.maps){
+        map_plan.map_index = index(map_data.size());
+        map_plan.boss_index.resize(std::min<u64>(in.u(),data.size()));
+        for(auto& boss:map_plan.boss_index) boss = index(enemy_table.bosses.size());
+        map_plan.slots.resize(std::min<u64>(in.u(),data.size()));
+        if(map_plan.slots.size()!=map_data[map_plan.map_index].generator.data.size()) valid = false;
+        for(auto& slot:map_plan.slots){
+            auto flags = in.u();
+            slot.replace = flags&1;
+            slot.boss = flags&2;
+            slot.index = slot.boss_slot = slot.variation = slot.instance = 0;
+            if(!slot.replace||!valid) continue;
+            const auto& types = slot.boss?enemy_table.bosses:enemy_table.enemies;
+            slot.index = index(types.size());
+            if(!valid) continue;
+            if(slot.boss) slot.boss_slot = index(map_plan.boss_index.size());
+            else          slot.variation = index(types[slot.index].variations.size());
+            if(!valid) continue;
+            slot.instance = index(types[slot.index].variations[slot.variation].instances.size());
+        }
+    }
+    plan.bosses.skip_all = in.u()!=0;
+    plan.bosses.rando_data.resize(std::min<u64>(in.u(),data.size()));
+    for(auto& entry:plan.bosses.rando_data){
+        entry.arena_index = index(enemy_table.boss_arenas.size());
+        if(!valid) break;
+        entry.arena_boss_index = index(enemy_table.boss_arenas[entry.arena_index].ids.size());
+        entry.skip = in.u()!=0;
+        if(entry.skip) continue;
+        entry.boss_table_index = index(enemy_table.bosses.size());
+        auto instance = in.u();
+        entry.instance = instance==0?SIZE_MAX:(size_t)instance-1;
+    }
+    plan.npc_index = plan.config.replace_npcs?index(enemy_table.npcs.size()):(size_t)in.u();
+    if(!in.ok||!in.done()){
+        std::cout<<"Enemy plan is damaged\n";
+        return false;
     }
-    std::ofstream cheatsheet{paths::cheatsheet_folder/("enemies"+time_string_now()+".txt")};
+    if(!valid){
+        std::cout<<"Enemy plan doesn't match the loaded enemy data\n";
+        return false;
+    }
+    return true;
+}
+
+void write_cheatsheet(const Config& config,const std::string& boss_log,const std::filesystem::path& folder){
+    if(!std::filesystem::exists(folder)){
+        std::filesystem::create_directories(folder);
+    }
+    std::ofstream cheatsheet{folder/("enemies"+time_string_now()+"_"+std::to_string(config.seed)+".txt")};
     if(cheatsheet){
         std::stringstream ss;
         cheatsheet<<"---CONFIGURATION FILE---\n";
         cheatsheet<<generate_config_file(config);
         if(config.randomize_bosses){
             cheatsheet<<"\n\n\n---BOSS CHEATSHEET---\n";
-            cheatsheet<<common::boss_log;
+            cheatsheet<<boss_log;
         }
     }else{
         std::cout<<"Failed to write enemy cheatsheet\n";
@@ -1905,18 +2205,299 @@ std::vector<EnemyIdName> get_bosstable(Data& data){
     return table;
 }
 
+//Seed search, only the selections a predicate needs are made and no param is touched
+bool is_enemy_predicate(const search::Predicate& predicate){
+    return predicate.kind=="boss"||predicate.kind=="roaming";
+}
+//Size classes group bosses like calculate_boss_holder does
+bool boss_matches(const EnemyType& boss,const std::string& value){
+    if(value=="huge") return boss.size>=3;
+    if(value=="big")  return boss.size==2;
+    if(value=="mid")  return boss.size<=1;
+    return boss.name==value;
+}
+bool boss_value_exists(const EnemyTable& enemy_table,const std::string& value){
+    if(value=="huge"||value=="big"||value=="mid") return true;
+    for(const auto& boss:enemy_table.bosses){
+        if(boss.name==value) return true;
+    }
+    return false;
+}
+size_t find_map_by_name(const GameData& map_data,const std::string& name){
+    for(size_t i = 0;i<map_data.size();i++){
+        if(map_data[i].name==name||map_data[i].code==name) return i;
+    }
+    return map_data.size();
+}
+bool validate_enemy_predicate(const Data& data,const search::Predicate& predicate){
+    if(!data.config.valid){
+        std::cout<<"Enemy randomizer data is not loaded, can't check: "<<predicate.text<<'\n';
+        return false;
+    }
+    const auto& enemy_table = *data.enemy_table;
+    if(predicate.kind=="boss"){
+        if(!data.config.randomize_bosses){
+            std::cout<<"Boss randomization is off in "<<paths::configfile<<", can't check: "<<predicate.text<<'\n';
+            return false;
+        }
+        bool arena_found = false;
+        for(const auto& arena:enemy_table.boss_arenas){
+            if(arena.name==predicate.subject) arena_found = true;
+        }
+        if(!arena_found){
+            std::cout<<"Unknown boss arena: "<<predicate.subject<<'\n';
+            return false;
+        }
+    }else{
+        if(!data.config.randomize_enemies||!data.config.roaming_boss){
+            std::cout<<"Roaming bosses are off in "<<paths::configfile<<", can't check: "<<predicate.text<<'\n';
+            return false;
+        }
+        if(find_map_by_name(*data.game_data,predicate.subject)>=data.game_data->size()){
+            std::cout<<"Unknown map: "<<predicate.subject<<'\n';
+            return false;
+        }
+        if(predicate.value=="none"||predicate.value=="any") return true;
+    }
+    if(!boss_value_exists(enemy_table,predicate.value)){
+        std::cout<<"Unknown boss: "<<predicate.value<<'\n';
+        return false;
+    }
+    return true;
+}
+bool check_enemy_predicates(const Data& data,uint64_t seed,const std::vector<search::Predicate>& predicates){
+    auto config = data.config;
+    config.seed = seed;
+    const auto& map_data = *data.game_data;
+    const auto& enemy_table = *data.enemy_table;
+    bool need_bosses = false,need_enemies = false;
+    for(const auto& predicate:predicates){
+        if(predicate.kind=="boss")    need_bosses = true;
+        if(predicate.kind=="roaming") need_enemies = true;
+    }
+    BossHolder holder;
+    if(need_bosses) holder = select_bosses(map_data,enemy_table,config);
+    EnemyPlan plan;
+    if(need_enemies&&!select_enemies(map_data,enemy_table,config,plan)) return false;
+    for(const auto& predicate:predicates){
+        if(!is_enemy_predicate(predicate)) continue;
+        bool match = false;
+        if(predicate.kind=="boss"){
+            for(const auto& entry:holder.rando_data){
+                if(!boss_placed(enemy_table,entry)||enemy_table.boss_arenas[entry.arena_index].name!=predicate.subject) continue;
+                if(boss_matches(enemy_table.bosses[entry.boss_table_index],predicate.value)) match = true;
+            }
+        }else{
+            size_t map_index = find_map_by_name(map_data,predicate.subject);
+            bool any_boss = false;
+            for(const auto& map_plan:plan.maps){
+                if(map_plan.map_index!=map_index) continue;
+                for(const auto& slot:map_plan.slots){
+                    if(!slot.replace||!slot.boss) continue;
+                    any_boss = true;
+                    if(predicate.value!="any"&&boss_matches(enemy_table.bosses[slot.index],predicate.value)) match = true;
+                }
+            }
+            if(predicate.value=="any")  match = any_boss;
+            if(predicate.value=="none") match = !any_boss;
+        }
+        if(!match) return false;
+    }
+    return true;
+}
+
+//What select_enemies does to one map over many seeds, one copy per worker merged at the end
+struct MapEnemyStats{
+    uint64_t seeds{0};//Seeds the map was randomized in
+    uint64_t slots{0};//Replaced slots over every seed
+    uint64_t roaming_slots{0};
+    uint64_t roaming_seeds{0};//Seeds with at least one roaming boss
+    uint64_t reshuffles{0};
+    //Per enemy and boss table index, seeds the type was picked for the map and slots it took
+    std::vector<uint64_t> enemy_seeds;
+    std::vector<uint64_t> enemy_slots;
+    std::vector<uint64_t> boss_seeds;
+    std::vector<uint64_t> boss_slots;
+    //Sum over seeds of chi-square over degrees of freedom of the slots each picked enemy took, near 0 for an even deck and 1 for a random one
+    double deck_spread{0.0};
+    uint64_t deck_seeds{0};
+};
+struct EnemyStats{
+    uint64_t seeds{0};
+    uint64_t failed{0};
+    std::vector<MapEnemyStats> maps;
+};
+EnemyStats generate_enemy_stats(const GameData& map_data,const EnemyTable& enemy_table){
+    EnemyStats stats;
+    stats.maps.resize(map_data.size());
+    for(auto& map:stats.maps){
+        map.enemy_seeds.resize(enemy_table.enemies.size(),0);
+        map.enemy_slots.resize(enemy_table.enemies.size(),0);
+        map.boss_seeds.resize(enemy_table.bosses.size(),0);
+        map.boss_slots.resize(enemy_table.bosses.size(),0);
+    }
+    return stats;
+}
+void add_enemy_plan(EnemyStats& stats,const EnemyPlan& plan){
+    stats.seeds+=1;
+    std::vector<uint64_t> deck_slots;
+    for(const auto& map_plan:plan.maps){
+        auto& map = stats.maps[map_plan.map_index];
+        map.seeds+=1;
+        map.reshuffles+=map_plan.reshuffles;
+        for(auto index:map_plan.enemy_types) map.enemy_seeds[index]+=1;
+        for(auto index:map_plan.boss_index) map.boss_seeds[index]+=1;
+        deck_slots.assign(map_plan.enemy_types.size(),0);
+        uint64_t enemy_slots = 0,roaming_slots = 0;
+        for(const auto& slot:map_plan.slots){
+            if(!slot.replace) continue;
+            map.slots+=1;
+            if(slot.boss){
+                roaming_slots+=1;
+                map.boss_slots[slot.index]+=1;
+                continue;
+            }
+            enemy_slots+=1;
+            map.enemy_slots[slot.index]+=1;
+            for(size_t i = 0;i<map_plan.enemy_types.size();i++){
+                if(map_plan.enemy_types[i]==slot.index) deck_slots[i]+=1;
+            }
+        }
+        map.roaming_slots+=roaming_slots;
+        if(roaming_slots) map.roaming_seeds+=1;
+        if(deck_slots.size()>1&&enemy_slots){
+            double expected = (double)enemy_slots/(double)deck_slots.size();
+            double chi2 = 0.0;
+            for(auto count:deck_slots) chi2+=((double)count-expected)*((double)count-expected)/expected;
+            map.deck_spread+=chi2/(double)(deck_slots.size()-1);
+            map.deck_seeds+=1;
+        }
+    }
+}
+void merge_enemy_stats(EnemyStats& stats,const EnemyStats& other){
+    stats.seeds+=other.seeds;
+    stats.failed+=other.failed;
+    auto add = [](std::vector<uint64_t>& to,const std::vector<uint64_t>& from){
+        for(size_t i = 0;i<to.size();i++) to[i]+=from[i];
+    };
+    for(size_t m = 0;m<stats.maps.size();m++){
+        auto& map = stats.maps[m];
+        const auto& from = other.maps[m];
+        map.seeds+=from.seeds;
+        map.slots+=from.slots;
+        map.roaming_slots+=from.roaming_slots;
+        map.roaming_seeds+=from.roaming_seeds;
+        map.reshuffles+=from.reshuffles;
+        add(map.enemy_seeds,from.enemy_seeds);
+        add(map.enemy_slots,from.enemy_slots);
+        add(map.boss_seeds,from.boss_seeds);
+        add(map.boss_slots,from.boss_slots);
+        map.deck_spread+=from.deck_spread;
+        map.deck_seeds+=from.deck_seeds;
+    }
+}
+struct Uniformity{
+    double chi2{0.0};
+    size_t df{0};
+    double z{0.0};//Wilson-Hilferty normal score, past 3 the picks are very unlikely to be even
+};
+//Seeds each allowed type was picked in against an even split. Types are picked without repeats so a seed's picks
+//aren't independent, that scales the statistic by (1-p)k/(k-1) with p the chance of a type being picked, undone here
+Uniformity pick_uniformity(const std::vector<uint64_t>& seeds_picked,const std::vector<size_t>& allowed,uint64_t seeds){
+    Uniformity result;
+    size_t k = allowed.size();
+    uint64_t picks = 0;
+    for(auto index:allowed) picks+=seeds_picked[index];
+    if(k<2||picks==0||seeds==0) return result;
+    double expected = (double)picks/(double)k;
+    double p = expected/(double)seeds;
+    for(auto index:allowed){
+        double diff = (double)seeds_picked[index]-expected;
+        result.chi2+=diff*diff/expected;
+    }
+    //Every allowed type picked every seed, nothing to measure
+    if(p>=1.0){
+        result.chi2=0.0;
+        return result;
+    }
+    result.df = k-1;
+    result.chi2*=(double)(k-1)/((1.0-p)*(double)k);
+    double v = 2.0/(9.0*(double)result.df);
+    result.z = (std::cbrt(result.chi2/(double)result.df)-(1.0-v))/std::sqrt(v);
+    return result;
+}
+bool analyze_enemy_selection(const Data& data,const search::Options& options,const std::string& folder){
+    if(!data.config.valid||!data.game_data||!data.enemy_table){
+        std::cout<<"Enemy loading went wrong, enemy selection not analyzed\n";
+        return false;
+    }
+    if(!data.config.randomize_enemies){
+        std::cout<<"Enemy randomization is off in the config, nothing to analyze\n";
+        return false;
+    }
+    const auto& map_data = *data.game_data;
+    const auto& enemy_table = *data.enemy_table;
+    std::vector<EnemyStats> stats(search::thread_count(options),generate_enemy_stats(map_data,enemy_table));
+    search::each(options,[&](size_t worker,uint64_t seed){
+        auto config = data.config;
+        config.seed = seed;
+        EnemyPlan plan;
+        if(select_enemies(map_data,enemy_table,config,plan)) add_enemy_plan(stats[worker],plan);
+        else stats[worker].failed+=1;
+    });
+    for(size_t i = 1;i<stats.size();i++) merge_enemy_stats(stats[0],stats[i]);
+    const auto& total = stats[0];
+    std::filesystem::create_directories(folder);
+    std::ofstream maps(std::filesystem::path(folder)/"enemy_maps.csv");
+    std::ofstream types(std::filesystem::path(folder)/"enemy_types.csv");
+    if(!maps||!types){
+        std::cout<<"Can't write the analysis to "<<folder<<'\n';
+        return false;
+    }
+    auto allowed_enemies = allowed_indexes(enemy_table.enemies,data.config);
+    auto allowed_bosses = allowed_indexes(enemy_table.bosses,data.config);
+    auto per_seed = [](uint64_t count,uint64_t seeds){return seeds?(double)count/(double)seeds:0.0;};
+    maps<<"map,name,seeds,slots,roaming slots,roaming seeds,reshuffles,reshuffles per seed,deck spread,enemy chi2,enemy df,enemy z,boss chi2,boss df,boss z\n";
+    types<<"map,kind,id,name,seeds picked,slots,fraction of slots\n";
+    size_t uneven = 0;
+    for(size_t m = 0;m<total.maps.size();m++){
+        const auto& map = total.maps[m];
+        if(!map.seeds) continue;
+        auto enemies = pick_uniformity(map.enemy_seeds,allowed_enemies,map.seeds);
+        auto bosses = pick_uniformity(map.boss_seeds,allowed_bosses,map.seeds);
+        if(enemies.z>3.0||bosses.z>3.0) uneven+=1;
+        maps<<map_data[m].code<<",\""<<map_data[m].name<<"\","<<map.seeds<<','<<map.slots<<','<<map.roaming_slots<<','<<map.roaming_seeds<<','
+            <<map.reshuffles<<','<<per_seed(map.reshuffles,map.seeds)<<','<<(map.deck_seeds?map.deck_spread/(double)map.deck_seeds:0.0)<<','
+            <<enemies.chi2<<','<<enemies.df<<','<<enemies.z<<','<<bosses.chi2<<','<<bosses.df<<','<<bosses.z<<'\n';
+        auto write_types = [&](const char* kind,const std::vector<EnemyType>& table,const std::vector<uint64_t>& seeds_picked,const std::vector<uint64_t>& slots){
+            for(size_t i = 0;i<table.size();i++){
+                if(!seeds_picked[i]&&!slots[i]) continue;
+                types<<map_data[m].code<<','<<kind<<','<<table[i].id<<",\""<<table[i].name<<"\","<<seeds_picked[i]<<','<<slots[i]<<','<<per_seed(slots[i],map.slots)<<'\n';
+            }
+        };
+        write_types("enemy",enemy_table.enemies,map.enemy_seeds,map.enemy_slots);
+        write_types("boss",enemy_table.bosses,map.boss_seeds,map.boss_slots);
+    }
+    std::cout<<"Enemy selection of "<<total.seeds<<" seeds written to "<<folder;
+    if(uneven) std::cout<<", "<<uneven<<" maps picked types unevenly (z above 3)";
+    if(total.failed) std::cout<<", "<<total.failed<<" seeds couldn't be randomized";
+    std::cout<<'\n';
+    return true;
+}
+
 bool load_data(Data& data){
     std::cout<<"Loading enemy randomizer data\n";
     Stopwatch clock;
-    data.game_data = new GameData;
+    data.game_data = std::make_unique<GameData>();
     data.config.valid=false;
+    data.data_hash = output_cache::hash_folder(paths::data);
     read_configfile(data.config);
     load_map_names(*data.game_data);
     if(!load_map_data(*data.game_data)){
         std::cout<<"Failed to load map data\n";
         return false;
     }
-    data.enemy_table = new EnemyTable;
+    data.enemy_table = std::make_unique<EnemyTable>();
     if(!load_enemy_table(*data.enemy_table,*data.game_data)){
         std::cout<<"Failed to load enemy table\n";
         return false;
@@ -1927,22 +2508,85 @@ bool load_data(Data& data){
     data.config.valid=true;
     return true;
 }
-bool randomize(Data& data,bool devmode){
-    auto& config = data.config;
-    if(!config.valid){
+Data::Data()=default;
+Data::~Data()=default;
+Data::Data(Data&&) noexcept=default;
+Data& Data::operator=(Data&&) noexcept=default;
+
+bool randomize(const Data& data,const Run& run,bool devmode){
+    const auto& config = run.config;
+    auto cache = run.cache;
+    auto spoiler = run.spoiler;
+    if(!data.config.valid||!config.valid){
         std::cout<<"Enemy randomizer loading went wrong, enemy randomizer skipped\n";
         return false;
     }
+    std::string cache_key;
+    if(cache&&!devmode){
+        cache_key = output_cache::make_key("enemies",generate_config_file(config),config.seed,data.data_hash);
+        //The cache only keeps params, a cheatsheet or spoiler log needs the seed made again
+        if(!config.write_cheatsheet&&!spoiler&&serve_cached(*cache,cache_key,run)){
+            std::cout<<"Enemy params of seed "<<config.seed<<" taken from the cache\n";
+            return true;
+        }
+    }
     //Make copy in case of multiple randomizations in same session
     //This was an annoying bug to track
     auto data_copy = *data.game_data;
     auto enemy_copy = *data.enemy_table;
-    full_random(data_copy,enemy_copy,config);
+    auto plan = plan_enemy_rando(data_copy,enemy_copy,config);
+    if(spoiler) write_enemy_spoiler(data_copy,enemy_copy,plan,*spoiler);
+    std::string boss_log;
+    full_random(data_copy,enemy_copy,plan,boss_log,run.cheatsheet_folder,run.stage_threads);
     delete_unused_registers(data_copy);
-    write_final_params(data_copy,enemy_copy,devmode);
+    auto params = final_params(data_copy,enemy_copy);
+    write_final_params(params,run.out_folder,devmode,run.writes);
+    if(!cache_key.empty()) cache->store(cache_key,params);
     if(config.write_cheatsheet){
-        write_cheatsheet(config);
+        write_cheatsheet(config,boss_log,run.cheatsheet_folder);
+    }
+    return true;
+}
+bool save_enemy_plan(const Data& data,const std::string& path,const Run& run){
+    auto& config = run.config;
+    if(!data.config.valid||!config.valid){
+        std::cout<<"Enemy randomizer loading went wrong, enemy plan not saved\n";
+        return false;
     }
+    auto plan = encode_enemy_plan(plan_enemy_rando(*data.game_data,*data.enemy_table,config));
+    if(!plan_file::save(path,{{"ECFG",generate_config_file(config)},{"ENMY",plan}})) return false;
+    std::cout<<"Saved enemy plan of seed "<<config.seed<<" to "<<path<<", "<<plan.size()<<" bytes\n";
+    return true;
+}
+bool materialize_enemy_plan(const Data& data,const std::string& path,const Run& run,bool devmode){
+    if(!data.config.valid){
+        std::cout<<"Enemy randomizer loading went wrong, enemy plan not materialized\n";
+        return false;
+    }
+    std::vector<plan_file::Section> sections;
+    if(!plan_file::load(path,sections)) return false;
+    auto config_text = plan_file::find(sections,"ECFG");
+    auto decisions = plan_file::find(sections,"ENMY");
+    if(!config_text||!decisions){
+        std::cout<<"No enemy plan in "<<path<<'\n';
+        return false;
+    }
+    EnemyRandoPlan plan;
+    std::istringstream config_stream(config_text->data);
+    read_config(config_stream,plan.config);
+    plan.config.valid = true;
+    if(!decode_enemy_plan(decisions->data,*data.game_data,*data.enemy_table,plan)) return false;
+    if(run.spoiler) write_enemy_spoiler(*data.game_data,*data.enemy_table,plan,*run.spoiler);
+    auto data_copy = *data.game_data;
+    auto enemy_copy = *data.enemy_table;
+    std::string boss_log;
+    full_random(data_copy,enemy_copy,plan,boss_log,run.cheatsheet_folder,run.stage_threads);
+    delete_unused_registers(data_copy);
+    write_final_params(final_params(data_copy,enemy_copy),run.out_folder,devmode,run.writes);
+    if(plan.config.write_cheatsheet){
+        write_cheatsheet(plan.config,boss_log,run.cheatsheet_folder);
+    }
+    std::cout<<"Materialized enemy plan of seed "<<plan.config.seed<<'\n';
     return true;
 }
 
@@ -1951,15 +2595,15 @@ bool copy_directory_files(const std::filesystem::path& from,const std::filesyste
     bool success=true;
     for(const auto& entry: std::filesystem::directory_iterator(from)){
         if(entry.is_regular_file()){
-            success&=std::filesystem::copy_file(entry.path(),to/entry.path().filename(),std::filesystem::copy_options::overwrite_existing);
+            success&=copy_file_replacing(entry.path(),to/entry.path().filename());
         }
     }
     return success;
 }
 
-bool restore_default_params(bool devmode){
+bool restore_default_params(const Run& run,bool devmode){
     const std::string extension{".param"};
-    std::filesystem::path out = paths::out_folder;
+    std::filesystem::path out = run.out_folder;
     if(devmode) out = "C:\\Program Files (x86)\\Steam\\steamapps\\common\\Dark Souls II Scholar of the First Sin\\Game\\mods\\mod_testing\\Param";
     //Cppref wasnt clear whether this thing returns false or throws when it fails so idk
     bool success=true;
@@ -1967,7 +2611,7 @@ bool restore_default_params(bool devmode){
         success&=copy_directory_files(paths::params/"generator",out);
         success&=copy_directory_files(paths::params/"generator_location",out);
         success&=copy_directory_files(paths::params/"generator_regist",out);
-        success&=std::filesystem::copy_file(paths::params/"EnemyParam.param",out/"EnemyParam.param",std::filesystem::copy_options::overwrite_existing);
+        success&=copy_file_replacing(paths::params/"EnemyParam.param",out/"EnemyParam.param");
     }catch (std::filesystem::filesystem_error& e){
         std::cout << "Could not restore defaults: " << e.what() << '\n';
         return false;
@@ -1979,13 +2623,4 @@ bool restore_default_params(bool devmode){
 }
 
 
-void free_stuff(Data& data){
-    if(data.game_data){
-        delete data.game_data;
-    }
-    if(data.enemy_table){
-        delete data.enemy_table;
-    }
-}
-
 };
@@ -0,0 +1,78 @@
+#include "modules/search.hpp"
+#include "modules/utils.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace search{
+    bool parse_predicate(std::string_view text,Predicate& predicate){
+        auto colon = text.find(':');
+        auto equal = text.find('=',colon==std::string_view::npos?0:colon);
+        if(colon==std::string_view::npos||equal==std::string_view::npos||colon==0||equal==colon+1){
+            std::cout<<"Bad predicate: "<<text<<", expected kind:subject=value\n";
+            return false;
+        }
+        predicate.kind = std::string(text.substr(0,colon));
+        predicate.subject = std::string(text.substr(colon+1,equal-colon-1));
+        predicate.value = std::string(text.substr(equal+1));
+        predicate.text = std::string(text);
+        return true;
+    }
+
+    std::vector<uint64_t> run(const Options& options,const std::function<bool(uint64_t)>& check){
+        std::atomic<uint64_t> next_seed{options.first_seed};
+        std::atomic<uint64_t> checked{0u};
+        const uint64_t last_seed = options.first_seed+options.seeds;
+        //Once enough matches are found only lower seeds are still worth checking, so the result doesn't depend on timing
+        std::atomic<uint64_t> limit{last_seed};
+        std::mutex mutex;
+        std::vector<uint64_t> found;
+        auto worker = [&](){
+            for(uint64_t seed = next_seed++;seed<limit.load();seed = next_seed++){
+                bool match = check(seed);
+                checked++;
+                if(!match) continue;
+                std::lock_guard lock(mutex);
+                found.push_back(seed);
+                if(options.matches==0||found.size()<options.matches) continue;
+                std::nth_element(found.begin(),found.begin()+(options.matches-1),found.end());
+                limit = std::min(limit.load(),found[options.matches-1]+1);
+            }
+        };
+        size_t threads = thread_count(options);
+        Stopwatch clock;
+        {
+            std::vector<std::jthread> pool;
+            for(size_t i = 1;i<threads;i++) pool.emplace_back(worker);
+            worker();
+        }
+        double seconds = (double)clock.passed()/1000000.0;
+        std::sort(found.begin(),found.end());
+        if(options.matches&&found.size()>options.matches) found.resize(options.matches);
+        std::cout<<"Checked "<<checked<<" seeds in "<<seconds<<"s";
+        if(seconds>0.0) std::cout<<", "<<(double)checked/seconds<<" seeds/s";
+        std::cout<<'\n';
+        return found;
+    }
+    size_t thread_count(const Options& options){
+        return options.threads?options.threads:std::max(1u,std::thread::hardware_concurrency());
+    }
+    void each(const Options& options,const std::function<void(size_t worker,uint64_t seed)>& work){
+        std::atomic<uint64_t> next_seed{options.first_seed};
+        const uint64_t last_seed = options.first_seed+options.seeds;
+        auto worker = [&](size_t id){
+            for(uint64_t seed = next_seed++;seed<last_seed;seed = next_seed++) work(id,seed);
+        };
+        Stopwatch clock;
+        {
+            std::vector<std::jthread> pool;
+            for(size_t i = 1;i<thread_count(options);i++) pool.emplace_back(worker,i);
+            worker(0);
+        }
+        double seconds = (double)clock.passed()/1000000.0;
+        std::cout<<"Went through "<<options.seeds<<" seeds in "<<seconds<<"s";
+        if(seconds>0.0) std::cout<<", "<<(double)options.seeds/seconds<<" seeds/s";
+        std::cout<<'\n';
+    }
+}
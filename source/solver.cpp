@@ -0,0 +1,970 @@
+#include <bit>
+#include "modules/solver.hpp"
+#include "modules/utils.hpp"
+
+namespace item_rando{
+namespace solver{
+    size_t Bits::count()const{
+        size_t total = 0;
+        for(const auto& word:words){
+            total+=std::popcount(word);
+        }
+        return total;
+    }
+
+    bool in_range(const Graph& graph,const Door& door){
+        return door.from<graph.n_nodes&&door.to<graph.n_nodes;
+    }
+    //Keys out of range are dropped with a warning by generate_state, so they count as not needed
+    bool needs_key(const Graph& graph,const Requirement& requirement,size_t key){
+        for(auto needed:requirement){
+            if(needed!=0&&needed<graph.keys.size()&&needed==key) return true;
+        }
+        return false;
+    }
+    bool needs_no_key(const Graph& graph,const Requirement& requirement){
+        for(auto needed:requirement){
+            if(needed!=0&&needed<graph.keys.size()) return false;
+        }
+        return true;
+    }
+    //Some requirement of the door is met without key, SIZE_MAX means every key is there
+    bool opens_without(const Graph& graph,const Door& door,size_t key){
+        if(door.requirements.empty()) return true;
+        for(const auto& requirement:door.requirements){
+            if(!needs_key(graph,requirement,key)) return true;
+        }
+        return false;
+    }
+    bool is_free(const Graph& graph,const Door& door){
+        if(door.requirements.empty()) return true;
+        for(const auto& requirement:door.requirements){
+            if(needs_no_key(graph,requirement)) return true;
+        }
+        return false;
+    }
+
+    //Tarjan's algorithm without recursion, components come out numbered in reverse topological order
+    std::vector<uint32_t> strong_components(const std::vector<std::vector<uint32_t>>& next,uint32_t& count){
+        constexpr uint32_t unvisited = UINT32_MAX;
+        size_t n = next.size();
+        std::vector<uint32_t> index(n,unvisited),low(n,0),component(n,unvisited);
+        std::vector<uint32_t> stack;
+        std::vector<std::pair<uint32_t,size_t>> calls;//Room and next door to follow
+        uint32_t counter = 0;
+        count = 0;
+        auto enter = [&](uint32_t room){
+            index[room] = low[room] = counter++;
+            stack.push_back(room);
+            calls.push_back({room,0});
+        };
+        for(uint32_t root = 0;root<n;root++){
+            if(index[root]!=unvisited) continue;
+            enter(root);
+            while(!calls.empty()){
+                auto room = calls.back().first;
+                auto& edge = calls.back().second;
+                if(edge<next[room].size()){
+                    auto to = next[room][edge++];
+                    if(index[to]==unvisited) enter(to);
+                    else if(component[to]==unvisited) low[room] = std::min(low[room],index[to]);//Still on the stack
+                    continue;
+                }
+                calls.pop_back();
+                if(!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first],low[room]);
+                if(low[room]!=index[room]) continue;
+                uint32_t member;
+                do{
+                    member = stack.back();
+                    stack.pop_back();
+                    component[member] = count;
+                }while(member!=room);
+                count++;
+            }
+        }
+        return component;
+    }
+    std::vector<uint32_t> components_of(const Graph& graph,bool free_only,uint32_t& count){
+        std::vector<std::vector<uint32_t>> next(graph.n_nodes);
+        for(const auto& door:graph.blockades){
+            if(!in_range(graph,door)||(free_only&&!is_free(graph,door))) continue;
+            next[door.from].push_back(door.to);
+        }
+        return strong_components(next,count);
+    }
+    //Rooms reachable from the start through doors that open without key
+    Bits reach_without(const Graph& graph,size_t key){
+        Bits rooms(graph.n_nodes);
+        if(graph.n_nodes==0) return rooms;
+        std::vector<std::vector<uint32_t>> next(graph.n_nodes);
+        for(const auto& door:graph.blockades){
+            if(in_range(graph,door)&&opens_without(graph,door,key)) next[door.from].push_back(door.to);
+        }
+        std::vector<uint32_t> todo{0};
+        rooms.set(0);
+        while(!todo.empty()){
+            auto room = todo.back();
+            todo.pop_back();
+            for(auto to:next[room]){
+                if(rooms.test(to)) continue;
+                rooms.set(to);
+                todo.push_back(to);
+            }
+        }
+        return rooms;
+    }
+
+    Analysis analyze(const Graph& graph){
+        Analysis analysis;
+        analysis.component = components_of(graph,false,analysis.components);
+        analysis.free_component = components_of(graph,true,analysis.free_components);
+        auto all = reach_without(graph,SIZE_MAX);
+        analysis.unreachable = Bits(graph.n_nodes);
+        for(size_t i = 0;i<graph.n_nodes;i++){
+            if(!all.test(i)) analysis.unreachable.set(i);
+        }
+        std::vector<bool> used(graph.keys.size(),false);
+        for(const auto& door:graph.blockades){
+            for(const auto& requirement:door.requirements){
+                for(auto key:requirement){
+                    if(key<used.size()) used[key] = true;
+                }
+            }
+        }
+        analysis.behind_key.assign(graph.keys.size(),Bits(graph.n_nodes));
+        for(size_t key = 1;key<graph.keys.size();key++){
+            if(!used[key]) continue;
+            auto without = reach_without(graph,key);
+            auto& behind = analysis.behind_key[key];
+            for(size_t w = 0;w<behind.words.size();w++) behind.words[w] = all.words[w]&~without.words[w];
+        }
+        return analysis;
+    }
+
+    bool report_analysis(const Graph& graph,const Analysis& analysis){
+        std::cout<<"Key graph: "<<graph.n_nodes<<" rooms, "<<analysis.free_components<<" nodes once rooms linked by free doors are joined, "<<analysis.components<<" strongly connected components\n";
+        for(size_t i = 0;i<graph.n_nodes;i++){
+            if(!analysis.unreachable.test(i)) continue;
+            std::cout<<"ERROR: Room can't be reached even with every key: "<<(i<graph.rooms.size()?graph.rooms[i].name:std::to_string(i))<<'\n';
+        }
+        return analysis.unreachable.count()==0;
+    }
+
+    GraphState generate_state(const Graph& graph,bool join_free_rooms){
+        GraphState state;
+        if(graph.n_nodes==0){
+            std::cout<<"WARNING: Graph has 0 nodes\n";
+        }
+        state.key_words = word_count(graph.keys.size());
+        uint32_t n_nodes = (uint32_t)graph.n_nodes;
+        if(join_free_rooms){
+            state.node_of_room = components_of(graph,true,n_nodes);
+        }else{
+            state.node_of_room.resize(graph.n_nodes);
+            std::iota(state.node_of_room.begin(),state.node_of_room.end(),0u);
+        }
+        state.node_begin.assign(n_nodes+1,0);
+        for(auto node:state.node_of_room) state.node_begin[node+1]++;
+        for(size_t i = 0;i<n_nodes;i++) state.node_begin[i+1]+=state.node_begin[i];
+        state.node_rooms.resize(graph.n_nodes);
+        auto next_room = state.node_begin;
+        for(uint32_t room = 0;room<graph.n_nodes;room++) state.node_rooms[next_room[state.node_of_room[room]]++] = room;
+        state.door_begin.assign(n_nodes+1,0);
+        std::vector<bool> in_range(graph.blockades.size(),false);
+        for(size_t i = 0;i<graph.blockades.size();i++){
+            const auto& block = graph.blockades[i];
+            if(block.to>=graph.n_nodes||block.from>=graph.n_nodes){
+                std::cout<<"WARNING: Blockade outside of range, from:"<<block.from<<" to:"<<block.to<<'\n';
+                continue;
+            }
+            //Doors inside a node lead somewhere already visited with it
+            if(state.node_of_room[block.from]==state.node_of_room[block.to]) continue;
+            in_range[i]=true;
+            state.door_begin[state.node_of_room[block.from]+1]++;
+        }
+        for(size_t i = 0;i<n_nodes;i++){
+            state.door_begin[i+1]+=state.door_begin[i];
+        }
+        state.door_list.resize(state.door_begin.back());
+        state.requirement_begin.assign(graph.blockades.size()+1,0);
+        for(size_t i = 0;i<graph.blockades.size();i++){
+            state.requirement_begin[i+1] = state.requirement_begin[i]+(uint32_t)std::max<size_t>(1,graph.blockades[i].requirements.size());
+        }
+        state.requirement_door.resize(state.requirement_begin.back());
+        state.requirement_keys.assign(state.requirement_begin.back()*state.key_words,0);
+        auto next = state.door_begin;
+        for(size_t i = 0;i<graph.blockades.size();i++){
+            const auto& block = graph.blockades[i];
+            auto requirement = state.requirement_begin[i];
+            for(auto r = requirement;r<state.requirement_begin[i+1];r++) state.requirement_door[r] = (uint32_t)i;
+            for(const auto& keys:block.requirements){
+                for(auto key:keys){
+                    if(key==0) continue;//NULL key is always obtained
+                    if(key>=graph.keys.size()){
+                        std::cout<<"WARNING: Door key outside of range: "<<key<<'\n';
+                        continue;
+                    }
+                    state.requirement_keys[requirement*state.key_words+key/64]|=uint64_t(1)<<(key%64);
+                }
+                requirement++;
+            }
+            if(in_range[i]) state.door_list[next[state.node_of_room[block.from]]++]=(uint32_t)i;
+        }
+        state.capacity_left.resize(graph.n_nodes);
+        for(size_t i = 0;i<graph.n_nodes;i++){
+            state.capacity_left[i] = i<graph.rooms.size()?graph.rooms[i].capacity:default_capacity;
+        }
+        state.placements.resize(graph.keys.size());
+        for(size_t i = 0;i<graph.keys.size();i++){
+            state.placements[i].left = graph.keys[i].total_amount;
+        }
+        return state;
+    }
+
+    //Keys placed in each room, key_words words per room
+    std::vector<uint64_t> placed_keys(const Graph& graph,const GraphState& state){
+        std::vector<uint64_t> room_keys(graph.n_nodes*state.key_words,0);
+        for(size_t i = 0;i<state.placements.size();i++){
+            for(const auto& node:state.placements[i].node){
+                room_keys[node*state.key_words+i/64]|=uint64_t(1)<<(i%64);
+            }
+        }
+        return room_keys;
+    }
+
+    constexpr uint32_t no_requirement = UINT32_MAX;
+
+    //Opens doors as rooms get visited and keys get obtained, a requirement is looked at again only when the key it waits on shows up
+    struct Expansion{
+        const Graph& graph;
+        const GraphState& state;
+        Frontier& frontier;
+        const std::vector<uint64_t>& room_keys;
+        size_t excluded;
+        std::vector<uint32_t> rooms_todo;
+        std::vector<size_t> keys_todo;
+
+        void obtain(size_t key){
+            if(key==excluded||frontier.keys.test(key)) return;
+            frontier.keys.set(key);
+            keys_todo.push_back(key);
+        }
+        void visit(uint32_t room){
+            if(frontier.rooms.test(room)) return;
+            auto node = state.node_of_room[room];
+            for(auto i = state.node_begin[node];i<state.node_begin[node+1];i++){
+                frontier.rooms.set(state.node_rooms[i]);
+            }
+            rooms_todo.push_back(node);
+        }
+        void consider_requirement(uint32_t requirement){
+            auto to = graph.blockades[state.requirement_door[requirement]].to;
+            if(frontier.rooms.test(to)) return;
+            const uint64_t* needed = &state.requirement_keys[requirement*state.key_words];
+            for(size_t w = 0;w<state.key_words;w++){
+                uint64_t missing = needed[w]&~frontier.keys.words[w];
+                if(missing){
+                    auto key = w*64+std::countr_zero(missing);
+                    frontier.waiting_next[requirement]=frontier.waiting_head[key];
+                    frontier.waiting_head[key]=requirement;
+                    return;
+                }
+            }
+            visit(to);
+        }
+        void consider(uint32_t door){
+            for(auto r = state.requirement_begin[door];r<state.requirement_begin[door+1];r++){
+                consider_requirement(r);
+            }
+        }
+        void run(){
+            while(!rooms_todo.empty()||!keys_todo.empty()){
+                if(!keys_todo.empty()){
+                    auto key = keys_todo.back();
+                    keys_todo.pop_back();
+                    auto requirement = frontier.waiting_head[key];
+                    frontier.waiting_head[key]=no_requirement;
+                    while(requirement!=no_requirement){
+                        auto next = frontier.waiting_next[requirement];
+                        consider_requirement(requirement);
+                        requirement = next;
+                    }
+                    continue;
+                }
+                auto node = rooms_todo.back();
+                rooms_todo.pop_back();
+                for(auto r = state.node_begin[node];r<state.node_begin[node+1];r++){
+                    auto room = state.node_rooms[r];
+                    for(size_t w = 0;w<state.key_words;w++){
+                        auto found = room_keys[room*state.key_words+w];
+                        while(found){
+                            obtain(w*64+std::countr_zero(found));
+                            found&=found-1;
+                        }
+                    }
+                }
+                for(auto i = state.door_begin[node];i<state.door_begin[node+1];i++){
+                    consider(state.door_list[i]);
+                }
+            }
+        }
+    };
+
+    Frontier empty_frontier(const Graph& graph,const GraphState& state){
+        Frontier frontier;
+        frontier.rooms = Bits(graph.n_nodes);
+        frontier.keys = Bits(graph.keys.size());
+        frontier.keys.set(0);//NULL key
+        frontier.waiting_head.assign(graph.keys.size(),no_requirement);
+        frontier.waiting_next.assign(state.requirement_door.size(),no_requirement);
+        frontier.room_keys = placed_keys(graph,state);
+        return frontier;
+    }
+
+    Frontier generate_frontier(const Graph& graph,const GraphState& state){
+        auto frontier = empty_frontier(graph,state);
+        if(graph.n_nodes==0) return frontier;
+        Expansion expansion{graph,state,frontier,frontier.room_keys,SIZE_MAX,{},{}};
+        expansion.visit(0);
+        expansion.run();
+        return frontier;
+    }
+
+    std::vector<size_t> compress(const Bits& bits){
+        std::vector<size_t> compressed;
+        for(size_t w = 0;w<bits.words.size();w++){
+            auto word = bits.words[w];
+            while(word){
+                compressed.push_back(w*64+std::countr_zero(word));
+                word&=word-1;
+            }
+        }
+        return compressed;
+    }
+
+    //Keys that are not placed yet are assumed to be obtainable, except the one being placed
+    void assume_unplaced(Expansion& expansion,const GraphState& state){
+        for(size_t i = 0;i<state.placements.size();i++){
+            if(state.placements[i].node.empty()) expansion.obtain(i);
+        }
+    }
+
+    std::vector<size_t> get_valid_nodes(const Graph& graph,const GraphState& state,size_t key_id){
+        if(graph.n_nodes==0) return {};
+        auto frontier = empty_frontier(graph,state);
+        Expansion expansion{graph,state,frontier,frontier.room_keys,key_id,{},{}};
+        assume_unplaced(expansion,state);
+        expansion.visit(0);
+        expansion.run();
+        return compress(frontier.rooms);
+    }
+
+    std::vector<size_t> get_valid_nodes(const Graph& graph,const GraphState& state,const Frontier& frontier,size_t key_id){
+        if(graph.n_nodes==0) return {};
+        //Doors needing an already obtained key_id were opened by the frontier, start over
+        if(frontier.keys.test(key_id)) return get_valid_nodes(graph,state,key_id);
+        //Placed keys are only read, no need to copy them
+        Frontier valid{frontier.rooms,frontier.keys,frontier.waiting_head,frontier.waiting_next,{}};
+        Expansion expansion{graph,state,valid,frontier.room_keys,key_id,{},{}};
+        assume_unplaced(expansion,state);
+        expansion.run();
+        return compress(valid.rooms);
+    }
+
+    Slot pick_slot(const GraphState& state,const std::vector<size_t>& valid_nodes,std::mt19937_64& generator){
+        uint64_t total = 0;
+        for(auto node:valid_nodes) total+=state.capacity_left[node];
+        if(total==0) return {SIZE_MAX,0};
+        std::uniform_int_distribution<uint64_t> dist(0,total-1);
+        auto index = dist(generator);
+        for(auto node:valid_nodes){
+            if(index<state.capacity_left[node]) return {node,index};
+            index-=state.capacity_left[node];
+        }
+        return {SIZE_MAX,0};
+    }
+
+    void place_key(const Graph& graph,GraphState& state,Frontier& frontier,size_t key_id,size_t node){
+        state.placements[key_id].node.push_back(node);
+        if(state.capacity_left[node]) state.capacity_left[node]--;
+        if(frontier.rooms.test(node)){
+            Expansion expansion{graph,state,frontier,frontier.room_keys,SIZE_MAX,{},{}};
+            expansion.obtain(key_id);
+            expansion.run();
+        }else{
+            frontier.room_keys[node*state.key_words+key_id/64]|=uint64_t(1)<<(key_id%64);
+        }
+    }
+
+    //This is a simple solver, and its not part of the randomizer
+    void solve(const Graph& graph,GraphState& state){
+        solve(graph,state,34);
+    }
+    void solve(const Graph& graph,GraphState& state,uint64_t seed){
+        std::vector<size_t> key_deck;
+        for(size_t i = 1;i<graph.keys.size();i++){//Skip null key
+            key_deck.push_back(i);
+        }
+        std::mt19937_64 generator(seed);
+        std::shuffle(key_deck.begin(),key_deck.end(),generator);
+        auto frontier = generate_frontier(graph,state);
+        for(const auto& key_id:key_deck){
+            auto valid_nodes = get_valid_nodes(graph,state,frontier,key_id);
+            auto slot = pick_slot(state,valid_nodes,generator);
+            if(slot.room==SIZE_MAX){
+                std::cout<<"Can't place, no valid nodes\n";
+            }else{
+                place_key(graph,state,frontier,key_id,slot.room);
+            }
+        }
+    }
+
+    bool check_solution(const Graph& graph,const GraphState& state){
+        if(graph.n_nodes==0) return true;
+        auto frontier = generate_frontier(graph,state);
+        if(frontier.rooms.count()==graph.n_nodes) return true;
+        for(size_t i = 0 ;i<graph.n_nodes;i++){
+            if(!frontier.rooms.test(i)){
+                std::cout<<"Cant visit: "<<graph.rooms[i].name<<'\n';
+            }
+        }
+        return false;
+
+    }
+
+    //Same expansion as check_solution, but every room and key holds a lane mask of the states that reached it
+    struct LaneExpansion{
+        const Graph& graph;
+        const GraphState& structure;
+        //Doors needing each key, so a key showing up in some lanes only rechecks those doors
+        const std::vector<std::vector<uint32_t>>& doors_by_key;
+        //Keys placed in the rooms of each node with the lanes they are placed in
+        std::vector<std::vector<std::pair<uint32_t,uint64_t>>> node_keys;
+        std::vector<uint64_t> nodes;
+        std::vector<uint64_t> keys;
+        //A node or key waits once however many lanes reach it meanwhile, and is expanded for all of them together
+        std::vector<uint8_t> node_waiting;
+        std::vector<uint8_t> key_waiting;
+        //First in first out, the longer a node waits the more lanes it gathers
+        std::vector<uint32_t> nodes_todo;
+        size_t nodes_next{0};
+        std::vector<uint32_t> keys_todo;
+
+        void visit(uint32_t room,uint64_t lanes){
+            auto node = structure.node_of_room[room];
+            lanes&=~nodes[node];
+            if(!lanes) return;
+            nodes[node]|=lanes;
+            if(!node_waiting[node]){
+                node_waiting[node] = 1;
+                nodes_todo.push_back(node);
+            }
+        }
+        void obtain(uint32_t key,uint64_t lanes){
+            lanes&=~keys[key];
+            if(!lanes) return;
+            keys[key]|=lanes;
+            if(!key_waiting[key]){
+                key_waiting[key] = 1;
+                keys_todo.push_back(key);
+            }
+        }
+        void consider(uint32_t door){
+            uint64_t from = nodes[structure.node_of_room[graph.blockades[door].from]];
+            uint64_t open = 0;
+            for(auto r = structure.requirement_begin[door];r<structure.requirement_begin[door+1]&&open!=from;r++){
+                uint64_t met = from;
+                const uint64_t* needed = &structure.requirement_keys[r*structure.key_words];
+                for(size_t w = 0;w<structure.key_words&&met;w++){
+                    auto word = needed[w];
+                    while(word&&met){
+                        met&=keys[w*64+std::countr_zero(word)];
+                        word&=word-1;
+                    }
+                }
+                open|=met;
+            }
+            if(open) visit(graph.blockades[door].to,open);
+        }
+        void run(){
+            while(nodes_next<nodes_todo.size()||!keys_todo.empty()){
+                //Keys wait until no node does, by then most lanes that will get them have
+                if(nodes_next==nodes_todo.size()){
+                    auto key = keys_todo.back();
+                    keys_todo.pop_back();
+                    key_waiting[key] = 0;
+                    for(auto door:doors_by_key[key]) consider(door);
+                    continue;
+                }
+                auto node = nodes_todo[nodes_next++];
+                if(nodes_next==nodes_todo.size()){
+                    nodes_todo.clear();
+                    nodes_next = 0;
+                }
+                node_waiting[node] = 0;
+                for(const auto& [key,lanes]:node_keys[node]) obtain(key,nodes[node]&lanes);
+                for(auto i = structure.door_begin[node];i<structure.door_begin[node+1];i++){
+                    consider(structure.door_list[i]);
+                }
+            }
+        }
+    };
+
+    std::vector<Bits> check_solutions(const Graph& graph,std::span<const GraphState> states){
+        std::vector<Bits> unreached(states.size(),Bits(graph.n_nodes));
+        if(graph.n_nodes==0) return unreached;
+        auto structure = generate_state(graph);
+        std::vector<std::vector<uint32_t>> doors_by_key(graph.keys.size());
+        for(size_t r = 0;r<structure.requirement_door.size();r++){
+            auto door = structure.requirement_door[r];
+            for(size_t w = 0;w<structure.key_words;w++){
+                auto word = structure.requirement_keys[r*structure.key_words+w];
+                while(word){
+                    auto& doors = doors_by_key[w*64+std::countr_zero(word)];
+                    if(doors.empty()||doors.back()!=door) doors.push_back(door);
+                    word&=word-1;
+                }
+            }
+        }
+        for(size_t first = 0;first<states.size();first+=64){
+            auto batch = states.subspan(first,std::min<size_t>(64,states.size()-first));
+            LaneExpansion expansion{graph,structure,doors_by_key,{},{},{},{},{},{},0,{}};
+            auto n_nodes = structure.node_begin.size()-1;
+            expansion.node_keys.resize(n_nodes);
+            expansion.nodes.assign(n_nodes,0);
+            expansion.keys.assign(graph.keys.size(),0);
+            expansion.node_waiting.assign(n_nodes,0);
+            expansion.key_waiting.assign(graph.keys.size(),0);
+            uint64_t all = batch.size()==64?~uint64_t(0):(uint64_t(1)<<batch.size())-1;
+            //Key by key, so the lanes of one key in one node end up in one entry
+            for(size_t key = 0;key<graph.keys.size();key++){
+                for(size_t lane = 0;lane<batch.size();lane++){
+                    if(key>=batch[lane].placements.size()) continue;
+                    for(auto node:batch[lane].placements[key].node){
+                        if(node>=graph.n_nodes) continue;
+                        auto& list = expansion.node_keys[structure.node_of_room[node]];
+                        if(list.empty()||list.back().first!=key) list.push_back({(uint32_t)key,0});
+                        list.back().second|=uint64_t(1)<<lane;
+                    }
+                }
+            }
+            expansion.obtain(0,all);//NULL key
+            expansion.visit(0,all);
+            expansion.run();
+            for(size_t lane = 0;lane<batch.size();lane++){
+                auto& rooms = unreached[first+lane];
+                for(size_t i = 0;i<graph.n_nodes;i++){
+                    if(!((expansion.nodes[structure.node_of_room[i]]>>lane)&1)) rooms.set(i);
+                }
+            }
+        }
+        return unreached;
+    }
+
+    Bits reachable_rooms(const Graph& graph,const GraphState& state,size_t excluded_room){
+        bool exclude = excluded_room<graph.n_nodes;
+        if(exclude&&state.node_begin.size()<=graph.n_nodes){
+            //The excluded room may share a node with rooms that can be reached around it
+            auto rooms = generate_state(graph,false);
+            rooms.placements = state.placements;
+            return reachable_rooms(graph,rooms,excluded_room);
+        }
+        auto frontier = empty_frontier(graph,state);
+        if(graph.n_nodes==0||excluded_room==0) return frontier.rooms;
+        if(exclude) frontier.rooms.set(excluded_room);//Looks visited so it is never entered
+        Expansion expansion{graph,state,frontier,frontier.room_keys,SIZE_MAX,{},{}};
+        expansion.visit(0);
+        expansion.run();
+        if(exclude) frontier.rooms.reset(excluded_room);
+        return frontier.rooms;
+    }
+
+    Playthrough playthrough(const Graph& graph,const GraphState& state){
+        Playthrough result;
+        result.key_sphere.assign(graph.keys.size(),no_sphere);
+        if(graph.n_nodes==0) return result;
+        auto frontier = empty_frontier(graph,state);
+        //Keys are handed over by sphere instead of as their rooms are reached
+        std::vector<uint64_t> no_keys(frontier.room_keys.size(),0);
+        Expansion expansion{graph,state,frontier,no_keys,SIZE_MAX,{},{}};
+        Bits before(graph.n_nodes);
+        Bits picked = frontier.keys;
+        expansion.visit(0);
+        while(true){
+            expansion.run();
+            Sphere sphere;
+            for(size_t w = 0;w<before.words.size();w++){
+                auto opened = frontier.rooms.words[w]&~before.words[w];
+                before.words[w] = frontier.rooms.words[w];
+                while(opened){
+                    auto room = (uint32_t)(w*64+std::countr_zero(opened));
+                    opened&=opened-1;
+                    sphere.rooms.push_back(room);
+                    for(size_t k = 0;k<state.key_words;k++){
+                        auto found = frontier.room_keys[room*state.key_words+k]&~picked.words[k];
+                        picked.words[k]|=found;
+                        while(found){
+                            sphere.keys.push_back((uint32_t)(k*64+std::countr_zero(found)));
+                            found&=found-1;
+                        }
+                    }
+                }
+            }
+            if(sphere.rooms.empty()&&sphere.keys.empty()) break;
+            std::sort(sphere.keys.begin(),sphere.keys.end());
+            for(auto key:sphere.keys){
+                result.key_sphere[key] = (uint32_t)result.spheres.size();
+                expansion.obtain(key);
+            }
+            result.spheres.push_back(std::move(sphere));
+        }
+        //Drop keys latest first while every room stays reachable, what is left can't lose any key
+        Bits kept = picked;
+        for(auto sphere = result.spheres.rbegin();sphere!=result.spheres.rend();sphere++){
+            for(auto key = sphere->keys.rbegin();key!=sphere->keys.rend();key++){
+                kept.reset(*key);
+                auto room_keys = frontier.room_keys;
+                for(size_t room = 0;room<graph.n_nodes;room++){
+                    for(size_t w = 0;w<state.key_words;w++) room_keys[room*state.key_words+w]&=kept.words[w];
+                }
+                auto rooms = empty_frontier(graph,state);
+                Expansion without{graph,state,rooms,room_keys,SIZE_MAX,{},{}};
+                without.visit(0);
+                without.run();
+                if(rooms.rooms.count()!=before.count()) kept.set(*key);
+            }
+        }
+        for(const auto& sphere:result.spheres){
+            for(auto key:sphere.keys){
+                if(kept.test(key)) result.required.push_back(key);
+            }
+        }
+        return result;
+    }
+
+    void print_playthrough(const Graph& graph,const GraphState& state,const Playthrough& result,std::ostream& out){
+        auto room_name = [&graph](size_t room)->std::string{
+            return room<graph.rooms.size()?graph.rooms[room].name:std::to_string(room);
+        };
+        //First room of the key's sphere holding a copy of it
+        auto key_room = [&](uint32_t key)->std::string{
+            for(auto node:state.placements[key].node){
+                for(auto room:result.spheres[result.key_sphere[key]].rooms){
+                    if(room==node) return room_name(room);
+                }
+            }
+            return "?";
+        };
+        out<<"Playthrough:\n";
+        uint32_t last = no_sphere;
+        for(auto key:result.required){
+            if(result.key_sphere[key]!=last){
+                last = result.key_sphere[key];
+                out<<"Sphere "<<last<<'\n';
+            }
+            out<<"    "<<graph.keys[key].name<<" in "<<key_room(key)<<'\n';
+        }
+        out<<"Key spheres:\n";
+        for(size_t key = 1;key<graph.keys.size();key++){
+            if(result.key_sphere[key]==no_sphere) out<<"    "<<graph.keys[key].name<<": never\n";
+            else out<<"    "<<graph.keys[key].name<<": "<<result.key_sphere[key]<<'\n';
+        }
+    }
+
+    void DepthStats::add(const Playthrough& result){
+        seeds++;
+        if(seeds_at.size()<result.key_sphere.size()){
+            seeds_at.resize(result.key_sphere.size());
+            required.resize(result.key_sphere.size(),0);
+        }
+        for(size_t key = 0;key<result.key_sphere.size();key++){
+            auto& column = seeds_at[key];
+            //Last column is never, the sphere ones go before it
+            size_t at = result.key_sphere[key]==no_sphere?SIZE_MAX:result.key_sphere[key];
+            if(column.empty()) column.push_back(0);
+            if(at!=SIZE_MAX&&at+1>=column.size()) column.insert(column.end()-1,at+2-column.size(),0);
+            column[at==SIZE_MAX?column.size()-1:at]++;
+        }
+        for(auto key:result.required) required[key]++;
+    }
+    void DepthStats::merge(const DepthStats& other){
+        seeds+=other.seeds;
+        if(seeds_at.size()<other.seeds_at.size()){
+            seeds_at.resize(other.seeds_at.size());
+            required.resize(other.seeds_at.size(),0);
+        }
+        for(size_t key = 0;key<other.seeds_at.size();key++){
+            auto& column = seeds_at[key];
+            const auto& from = other.seeds_at[key];
+            if(from.empty()) continue;
+            if(column.empty()) column.push_back(0);
+            if(column.size()<from.size()) column.insert(column.end()-1,from.size()-column.size(),0);
+            for(size_t at = 0;at+1<from.size();at++) column[at]+=from[at];
+            column.back()+=from.back();
+            required[key]+=other.required[key];
+        }
+    }
+    void DepthStats::write_csv(const Graph& graph,std::ostream& out)const{
+        size_t spheres = 0;
+        for(const auto& column:seeds_at) spheres = std::max(spheres,column.empty()?0:column.size()-1);
+        out<<"key,seeds,required,never,mean";
+        for(size_t at = 0;at<spheres;at++) out<<",sphere "<<at;
+        out<<'\n';
+        for(size_t key = 1;key<graph.keys.size();key++){
+            std::vector<uint64_t> column(spheres+1,0);
+            if(key<seeds_at.size()&&!seeds_at[key].empty()){
+                const auto& counts = seeds_at[key];
+                std::copy(counts.begin(),counts.end()-1,column.begin());
+                column.back() = counts.back();
+            }
+            uint64_t picked = 0;
+            double total = 0;
+            for(size_t at = 0;at<spheres;at++){
+                picked+=column[at];
+                total+=(double)at*column[at];
+            }
+            out<<'"'<<graph.keys[key].name<<"\","<<seeds<<','<<(key<required.size()?required[key]:0)<<','<<column.back()<<',';
+            if(picked) out<<total/picked;
+            for(size_t at = 0;at<spheres;at++) out<<','<<column[at];
+            out<<'\n';
+        }
+    }
+
+    void PlacementStats::add(const Graph& graph,const GraphState& state,const Playthrough& result){
+        depths.add(result);
+        if(key_rooms.empty()){
+            key_rooms.assign(graph.keys.size()*graph.n_nodes,0);
+            required_stops.assign(graph.n_nodes,0);
+        }
+        for(size_t key = 0;key<state.placements.size()&&key<graph.keys.size();key++){
+            for(auto node:state.placements[key].node){
+                if(node<graph.n_nodes) key_rooms[key*graph.n_nodes+node]++;
+            }
+        }
+        //A key with many copies counts where the copy of its sphere is
+        Bits stops(graph.n_nodes);
+        for(auto key:result.required){
+            for(auto room:result.spheres[result.key_sphere[key]].rooms){
+                if(vector_contains(state.placements[key].node,room)) stops.set(room);
+            }
+        }
+        for(size_t room = 0;room<graph.n_nodes;room++){
+            if(stops.test(room)) required_stops[room]++;
+        }
+    }
+    void PlacementStats::merge(const PlacementStats& other){
+        depths.merge(other.depths);
+        if(other.key_rooms.empty()) return;
+        if(key_rooms.empty()){
+            key_rooms = other.key_rooms;
+            required_stops = other.required_stops;
+            return;
+        }
+        for(size_t i = 0;i<key_rooms.size();i++) key_rooms[i]+=other.key_rooms[i];
+        for(size_t i = 0;i<required_stops.size();i++) required_stops[i]+=other.required_stops[i];
+    }
+    std::string csv_name(const Graph& graph,size_t room){
+        return '"'+(room<graph.rooms.size()?graph.rooms[room].name:std::to_string(room))+'"';
+    }
+    void PlacementStats::write_key_rooms_csv(const Graph& graph,std::ostream& out)const{
+        out<<"key,room,seeds,fraction\n";
+        if(key_rooms.empty()) return;
+        for(size_t key = 1;key<graph.keys.size();key++){
+            for(size_t room = 0;room<graph.n_nodes;room++){
+                auto seeds = key_rooms[key*graph.n_nodes+room];
+                if(!seeds) continue;
+                out<<'"'<<graph.keys[key].name<<"\","<<csv_name(graph,room)<<','<<seeds<<','<<(double)seeds/depths.seeds<<'\n';
+            }
+        }
+    }
+    void PlacementStats::write_rooms_csv(const Graph& graph,std::ostream& out)const{
+        out<<"room,required stop seeds,fraction,keys per seed\n";
+        if(key_rooms.empty()) return;
+        for(size_t room = 0;room<graph.n_nodes;room++){
+            uint64_t keys = 0;
+            for(size_t key = 1;key<graph.keys.size();key++) keys+=key_rooms[key*graph.n_nodes+room];
+            out<<csv_name(graph,room)<<','<<required_stops[room]<<','<<(double)required_stops[room]/depths.seeds<<','<<(double)keys/depths.seeds<<'\n';
+        }
+    }
+
+    void print_solution(const Graph& graph,const GraphState& state){
+        for(size_t i = 1;i<state.placements.size();i++){
+            if(state.placements[i].node.empty()){
+                std::cout<<graph.keys[i].name<<" not placed\n";
+            }else{
+                std::cout<<graph.keys[i].name<<" in ";
+                for(const auto& a:state.placements[i].node){
+                    std::cout<<graph.rooms[a].name;
+                    if(&a!=&state.placements[i].node.back()) std::cout<<',';
+                    else        std::cout<<"\n";
+                }
+            }
+        }
+
+    }
+
+    bool test_graph(const Graph& graph){
+        for(int i = 0;i<1000;i++){
+            auto state = generate_state(graph);
+            solve(graph,state,i);
+            // print_solution(graph,state);
+            if(!check_solution(graph,state)){
+                std::cout<<"FAILED\n";
+                return false;
+            }
+        }
+        std::cout<<"PASSED\n";
+        return true;
+    }
+
+    size_t room_by_name(const Graph& graph,const std::string& name){
+        auto found = graph.room_ids.find(name);
+        if(found!=graph.room_ids.end()) return found->second;
+        std::cout<<"Can't find room with name: "<<name<<'\n';
+        return SIZE_MAX;
+    }
+    size_t key_by_name(const Graph& graph,const std::string& name){
+        auto found = graph.key_ids.find(name);
+        if(found!=graph.key_ids.end()) return found->second;
+        std::cout<<"Can't find key with name: "<<name<<'\n';
+        return SIZE_MAX;
+    }
+
+    bool parse_from_file(const std::filesystem::path& file_path,Graph& graph){
+        if(!std::filesystem::exists(file_path)){
+            std::cout<<"File doesn't not exists "<<std::filesystem::absolute(file_path)<<'\n';
+            return false;
+        }
+        std::ifstream file(file_path);
+        if(!file){
+            std::cout<<"Cannot open file: "<<file_path<<'\n';
+            return false;
+        }
+        std::string line;
+        bool keys=false,rooms=false,doors=false;
+        graph.keys.push_back({"NULL",1});
+        graph.key_ids.emplace("NULL",0u);
+        while(cboyo::parse::getline(file,line)){
+            std::string_view sview = line;
+            if(sview.front()=='#'){
+                keys = rooms = doors=false;
+                if(sview=="#KEYS") keys=true;
+                else if(sview=="#ROOMS") rooms=true;
+                else if(sview=="#DOORS") doors=true;
+                // std::cout<<keys<<" "<<rooms<<" "<<doors<<"\n";
+            }else if(sview.size()<2){
+                continue;
+            }else{
+                if(keys){
+                    auto tokens = cboyo::parse::split(sview,',');
+                    if(tokens.size()!=2){
+                        std::cout<<"Error reading key: "<<sview<<'\n';
+                    }else{
+                        Key key;
+                        key.name = tokens[0];
+                        cboyo::parse::read_var(tokens[1],key.total_amount);
+                        if(!graph.key_ids.emplace(key.name,(uint32_t)graph.keys.size()).second){
+                            std::cout<<"Duplicated key: "<<key.name<<'\n';
+                        }
+                        graph.keys.push_back(std::move(key));
+                    }
+                }else if(rooms){
+                    Room room;
+                    room.name = sview;
+                    room.capacity=default_capacity;
+                    if(!graph.room_ids.emplace(room.name,(uint32_t)graph.rooms.size()).second){
+                        std::cout<<"Duplicated room: "<<room.name<<'\n';
+                    }
+                    graph.rooms.push_back(std::move(room));
+                }else if(doors){
+                    auto tokens = cboyo::parse::split(sview,',');
+                    if(tokens.size()!=3){
+                        std::cout<<"Error reading door: "<<sview<<'\n';
+                    }else{
+                        Door door;
+                        auto from = graph.room_ids.find(std::string(tokens[0]));
+                        auto to = graph.room_ids.find(std::string(tokens[1]));
+                        if(from==graph.room_ids.end()){
+                            std::cout<<"Error reading door: "<<sview<<" no related room: "<<tokens[0]<<'\n';
+                            return false;
+                        }
+                        if(to==graph.room_ids.end()){
+                            std::cout<<"Error reading door: "<<sview<<" no related room: "<<tokens[1]<<'\n';
+                            return false;
+                        }
+                        door.from = from->second;
+                        door.to = to->second;
+                        if(tokens[2].size()>=2){
+                            tokens[2].remove_prefix(1);
+                            tokens[2].remove_suffix(1);
+                        }
+                        //[A;B|C] opens with A and B or with C alone
+                        for(auto alternative:cboyo::parse::split(tokens[2],'|')){
+                            Requirement requirement;
+                            for(auto key_token:cboyo::parse::split(alternative,';')){
+                                auto found = graph.key_ids.find(std::string(key_token));
+                                if(found==graph.key_ids.end()){
+                                    std::cout<<"Couldnt match key : "<<key_token<<" from: "<<sview<<'\n';
+                                    return false;
+                                }
+                                requirement.push_back(found->second);
+                            }
+                            door.requirements.push_back(std::move(requirement));
+                        }
+                        graph.blockades.push_back(std::move(door));
+                    }
+                }
+            }
+        }
+        graph.n_nodes = graph.rooms.size();
+        return true;
+    }
+
+    bool solver_test1(){
+        solver::Graph graph;
+        graph.n_nodes=2;
+        graph.blockades.push_back({0u,1u,{{1u}}});
+        graph.keys.push_back({"Null",0});//Empty for null stuff
+        graph.keys.push_back({"Red key",1});
+        return solver::test_graph(graph);
+    }
+    bool solver_test2(){
+        solver::Graph graph;
+        graph.n_nodes=4;
+        graph.keys.push_back({"Null",0});//Empty for null stuff
+        graph.keys.push_back({"Red key",1});
+        graph.keys.push_back({"Yellow key",1});
+        graph.keys.push_back({"Blue key",1});
+        graph.blockades.push_back({0u,1u,{{1u}}});
+        graph.blockades.push_back({0u,2u,{{2u}}});
+        graph.blockades.push_back({0u,3u,{{3u}}});
+        return solver::test_graph(graph);
+    }
+    bool solver_test3(){
+        solver::Graph graph;
+        graph.n_nodes=5;
+        graph.keys.push_back({"Null",0});//Empty for null stuff
+        graph.keys.push_back({"Red key",1});
+        graph.keys.push_back({"Blue key",1});
+        graph.keys.push_back({"Green key",1});
+        graph.keys.push_back({"Yellow key",1});
+        graph.keys.push_back({"Magenta key",1});
+        graph.blockades.push_back({0u,1u,{{5u}}});
+        graph.blockades.push_back({1u,4u,{{1u}}});
+        graph.blockades.push_back({1u,2u,{{2u}}});
+        graph.blockades.push_back({1u,3u,{{4u}}});
+        graph.blockades.push_back({2u,3u,{{3u}}});
+        graph.blockades.push_back({3u,2u,{{3u}}});
+        return solver::test_graph(graph);
+    }
+    bool parser_test(){
+        solver::Graph graph;
+        if(solver::parse_from_file("build/ParserTest.txt",graph)){
+            auto state = solver::generate_state(graph);
+            solver::solve(graph,state);
+            solver::print_solution(graph,state);
+        }
+        return false;
+    }
+}
+}
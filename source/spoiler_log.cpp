@@ -0,0 +1,269 @@
+#include "modules/spoiler_log.hpp"
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace spoiler_log{
+    //Binary: "DS2L", u16 version, then one op byte per call with its arguments, names as ids after they are declared
+    const std::string_view magic = "DS2L";
+    constexpr uint16_t version = 1;
+    enum Op:uint8_t{End,Section,BeginRecord,EndRecord,Name,String,Signed,Unsigned,Double,Bool};
+    //Written out once this big, keeps the stream calls few without holding the whole log
+    constexpr size_t flush_size = 1<<16;
+
+    void put_u(std::string& buffer,uint64_t value){
+        while(value>=0x80){
+            buffer.push_back((char)(uint8_t)(value|0x80));
+            value>>=7;
+        }
+        buffer.push_back((char)(uint8_t)value);
+    }
+    void put_str(std::string& buffer,std::string_view value){
+        put_u(buffer,value.size());
+        buffer.append(value);
+    }
+    template<typename T>
+    void put_number(std::string& buffer,T value){
+        char text[32];
+        auto result = std::to_chars(text,text+sizeof(text),value);
+        buffer.append(text,result.ptr);
+    }
+    void put_json_str(std::string& buffer,std::string_view value){
+        buffer.push_back('"');
+        for(char c:value){
+            if(c=='"'||c=='\\'){
+                buffer.push_back('\\');
+                buffer.push_back(c);
+            }else if((uint8_t)c<0x20){
+                buffer.append("\\u00");
+                buffer.push_back("0123456789abcdef"[(uint8_t)c>>4]);
+                buffer.push_back("0123456789abcdef"[c&15]);
+            }else{
+                buffer.push_back(c);
+            }
+        }
+        buffer.push_back('"');
+    }
+
+    Format format_of(std::string_view path){
+        return path.ends_with(".json")?Format::Json:Format::Binary;
+    }
+
+    Writer::Writer(std::ostream& out,Format format):out(out),format(format){
+        buffer.reserve(flush_size+1024);
+        if(format==Format::Json){
+            buffer.push_back('{');
+        }else{
+            buffer.append(magic);
+            buffer.push_back((char)(version&0xff));
+            buffer.push_back((char)(version>>8));
+        }
+    }
+    Writer::~Writer(){
+        finish();
+    }
+    void Writer::key(std::string_view name,uint8_t op){
+        if(!in_record) close_section();
+        if(format==Format::Json){
+            bool& first = in_record?first_field:first_top;
+            if(!first) buffer.push_back(',');
+            if(!in_record) buffer.push_back('\n');
+            first = false;
+            put_json_str(buffer,name);
+            buffer.push_back(':');
+            return;
+        }
+        auto found = names.find(std::string{name});
+        if(found==names.end()){
+            buffer.push_back((char)Name);
+            put_str(buffer,name);
+            found = names.emplace(std::string{name},(uint32_t)names.size()).first;
+        }
+        buffer.push_back((char)op);
+        put_u(buffer,found->second);
+    }
+    void Writer::field(std::string_view name,std::string_view value){
+        key(name,String);
+        if(format==Format::Json) put_json_str(buffer,value);
+        else put_str(buffer,value);
+    }
+    void Writer::field(std::string_view name,bool value){
+        key(name,Bool);
+        if(format==Format::Json) buffer.append(value?"true":"false");
+        else buffer.push_back((char)value);
+    }
+    void Writer::field(std::string_view name,double value){
+        key(name,Double);
+        if(format==Format::Binary){
+            auto bits = std::bit_cast<uint64_t>(value);
+            for(int i = 0;i<8;i++,bits>>=8) buffer.push_back((char)(uint8_t)bits);
+        }else if(std::isfinite(value)){
+            put_number(buffer,value);
+        }else{
+            buffer.append("null");
+        }
+    }
+    void Writer::signed_field(std::string_view name,int64_t value){
+        key(name,Signed);
+        if(format==Format::Json) put_number(buffer,value);
+        else put_u(buffer,((uint64_t)value<<1)^(uint64_t)(value>>63));
+    }
+    void Writer::unsigned_field(std::string_view name,uint64_t value){
+        key(name,Unsigned);
+        if(format==Format::Json) put_number(buffer,value);
+        else put_u(buffer,value);
+    }
+    void Writer::section(std::string_view name){
+        if(in_record) end_record();
+        close_section();
+        if(format==Format::Json){
+            if(!first_top) buffer.push_back(',');
+            first_top = false;
+            buffer.push_back('\n');
+            put_json_str(buffer,name);
+            buffer.append(":[");
+        }else{
+            buffer.push_back((char)Section);
+            put_str(buffer,name);
+        }
+        in_section = true;
+        first_record = true;
+    }
+    void Writer::begin_record(){
+        if(in_record) end_record();
+        if(!in_section) section("records");
+        if(format==Format::Json){
+            buffer.append(first_record?"\n{":",\n{");
+        }else{
+            buffer.push_back((char)BeginRecord);
+        }
+        first_record = false;
+        first_field = true;
+        in_record = true;
+    }
+    void Writer::end_record(){
+        if(!in_record) return;
+        buffer.push_back(format==Format::Json?'}':(char)EndRecord);
+        in_record = false;
+        record_count+=1;
+        if(buffer.size()>=flush_size) flush();
+    }
+    void Writer::close_section(){
+        if(!in_section) return;
+        if(format==Format::Json) buffer.append("\n]");
+        in_section = false;
+    }
+    void Writer::flush(){
+        out.write(buffer.data(),(std::streamsize)buffer.size());
+        buffer.clear();
+    }
+    void Writer::finish(){
+        if(finished) return;
+        end_record();
+        close_section();
+        if(format==Format::Json) buffer.append("\n}\n");
+        else buffer.push_back((char)End);
+        flush();
+        out.flush();
+        finished = true;
+    }
+
+    struct StreamReader{
+        std::istream& in;
+        bool ok{true};
+        uint8_t byte(){
+            auto c = in.get();
+            if(c==std::char_traits<char>::eof()){
+                ok = false;
+                return 0;
+            }
+            return (uint8_t)c;
+        }
+        uint64_t u(){
+            uint64_t value = 0;
+            for(int shift = 0;shift<64&&ok;shift+=7){
+                auto b = byte();
+                value|=(uint64_t)(b&0x7f)<<shift;
+                if(!(b&0x80)) return value;
+            }
+            ok = false;
+            return 0;
+        }
+        std::string str(){
+            auto size = u();
+            std::string value;
+            if(!ok||size>(1u<<30)){
+                ok = false;
+                return value;
+            }
+            value.resize(size);
+            in.read(value.data(),(std::streamsize)size);
+            if(in.gcount()!=(std::streamsize)size) ok = false;
+            return value;
+        }
+    };
+    bool read_head(std::istream& in){
+        std::string head(magic.size()+2,'\0');
+        in.read(head.data(),(std::streamsize)head.size());
+        if(in.gcount()!=(std::streamsize)head.size()||std::string_view{head}.substr(0,magic.size())!=magic){
+            return false;
+        }
+        return (uint16_t)((uint8_t)head[4]|((uint8_t)head[5]<<8))<=version;
+    }
+    bool replay_ops(std::istream& in,Writer& json){
+        StreamReader reader{in};
+        std::vector<std::string> names;
+        auto name = [&]()->const std::string*{
+            auto id = reader.u();
+            if(!reader.ok||id>=names.size()){
+                reader.ok = false;
+                return nullptr;
+            }
+            return &names[id];
+        };
+        while(reader.ok){
+            auto op = reader.byte();
+            if(!reader.ok) break;
+            if(op==End) return true;
+            const std::string* field = nullptr;
+            if(op>=String&&op<=Bool){
+                field = name();
+                if(!field) break;
+            }
+            switch(op){
+                case Section: json.section(reader.str()); break;
+                case BeginRecord: json.begin_record(); break;
+                case EndRecord: json.end_record(); break;
+                case Name: names.push_back(reader.str()); break;
+                case String: json.field(*field,std::string_view{reader.str()}); break;
+                case Signed:{
+                    auto value = reader.u();
+                    json.field(*field,(int64_t)(value>>1)^-(int64_t)(value&1));
+                    break;
+                }
+                case Unsigned: json.field(*field,reader.u()); break;
+                case Double:{
+                    uint64_t bits = 0;
+                    for(int i = 0;i<8;i++) bits|=(uint64_t)reader.byte()<<(8*i);
+                    json.field(*field,std::bit_cast<double>(bits));
+                    break;
+                }
+                case Bool: json.field(*field,reader.byte()!=0); break;
+                default: reader.ok = false;
+            }
+        }
+        return false;
+    }
+    bool replay(std::istream& in,Writer& out){
+        return read_head(in)&&replay_ops(in,out);
+    }
+    bool binary_to_json(std::istream& in,std::ostream& out){
+        if(!read_head(in)) return false;
+        Writer json(out,Format::Json);
+        return replay_ops(in,json);
+    }
+}
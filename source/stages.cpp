@@ -0,0 +1,175 @@
+#include "modules/stages.hpp"
+#include "modules/utils.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace stages{
+    size_t Scheduler::add(std::string name,std::function<bool()> run,std::vector<size_t> after){
+        std::erase_if(after,[this](size_t i){return i>=stages.size();});//Only earlier stages, so there are no cycles
+        auto group = name;
+        stages.push_back({std::move(group),std::move(name),std::move(run),std::move(after)});
+        return stages.size()-1;
+    }
+    size_t Scheduler::add(std::string group,std::string name,std::function<bool()> run,const Resources& resources,std::vector<size_t> after){
+        size_t index = stages.size();
+        for(const auto& read:resources.reads){
+            auto writer = last_writer.find(read);
+            if(writer!=last_writer.end()) after.push_back(writer->second);
+        }
+        for(const auto& write:resources.writes){
+            auto writer = last_writer.find(write);
+            if(writer!=last_writer.end()) after.push_back(writer->second);
+            auto& previous = readers[write];
+            after.insert(after.end(),previous.begin(),previous.end());
+        }
+        std::sort(after.begin(),after.end());
+        after.erase(std::unique(after.begin(),after.end()),after.end());
+        for(const auto& write:resources.writes){
+            last_writer[write] = index;
+            readers[write].clear();
+        }
+        for(const auto& read:resources.reads){
+            auto& current = readers[read];
+            if(current.empty()||current.back()!=index) current.push_back(index);
+        }
+        std::erase_if(after,[index](size_t i){return i>=index;});
+        stages.push_back({std::move(group),std::move(name),std::move(run),std::move(after)});
+        return index;
+    }
+    bool Scheduler::run(size_t threads){
+        Stopwatch wall;
+        if(threads==0) threads = std::max(1u,std::thread::hardware_concurrency());
+        threads = std::min(threads,std::max<size_t>(stages.size(),1));
+        std::vector<std::vector<size_t>> next(stages.size());
+        std::vector<size_t> waiting(stages.size());
+        std::vector<size_t> ready;
+        for(size_t i = 0;i<stages.size();i++){
+            stages[i].status = Status::Pending;
+            stages[i].ms = 0.0;
+            waiting[i] = stages[i].after.size();
+            for(auto dependency:stages[i].after) next[dependency].push_back(i);
+            if(waiting[i]==0) ready.push_back(i);
+        }
+        std::mutex mutex;
+        std::condition_variable wake;
+        size_t finished = 0;
+        auto worker = [&](){
+            std::unique_lock lock(mutex);
+            while(true){
+                wake.wait(lock,[&](){return !ready.empty()||finished==stages.size();});
+                if(ready.empty()) return;
+                //Lowest index first, so a single thread runs stages in the order they were added
+                auto lowest = std::min_element(ready.begin(),ready.end());
+                auto i = *lowest;
+                ready.erase(lowest);
+                auto& stage = stages[i];
+                bool blocked = std::any_of(stage.after.begin(),stage.after.end(),[this](size_t d){return stages[d].status!=Status::Done;});
+                if(blocked){
+                    stage.status = Status::Skipped;
+                }else{
+                    lock.unlock();
+                    Stopwatch clock;
+                    bool result = false;
+                    try{
+                        result = stage.run();
+                    }catch(const std::exception& e){
+                        std::cout<<"Stage "<<stage.name<<" threw: "<<e.what()<<'\n';
+                    }
+                    auto ms = (double)clock.passed()/1000.0;
+                    lock.lock();
+                    stage.ms = ms;
+                    stage.status = result?Status::Done:Status::Failed;
+                }
+                finished++;
+                for(auto n:next[i]){
+                    if(--waiting[n]==0) ready.push_back(n);
+                }
+                wake.notify_all();
+            }
+        };
+        {
+            std::vector<std::jthread> pool;
+            for(size_t i = 1;i<threads;i++) pool.emplace_back(worker);
+            worker();
+        }
+        wall_ms = (double)wall.passed()/1000.0;
+        return std::all_of(stages.begin(),stages.end(),[](const Stage& stage){return stage.status==Status::Done;});
+    }
+    std::vector<size_t> Scheduler::critical_path()const{
+        if(stages.empty()) return {};
+        //Stages only depend on earlier ones, so index order is already a topological order
+        std::vector<double> finish(stages.size(),0.0);
+        std::vector<size_t> previous(stages.size(),SIZE_MAX);
+        for(size_t i = 0;i<stages.size();i++){
+            for(auto d:stages[i].after){
+                if(finish[d]>finish[i]){
+                    finish[i] = finish[d];
+                    previous[i] = d;
+                }
+            }
+            finish[i]+=stages[i].ms;
+        }
+        std::vector<size_t> path;
+        for(auto i = (size_t)(std::max_element(finish.begin(),finish.end())-finish.begin());i!=SIZE_MAX;i = previous[i]){
+            path.push_back(i);
+        }
+        std::reverse(path.begin(),path.end());
+        return path;
+    }
+    std::string Scheduler::to_dot()const{
+        auto path = critical_path();
+        std::vector<bool> critical(stages.size(),false);
+        for(auto i:path) critical[i] = true;
+        std::stringstream ss;
+        ss<<"digraph stages {\n";
+        ss<<"    rankdir=LR;\n";
+        ss<<"    node [shape=box];\n";
+        for(size_t i = 0;i<stages.size();i++){
+            const auto& stage = stages[i];
+            ss<<"    s"<<i<<" [label=\""<<stage.name<<"\\n"<<stage.ms<<" ms\""<<(critical[i]?", style=bold":"");
+            if(stage.status==Status::Failed) ss<<", color=red";
+            else if(stage.status==Status::Skipped) ss<<", style=dashed";
+            ss<<"];\n";
+        }
+        for(size_t i = 0;i<stages.size();i++){
+            for(auto d:stages[i].after){
+                ss<<"    s"<<d<<" -> s"<<i<<(critical[d]&&critical[i]?" [style=bold]":"")<<";\n";
+            }
+        }
+        ss<<"}\n";
+        return ss.str();
+    }
+    void Scheduler::print_timings(std::ostream& out)const{
+        struct GroupTime{
+            std::string name;
+            size_t tasks;
+            double total,longest;
+        };
+        std::vector<GroupTime> groups;
+        for(const auto& stage:stages){
+            auto found = std::find_if(groups.begin(),groups.end(),[&stage](const GroupTime& g){return g.name==stage.group;});
+            if(found==groups.end()){
+                groups.push_back({stage.group,0,0.0,0.0});
+                found = groups.end()-1;
+            }
+            found->tasks++;
+            found->total+=stage.ms;
+            found->longest = std::max(found->longest,stage.ms);
+        }
+        out<<"Stage timings, "<<wall_ms<<" ms wall:\n";
+        for(const auto& g:groups){
+            out<<"    "<<g.name<<": "<<g.total<<" ms";
+            if(g.tasks>1) out<<" in "<<g.tasks<<" tasks, longest "<<g.longest<<" ms";
+            out<<'\n';
+        }
+        auto path = critical_path();
+        double total = 0.0;
+        for(auto i:path) total+=stages[i].ms;
+        out<<"Critical path, "<<total<<" ms:";
+        for(size_t i = 0;i<path.size();i++) out<<(i?" -> ":" ")<<stages[path[i]].name;
+        out<<'\n';
+    }
+}
@@ -1,15 +1,27 @@
 #include <ds2srand/start.hxx>
+#include <modules/block_store.hpp>
 #include <modules/item_rando.hpp>
+#include <modules/output_cache.hpp>
+#include <modules/param_writes.hpp>
 #include <modules/randomizer.hpp>
+#include <modules/search.hpp>
+#include <modules/spoiler_log.hpp>
 
+#include <algorithm>
 #include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <optional>
 #include <set>
+#include <sstream>
 #include <string>
+#include <vector>
 
 namespace app {
     using Commands = std::set< std::string_view >;
-    inline Commands const commands{ "start", "enemy", "items" };
+    inline Commands const commands{ "start", "enemy", "items", "search", "archive", "analyze" };
 
     struct Args {
         std::string_view command{ };
@@ -27,7 +39,20 @@ namespace app {
             }
             for ( int i = options_from; i < argc; ++i ) options.emplace( argv[i] );
         }
+        // Values of every --name=value option
+        auto values( std::string_view name ) const -> std::vector< std::string_view > {
+            std::vector< std::string_view > found;
+            for ( auto const &option : options ) {
+                if ( option.starts_with( name ) && option.size( ) > name.size( ) && option[name.size( )] == '=' ) found.push_back( option.substr( name.size( ) + 1 ) );
+            }
+            return found;
+        }
     };
+
+    auto number( Args const &args, std::string_view name, uint64_t fallback ) -> uint64_t {
+        auto values = args.values( name );
+        return values.empty( ) ? fallback : std::stoull( std::string{ values.back( ) } );
+    }
 }
 
 namespace app::start {
@@ -42,6 +67,129 @@ namespace app::items {
     using namespace item_rando;
 }
 
+namespace app::modules {
+    // A module's own spoiler log, modules running at the same time can't share one
+    // Replayed into the run's log in module order, so the log doesn't depend on which module finished first
+    struct Log {
+        std::stringstream binary{ };
+        std::optional< spoiler_log::Writer > writer{ };
+        explicit Log( bool enabled ) {
+            if ( enabled ) writer.emplace( binary, spoiler_log::Format::Binary );
+        }
+        auto get( ) -> spoiler_log::Writer * { return writer ? &*writer : nullptr; }
+        auto replay( spoiler_log::Writer &into ) -> bool {
+            if ( !writer ) return true;
+            writer->finish( );
+            return spoiler_log::replay( binary, into );
+        }
+    };
+}
+
+namespace app::search {
+    using namespace ::search;
+
+    // Only the modules the predicates talk about are loaded, and nothing is written
+    auto run( Args const &args ) -> bool {
+        std::vector< Predicate > predicates;
+        for ( auto const &text : args.values( "--where" ) ) {
+            Predicate predicate;
+            if ( !parse_predicate( text, predicate ) ) return false;
+            if ( !enemy::is_enemy_predicate( predicate ) && !items::is_item_predicate( predicate ) ) {
+                std::cerr << "Unknown predicate kind: " << predicate.kind << std::endl;
+                return false;
+            }
+            predicates.push_back( std::move( predicate ) );
+        }
+        if ( predicates.empty( ) ) {
+            std::cerr << "search needs at least one --where=kind:subject=value" << std::endl;
+            return false;
+        }
+        Options options;
+        options.first_seed = number( args, "--first-seed", options.first_seed );
+        options.seeds = number( args, "--seeds", options.seeds );
+        options.matches = number( args, "--matches", options.matches );
+        options.threads = number( args, "--threads", options.threads );
+
+        bool need_enemy = std::ranges::any_of( predicates, enemy::is_enemy_predicate );
+        bool need_items = std::ranges::any_of( predicates, items::is_item_predicate );
+        enemy::Data dataEnemy{ };
+        items::IRData irdata{ };
+        bool valid = true;
+        if ( need_enemy ) {
+            enemy::load_data( dataEnemy );
+            for ( auto const &predicate : predicates ) {
+                if ( enemy::is_enemy_predicate( predicate ) ) valid &= enemy::validate_enemy_predicate( dataEnemy, predicate );
+            }
+        }
+        if ( need_items ) {
+            items::load_randomizer_data( irdata );
+            for ( auto const &predicate : predicates ) {
+                if ( items::is_item_predicate( predicate ) ) valid &= items::validate_item_predicate( irdata, predicate );
+            }
+        }
+
+        std::vector< uint64_t > found;
+        if ( valid ) {
+            found = ::search::run( options, [&]( uint64_t seed ) -> bool {
+                if ( need_enemy && !enemy::check_enemy_predicates( dataEnemy, seed, predicates ) ) return false;
+                if ( need_items && !items::check_item_predicates( irdata, seed, predicates ) ) return false;
+                return true;
+            } );
+            std::cout << "Matching seeds:";
+            for ( auto seed : found ) std::cout << " " << seed;
+            std::cout << std::endl;
+        }
+        return valid;
+    }
+}
+
+namespace app::analyze {
+    // Key placement of the item config, or enemy selection with --enemies, over --seeds seeds, nothing is written but the CSV files
+    auto run( Args const &args ) -> bool {
+        ::search::Options options;
+        options.first_seed = number( args, "--first-seed", options.first_seed );
+        options.seeds = number( args, "--seeds", options.seeds );
+        options.threads = number( args, "--threads", options.threads );
+        auto const values = args.values( "--csv" );
+        std::string const folder = values.empty( ) ? "analysis" : std::string{ values.back( ) };
+        if ( args.options.contains( "--enemies" ) ) {
+            enemy::Data dataEnemy{ };
+            bool ok = enemy::load_data( dataEnemy );
+            dataEnemy.config.enemy_shuffling = static_cast< uint32_t >( number( args, "--shuffle", dataEnemy.config.enemy_shuffling ) );
+            return ok && enemy::analyze_enemy_selection( dataEnemy, options, folder );
+        }
+        items::IRData irdata{ };
+        return items::load_randomizer_data( irdata ) && items::analyze_key_placement( irdata, options, folder );
+    }
+}
+
+namespace app::archive {
+    using namespace block_store;
+    inline std::filesystem::path const param_folder{ "Param" };
+
+    // Adds, extracts or drops one seed's Param folder, then shows how much the store saves
+    auto run( Args const &args ) -> bool {
+        auto const folder = args.values( "--store" );
+        if ( folder.empty( ) ) {
+            std::cerr << "archive needs --store=DIR" << std::endl;
+            return false;
+        }
+        Store store{ std::string{ folder.back( ) } };
+        bool ok = true;
+        for ( auto const &name : args.values( "--add" ) ) ok &= store.add( std::string{ name }, param_folder );
+        for ( auto const &name : args.values( "--extract" ) ) ok &= store.extract( std::string{ name }, param_folder );
+        for ( auto const &name : args.values( "--drop" ) ) ok &= store.drop( std::string{ name } );
+        if ( args.options.contains( "--list" ) ) {
+            for ( auto const &name : store.names( ) ) std::cout << name << '\n';
+        }
+        auto const stats = store.stats( );
+        std::cout << "Store: " << stats.seeds << " seeds, " << stats.files << " files, " << stats.logical_bytes << " bytes in " << stats.chunks << " chunks of " << stats.stored_bytes << " bytes";
+        if ( stats.stored_bytes ) std::cout << " (" << static_cast< double >( stats.logical_bytes ) / static_cast< double >( stats.stored_bytes ) << "x)";
+        std::cout << std::endl;
+        return ok;
+    }
+}
+
 int main( int argc, char *argv[] ) try {
     std::cout << "ds2srand [command] [options]\n";
 
@@ -52,10 +200,35 @@ int main( int argc, char *argv[] ) try {
         std::cout << "\tstart:           Scatter character starting class names and stats\n";
         std::cout << "\tenemy:           Enemies related options\n";
         std::cout << "\titems:           Items related options\n";
+        std::cout << "\tarchive:         Keep Param folders of many seeds in a deduplicated store\n";
+        std::cout << "\tanalyze:         Place key items, or pick enemies with --enemies, over many seeds and write the statistics as CSV\n";
+        std::cout << "\tsearch:          Find seeds matching every --where predicate without writing params\n";
         std::cout << "Options:\n";
         std::cout << "\t-h, --help       Show this help message\n";
         std::cout << "\t-r, --restore    Restore default " << args.command << " parameters\n";
         std::cout << "\t--optimal200     [start command only] Set all original starting classes to optimal 200 soul level\n";
+        std::cout << "\t--plan=FILE      [enemy and items commands] Save the seed's decisions to FILE instead of writing params\n";
+        std::cout << "\t--from-plan=FILE [enemy and items commands] Write params from a plan saved with --plan\n";
+        std::cout << "\t--cache=DIR      [enemy and items commands] Reuse params of seeds already made with the same config\n";
+        std::cout << "\t--cache-mb=N     [enemy and items commands] Size of the cache before least recently used seeds go (default 1024)\n";
+        std::cout << "\t--spoiler=FILE   [start, enemy and items commands] Write what the seed turned into to FILE, JSON for .json and binary otherwise\n";
+        std::cout << "\t--store=DIR      [archive command only] Store folder\n";
+        std::cout << "\t--add=NAME       [archive command only] Store the current Param folder as NAME\n";
+        std::cout << "\t--extract=NAME   [archive command only] Rebuild the Param folder of NAME\n";
+        std::cout << "\t--drop=NAME      [archive command only] Remove NAME and the chunks only it used\n";
+        std::cout << "\t--list           [archive command only] List stored seeds\n";
+        std::cout << "\t--where=P        [search command only] Predicate, repeatable:\n";
+        std::cout << "\t                   boss:<arena>=<huge|big|mid|boss name>\n";
+        std::cout << "\t                   roaming:<map name or code>=<none|any|boss name>\n";
+        std::cout << "\t                   key-in:<key>=<room>|<room>...\n";
+        std::cout << "\t                   key-before:<key>=<room>\n";
+        std::cout << "\t--matches=N      [search command only] Stop after the N lowest matching seeds (default 10)\n";
+        std::cout << "\t--seeds=N        [search and analyze commands] Seeds to check (default 100000)\n";
+        std::cout << "\t--first-seed=N   [search and analyze commands] First seed to check (default 0)\n";
+        std::cout << "\t--threads=N      [search and analyze commands] Worker threads (default all cores)\n";
+        std::cout << "\t--csv=DIR        [analyze command only] Folder of the CSV files (default analysis)\n";
+        std::cout << "\t--enemies        [analyze command only] Analyze enemy types, roaming bosses and deck reshuffles per map\n";
+        std::cout << "\t--shuffle=N      [analyze command only] Enemy shuffling mode instead of the config's, 0 single, 1 fit, 2 large, 3 random deck\n";
         std::cout << std::endl;
         return EXIT_SUCCESS;
     }
@@ -72,44 +245,120 @@ int main( int argc, char *argv[] ) try {
 
         if ( check_command( "enemy" ) ) {
             std::cout << "Restoring default parameters for enemies" << std::endl;
-            app::enemy::restore_default_params(false);
+            app::enemy::restore_default_params( { }, false );
         }
 
         if ( check_command( "items" ) ) {
             std::cout << "Restoring default parameters for items" << std::endl;
-            app::items::restore_default_params();
+            app::items::restore_default_params( { } );
         }
 
         return EXIT_SUCCESS;
     }
 
-    if ( check_command( "start" ) ) {
+    if ( args.command == "analyze" ) {
+        return app::analyze::run( args ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( args.command == "archive" ) {
+        return app::archive::run( args ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( args.command == "search" ) {
+        return app::search::run( args ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Every module run writes its sections to the same spoiler log
+    auto const spoiler_path = args.values( "--spoiler" );
+    std::ofstream spoiler_file;
+    std::optional< spoiler_log::Writer > spoiler;
+    if ( !spoiler_path.empty( ) ) {
+        std::string const path{ spoiler_path.back( ) };
+        spoiler_file.open( path, std::ios::binary );
+        if ( !spoiler_file ) {
+            std::cerr << "Can't write the spoiler log to " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+        spoiler.emplace( spoiler_file, spoiler_log::format_of( path ) );
+    }
+
+    // A plan is saved instead of params, or params are made from a saved plan instead of a new seed
+    auto const plan = args.values( "--plan" );
+    auto const from_plan = args.values( "--from-plan" );
+    auto const cache_folder = args.values( "--cache" );
+    std::optional< output_cache::Cache > cache;
+    if ( !cache_folder.empty( ) ) cache.emplace( std::string{ cache_folder.back( ) }, app::number( args, "--cache-mb", 1024u ) << 20 );
+    auto *const cache_ptr = cache ? &*cache : nullptr;
+
+    // The modules run at the same time and hand their params to one coordinator, which writes each file once they are done
+    param_writes::Coordinator writes{ "Param", { "start", "enemy", "items" } };
+    app::modules::Log start_log{ spoiler.has_value( ) }, enemy_log{ spoiler.has_value( ) }, items_log{ spoiler.has_value( ) };
+
+    auto start_task = std::async( std::launch::async, [&] {
+        if ( !check_command( "start" ) ) return;
         if ( args.options.contains( "--optimal200" ) ) {
             std::cout << "Setting all original starting classes to optimal 200 soul level" << std::endl;
-            app::start::optimal200( );
+            app::start::optimal200( &writes );
         } else {
             std::cout << "Scattering character starting class names and stats" << std::endl;
-            auto names = app::start::scatter( );
-            std::cout << "Starting class names:";
-            for ( auto const &name : names ) std::cout << " " << name;
-            std::cout << std::endl;
+            auto names = app::start::scatter( start_log.get( ), &writes );
+            std::ostringstream line;
+            line << "Starting class names:";
+            for ( auto const &name : names ) line << " " << name;
+            std::cout << line.str( ) << std::endl;
         }
-    }
+    } ).share( );
 
-    if ( check_command( "enemy" ) ) {
+    auto enemy_task = std::async( std::launch::async, [&] {
+        if ( !check_command( "enemy" ) ) return;
         app::enemy::Data dataEnemy;
         app::enemy::load_data( dataEnemy );
-        app::enemy::randomize( dataEnemy, false );
-        app::enemy::free_stuff( dataEnemy );
-    }
+        if ( !from_plan.empty( ) ) app::enemy::materialize_enemy_plan( dataEnemy, std::string{ from_plan.back( ) }, { dataEnemy.config, "Param", nullptr, enemy_log.get( ), &writes }, false );
+        else if ( !plan.empty( ) ) app::enemy::save_enemy_plan( dataEnemy, std::string{ plan.back( ) }, { dataEnemy.config } );
+        else app::enemy::randomize( dataEnemy, { dataEnemy.config, "Param", cache_ptr, enemy_log.get( ), &writes }, false );
+    } ).share( );
 
-    if ( check_command( "items" ) ) {
+    auto items_task = std::async( std::launch::async, [&, start_done = start_task] {
+        if ( !check_command( "items" ) ) return;
         app::items::IRData irdata;
         app::items::load_randomizer_data( irdata );
-        app::items::randomize_items( irdata, false );
-        app::items::free_rando_data( irdata );
+        // Classes get gear their stats can use, so the stats start is about to write are read back before anything is placed
+        if ( check_command( "start" ) ) {
+            start_done.wait( );
+            std::string classes;
+            if ( writes.preview( std::filesystem::path{ app::start::StatsData::default_path }.filename( ).string( ), classes ) ) app::items::take_class_stats( irdata, classes );
+        }
+        if ( !from_plan.empty( ) ) app::items::materialize_item_plan( irdata, std::string{ from_plan.back( ) }, { irdata.config, "Param", nullptr, items_log.get( ), &writes }, false );
+        else if ( !plan.empty( ) ) app::items::save_item_plan( irdata, std::string{ plan.back( ) }, { irdata.config } );
+        else app::items::randomize_items( irdata, { irdata.config, "Param", cache_ptr, items_log.get( ), &writes }, false );
+    } ).share( );
+
+    // Every module is waited for, what the ones that finished handed in is written even if another one failed
+    std::exception_ptr failed{ };
+    for ( auto const &task : { start_task, enemy_task, items_task } ) {
+        try {
+            task.get( );
+        } catch ( ... ) {
+            if ( !failed ) failed = std::current_exception( );
+        }
+    }
+    auto const written = writes.commit( );
+    writes.print_conflicts( );
+    if ( !written.empty( ) || !writes.conflicts( ).empty( ) ) {
+        std::cout << "Params: " << written.size( ) << " files written, " << writes.conflicts( ).size( ) << " conflicting edits" << std::endl;
     }
+    if ( spoiler ) {
+        for ( auto *log : { &start_log, &enemy_log, &items_log } ) {
+            if ( !log->replay( *spoiler ) ) std::cerr << "A module's spoiler log could not be read back" << std::endl;
+        }
+    }
+    if ( failed ) std::rethrow_exception( failed );
 
+    if ( cache ) cache->print_metrics( );
+    if ( spoiler ) {
+        spoiler->finish( );
+        std::cout << "Spoiler log: " << spoiler->records( ) << " records written to " << spoiler_path.back( ) << std::endl;
+    }
     return EXIT_SUCCESS;
 } catch (std::exception const &e) {
     std::cerr << "std::exception: " << e.what( ) << std::endl;
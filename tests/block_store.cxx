@@ -0,0 +1,75 @@
+#include "modules/block_store.hpp"
+#include "check.hxx"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace test {
+    namespace fs = std::filesystem;
+
+    auto random_bytes( size_t size, uint64_t seed ) -> std::string {
+        std::mt19937_64 generator{ seed };
+        std::string out( size, '\0' );
+        for ( auto &c : out ) c = static_cast< char >( generator( ) );
+        return out;
+    }
+
+    // Chunks respect the limits, and bytes inserted near the start leave the later boundaries where they were
+    auto chunks( ) -> bool {
+        auto data = random_bytes( 1u << 20, 1u );
+        auto ends = block_store::chunk_ends( data );
+        bool ok = !ends.empty( ) && ends.back( ) == data.size( );
+        for ( size_t i = 0, start = 0; i < ends.size( ); start = ends[i++] ) {
+            ok &= ends[i] - start <= block_store::max_chunk;
+            if ( i + 1 < ends.size( ) ) ok &= ends[i] - start >= block_store::min_chunk;
+        }
+        auto shifted = data;
+        shifted.insert( 100u, "inserted row" );
+        auto shifted_ends = block_store::chunk_ends( shifted );
+        size_t shared = 0;
+        for ( auto end : ends ) shared += std::binary_search( shifted_ends.begin( ), shifted_ends.end( ), end + 12u );
+        ok &= shared + 2u >= ends.size( );
+        ok &= block_store::chunk_ends( "" ).empty( );
+        return check( ok, "chunks" );
+    }
+
+    // Two seeds sharing most bytes cost little more than one, and dropping one keeps the other whole
+    auto store( fs::path const &root ) -> bool {
+        auto const shared = random_bytes( 200000u, 2u );
+        auto changed = random_bytes( 150000u, 3u );
+        write( root / "a" / "generatorlocation_m10_02_00_00.param", shared );
+        write( root / "a" / "EnemyParam.param", changed );
+        changed.replace( 70000u, 5u, "seed2" );
+        write( root / "b" / "generatorlocation_m10_02_00_00.param", shared );
+        write( root / "b" / "EnemyParam.param", changed );
+
+        block_store::Store store{ root / "store" };
+        bool ok = store.add( "1", root / "a" ) && store.add( "2", root / "b" );
+        auto stats = store.stats( );
+        ok &= stats.seeds == 2u && stats.files == 4u && stats.logical_bytes == 700000u;
+        ok &= stats.stored_bytes < 350000u + 2u * block_store::max_chunk;
+        ok &= store.drop( "1" );
+        ok &= store.extract( "2", root / "out" );
+        ok &= read( root / "out" / "EnemyParam.param" ) == changed && read( root / "out" / "generatorlocation_m10_02_00_00.param" ) == shared;
+        ok &= !store.extract( "1", root / "out" ) && store.names( ) == std::vector< std::string >{ "2" };
+        return check( ok, "store" );
+    }
+}
+
+int main( ) try {
+    test::Scratch const scratch{ "ds2srand_block_store_test" };
+    auto const &root = scratch.root;
+    bool passed = true;
+    passed &= test::chunks( );
+    passed &= test::store( root );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
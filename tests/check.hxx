@@ -0,0 +1,46 @@
+#ifndef OLEGEASE_DS2SRAND_TESTS_CHECK_HXX
+#define OLEGEASE_DS2SRAND_TESTS_CHECK_HXX
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+// What the tests share: a PASSED or FAILED line per check, files written and read back whole, and a scratch folder
+namespace test {
+    inline auto check( bool ok, std::string_view what ) -> bool {
+        std::cout << what << ": " << ( ok ? "PASSED" : "FAILED" ) << '\n';
+        return ok;
+    }
+
+    inline auto read( std::filesystem::path const &path ) -> std::string {
+        std::ifstream file{ path, std::ios::binary };
+        return { std::istreambuf_iterator< char >{ file }, { } };
+    }
+
+    inline auto write( std::filesystem::path const &path, std::string const &text ) {
+        std::filesystem::create_directories( path.parent_path( ) );
+        std::ofstream{ path, std::ios::binary } << text;
+    }
+
+    // A fresh folder under the temp folder, removed again with everything in it once the test is done
+    struct Scratch {
+        std::filesystem::path const root;
+        explicit Scratch( std::string_view name ) : root{ std::filesystem::temp_directory_path( ) / name } {
+            std::filesystem::remove_all( root );
+            std::filesystem::create_directories( root );
+        }
+        ~Scratch( ) {
+            std::error_code ignored;
+            std::filesystem::remove_all( root, ignored );
+        }
+        Scratch( Scratch const & ) = delete;
+        auto operator=( Scratch const & ) -> Scratch & = delete;
+    };
+}
+
+#endif
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
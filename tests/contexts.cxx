@@ -0,0 +1,346 @@
+#include <ds2srand/start.hxx>
+#include "modules/item_rando.hpp"
+#include "modules/param_editor.hpp"
+#include "modules/randomizer.hpp"
+#include "modules/spoiler_log.hpp"
+#include "check.hxx"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs of many seeds at the same time, meant to be built with -Dds2srand_ENABLE_TSAN=ON so races fail the test
+namespace test {
+    namespace fs = std::filesystem;
+    constexpr size_t threads = 8u;
+
+    template < typename T >
+    auto write( fs::path const &path, std::vector< std::pair< u64, T > > const &rows ) {
+        ParamFile< T > param{ };
+        param.header = { };
+        for ( auto const &[row, data] : rows ) add_entry( row, data, param );
+        write( path, write_param_file( param ) );
+    }
+
+    // Every file a run wrote, by name
+    auto read_folder( fs::path const &folder ) -> std::map< std::string, std::string > {
+        std::map< std::string, std::string > files;
+        if ( !fs::exists( folder ) ) return files;
+        for ( auto const &entry : fs::directory_iterator( folder ) ) files[entry.path( ).filename( ).string( )] = read( entry.path( ) );
+        return files;
+    }
+
+    // Contents of the files of a folder with the extension, names carry the time so only contents are compared
+    auto read_written( fs::path const &folder, std::string_view extension ) -> std::vector< std::string > {
+        std::vector< std::string > contents;
+        if ( !fs::exists( folder ) ) return contents;
+        for ( auto const &entry : fs::directory_iterator( folder ) ) {
+            if ( entry.path( ).extension( ) == extension ) contents.push_back( read( entry.path( ) ) );
+        }
+        std::ranges::sort( contents );
+        return contents;
+    }
+
+    // Each worker gets its own slot, the checks run once every thread joined
+    template < typename Work >
+    auto parallel( size_t count, Work work ) {
+        std::vector< std::thread > workers;
+        for ( size_t i = 0; i < count; ++i ) workers.emplace_back( work, i );
+        for ( auto &worker : workers ) worker.join( );
+    }
+
+    // Configs without a seed draw one on every thread at once, the ones with a seed keep it
+    auto configs( ) -> bool {
+        constexpr size_t rounds = 200u;
+        std::vector< std::vector< uint64_t > > drawn( threads );
+        std::vector< char > kept( threads, 1 );
+        parallel( threads, [&]( size_t worker ) {
+            for ( size_t round = 0; round < rounds; ++round ) {
+                randomizer::Config enemy{ };
+                std::istringstream enemy_text{ "#SEED 0\n#SHUFFLE_TYPE 2\n" };
+                randomizer::read_config( enemy_text, enemy );
+                drawn[worker].push_back( enemy.seed );
+                kept[worker] = kept[worker] && enemy.enemy_shuffling == 2u;
+
+                item_rando::ItemRandoConfig items{ };
+                std::istringstream item_text{ "#SEED " + std::to_string( worker + 1u ) + "\n#WEIGHT_LIMIT 50\n" };
+                item_rando::read_config( item_text, items );
+                kept[worker] = kept[worker] && items.seed == worker + 1u && items.weight_limit == 50u;
+            }
+        } );
+        std::set< uint64_t > unique;
+        for ( auto const &seeds : drawn ) unique.insert( seeds.begin( ), seeds.end( ) );
+        bool ok = std::ranges::all_of( kept, []( char value ) { return value != 0; } );
+        ok &= unique.size( ) == threads * rounds;
+        return check( ok, "configs" );
+    }
+
+    // Fresh copies of the two files scatter edits, zeroed, under root
+    auto start_files( fs::path const &root ) {
+        auto const fmg = root / ds2srand::start::MenuText::default_path;
+        auto const param = root / ds2srand::start::StatsData::default_path;
+        fs::create_directories( fmg.parent_path( ) );
+        fs::create_directories( param.parent_path( ) );
+        std::ofstream{ fmg, std::ios::binary } << std::string( 0x1400u, '\0' );
+        std::ofstream{ param, std::ios::binary } << std::string( 0x0C00u, '\0' );
+    }
+
+    struct Scattered {
+        std::string spoiler;
+        std::string param;
+        std::string fmg;
+        auto operator==( Scattered const & ) const -> bool = default;
+    };
+
+    auto scatter( fs::path const &root, uint64_t seed ) -> Scattered {
+        std::stringstream out;
+        {
+            ds2srand::start::Context context{ seed, root };
+            spoiler_log::Writer log{ out, spoiler_log::Format::Json };
+            ds2srand::start::scatter( context, &log );
+        }
+        return { out.str( ), read( root / ds2srand::start::StatsData::default_path ), read( root / ds2srand::start::MenuText::default_path ) };
+    }
+
+    // Every seed scattered at once into its own folder comes out the same as the seed alone
+    auto start( fs::path const &root ) -> bool {
+        std::vector< Scattered > runs( threads );
+        for ( size_t i = 0; i < threads; ++i ) start_files( root / std::to_string( i ) );
+        parallel( threads, [&]( size_t worker ) {
+            runs[worker] = scatter( root / std::to_string( worker ), 1000u + worker );
+        } );
+        bool ok = true;
+        for ( size_t i = 0; i < threads; ++i ) {
+            auto const alone = root / ( "alone" + std::to_string( i ) );
+            start_files( alone );
+            ok &= scatter( alone, 1000u + i ) == runs[i];
+            ok &= runs[i].spoiler.find( "\"start_classes\"" ) != std::string::npos;
+        }
+        ok &= runs[0].param != runs[1].param;
+        return check( ok, "start" );
+    }
+
+    // One map of four enemy types, a roaming boss with its arena and an NPC, in the layout load_data reads
+    auto enemy_data( fs::path const &game ) {
+        auto const data = game / "data/enemy_rando";
+        auto const code = std::string{ "m10_02_00_00" };
+        std::vector< std::pair< u64, Generator > > generators;
+        std::vector< std::pair< u64, Location > > locations;
+        std::string types;
+        auto add_generator = [&]( u64 row, u32 regist, std::string const &type ) {
+            Generator generator{ };
+            generator.generator_regist_param = regist;
+            generator.ai_think_id = 100000u + regist % 100u;
+            generators.push_back( { row, generator } );
+            locations.push_back( { row, Location{ { float( row ), 0.f, 0.f }, { }, 0u, 0u } } );
+            types += std::to_string( row ) + " Entity [" + type + "]\n";
+        };
+        for ( u32 i = 0; i < 16u; ++i ) add_generator( 100u + i, 10000u + i % 4u, "ENEMY" );
+        add_generator( 500u, 72300000u, "NPC" );
+        add_generator( 900u, 30000000u, "BOSS" );
+        std::vector< std::pair< u64, Register > > registers;
+        for ( s32 i = 0; i < 4; ++i ) registers.push_back( { 10000u + i, Register{ 101000 + 1000 * i, 101020 + i, 101000 + i, 0u, 1u, 0u } } );
+        registers.push_back( { 30000000u, Register{ 300000, 300020, 300000, 0u, 2u, 0u } } );
+        registers.push_back( { 72300000u, Register{ 723000, 723020, 723000, 0u, 3u, 0u } } );
+        write( data / "Params/generator" / ( "generatorparam_" + code + ".param" ), generators );
+        write( data / "Params/generator_regist" / ( "generatorregistparam_" + code + ".param" ), registers );
+        write( data / "Params/generator_location" / ( "generatorlocation_" + code + ".param" ), locations );
+        write( data / "map_enemy_types" / ( code + ".txt" ), types );
+
+        // Rows from 400000 on are where balanced copies go, the last row leaves a gap for them
+        std::vector< std::pair< u64, EnemyParam > > enemies;
+        for ( s32 id : { 101000, 102000, 103000, 104000, 300000, 723000, 900000 } ) {
+            EnemyParam param{ };
+            param.id = id;
+            param.hp = 1000 + id / 1000;
+            param.spawn_limit = 3u;
+            param.defense = 100;
+            param.souls_held = 50;
+            param.dmg_mult = 1.f;
+            param.item_lot = 40;
+            enemies.push_back( { u64( id ), param } );
+        }
+        write( data / "Params/EnemyParam.param", enemies );
+        ChrRoundDamageParam damage{ };
+        damage.out[1].dmg = 120u;
+        write( data / "Params/ChrRoundDamageParam.param", std::vector< std::pair< u64, ChrRoundDamageParam > >{ { 0u, damage }, { 1u, damage } } );
+
+        write( data / "enemies/enemy_properties.txt", "1010,Hollow,1,1\n1020,Soldier,1,1\n1030,Dog,2,1\n1040,Knight,2,2\n" );
+        write( data / "enemies/enemies.txt", "101000 Hollow\n102000 Soldier\n103000 Dog\n104000 Knight\n" );
+        write( data / "enemies/boss_properties.txt", "3000,Pursuer,2,2,10000\n" );
+        write( data / "enemies/bosses.txt", "300000 Pursuer\n" );
+        write( data / "enemies/boss_arena.txt", "10020000,[900],Pursuer Arena,2,3000,1.5,300\n" );
+        write( data / "enemies/repositioning.txt", "10020000,100,(1.5;2.5;3.5)\n" );
+    }
+
+    struct Randomized {
+        std::string spoiler;
+        std::map< std::string, std::string > params;
+        std::vector< std::string > cheatsheets;
+        size_t graphs;
+        bool done;
+        auto operator==( Randomized const & ) const -> bool = default;
+    };
+
+    auto enemy_config( uint64_t seed ) -> randomizer::Config {
+        randomizer::Config config{ };
+        std::istringstream text{ "#SEED " + std::to_string( seed ) + "\n#CHEATSHEET 1\n#STAGE_GRAPH 1\n#ROAMING_BOSS 1\n#ROAMING_CHANCE 20\n" };
+        randomizer::read_config( text, config );
+        config.valid = true;
+        return config;
+    }
+
+    auto enemies_run( randomizer::Data const &data, fs::path const &out, uint64_t seed, size_t stage_threads ) -> Randomized {
+        std::stringstream spoiler;
+        bool done = false;
+        {
+            spoiler_log::Writer log{ spoiler, spoiler_log::Format::Json };
+            done = randomizer::randomize( data, { enemy_config( seed ), out / "Param", nullptr, &log, nullptr, out / "cheatsheets", stage_threads }, false );
+        }
+        return { spoiler.str( ), read_folder( out / "Param" ), read_written( out / "cheatsheets", ".txt" ), read_written( out / "cheatsheets", ".dot" ).size( ), done };
+    }
+
+    // Enemy selection, bosses and NPC cloning of every seed at once from one loaded table come out the same as the seed alone, cheatsheets and stage graphs included
+    // Seeds at once run their stages inline, the seed alone on a thread per core
+    auto enemies( fs::path const &root ) -> bool {
+        randomizer::Data data;
+        if ( !randomizer::load_data( data ) ) return check( false, "enemies" );
+        std::vector< Randomized > runs( threads );
+        parallel( threads, [&]( size_t worker ) {
+            runs[worker] = enemies_run( data, root / "enemies" / std::to_string( worker ), 2000u + worker, 1u );
+        } );
+        bool ok = true;
+        for ( size_t i = 0; i < threads; ++i ) {
+            ok &= runs[i].done && enemies_run( data, root / "enemies" / ( "alone" + std::to_string( i ) ), 2000u + i, 0u ) == runs[i];
+            ok &= runs[i].spoiler.find( "\"generators\"" ) != std::string::npos && runs[i].spoiler.find( "\"arenas\"" ) != std::string::npos;
+            ok &= runs[i].cheatsheets.size( ) == 1u && runs[i].graphs == 1u;
+        }
+        ok &= runs[0].params.contains( "EnemyParam.param" ) && runs[0].params != runs[1].params;
+        return check( ok, "enemies" );
+    }
+
+    // A key graph of two locked rooms past the six always open ones, and lots, gear and shops for every stage
+    auto item_data( fs::path const &game ) {
+        auto const data = game / "data/item_rando";
+        write( data / "ItemLots/Drangleic.txt",
+               "#KEYS\nRed Key,1\nBlue Key,1\n"
+               "#ROOMS\nThings Betwixt\nMajula\nHeides Tower\nUnseen path to Heide\nNo Mans Warf\nForest Fallen Giants\nRed Room\nBlue Room\n"
+               "#DOORS\nThings Betwixt,Majula,[NULL]\nMajula,Heides Tower,[NULL]\nMajula,Unseen path to Heide,[NULL]\n"
+               "Majula,No Mans Warf,[NULL]\nMajula,Forest Fallen Giants,[NULL]\nMajula,Red Room,[Red Key]\nRed Room,Blue Room,[Blue Key]\n" );
+        std::vector< s32 > const unmissable{ 10000, 10010, 10100, 10110, 10200, 10300, 10310, 10400, 10410, 10500, 10510 };
+        std::string other_lots{ "#UNMISSABLE\n" };
+        for ( auto lot : unmissable ) other_lots += std::to_string( lot ) + ";Lot " + std::to_string( lot ) + "\n";
+        other_lots += "#MISSABLE\n11000;Ledge\n11010;Jump\n11020;Drop\n#DONTCHANGE\n12000;Estus\n";
+        write( data / "ItemLots/OtherLots.txt", other_lots );
+        write( data / "ItemLots/CharacterLots.txt",
+               "#GUARANTEED_DROP\n20000,Guard,Drop\n20010,Merchant,Drop\n"
+               "#ENEMY_DROPS\n101000000,Hollow,Drop\n101000001,Hollow,Drop\n102000000,Soldier,Drop\n#REMOVE\n30000,Gone,Drop\n" );
+        write( data / "ItemLots/FloorItems.txt",
+               "#Things Betwixt\n10000,10010\n#Majula\n10100,10110\n#Heides Tower\n10200\n"
+               "#Forest Fallen Giants\n10300,10310\n#Red Room\n10400,10410\n#Blue Room\n10500,10510\n" );
+        write( data / "ItemLots/EventLots.txt", "13000,Majula,Event\n" );
+        write( data / "ItemLots/KeyItemLots.txt", "#52200000,Spare Key\nOther,11000,1,100\n" );
+        write( data / "ItemLots/EquivalentLots.txt", "11000,11020\n" );
+        write( data / "ItemLots/ShopsData.txt",
+               "#COMMON\n77700000,Shop A\n77700001,Shop B\n77700002,Shop C\n77700003,Shop D\n77700004,Shop E\n"
+               "#STRAID_TRADE\n77100000,Straid A\n#ORNIFEX_TRADE\n77600000,Ornifex A\n#REMOVE\n77700005,Removed\n" );
+        write( data / "Items/Item.txt",
+               "#KEYS\n52000000,1,Red Key\n52100000,1,Blue Key\n52200000,1,Spare Key\n"
+               "#ITEMS\n60010000,20,Normal,Lifegem\n60020000,6,Single,Amber Herb\n60350000,10,Pack5,Homeward Bone\n60760000,60,Proj,Wood Arrow\n"
+               "#RINGS\n40010000,1,Life Ring\n40020000,1,Ring of Blades\n"
+               "#WEAPONS\n1000000,1,Dagger\n1100000,1,Broadsword\n1200000,1,Mace\n11000000,1,Buckler\n3800000,1,Staff\n"
+               "#SPELLS\n31010000,1,Soul Arrow\n"
+               "#ARMOR\n11010100,1,Hollow Helm\n11010101,1,Hollow Chest\n11010102,1,Hollow Gloves\n11010103,1,Hollow Boots\n" );
+        write( data / "Items/WeaponData.txt",
+               "1000000,5,8,0,0,1.5,All,10\n1100000,10,10,0,0,3.0,Basic,10\n1200000,12,0,0,0,4.0,No bleed,5\n"
+               "11000000,5,0,0,0,1.0,None,10\n3800000,3,0,8,0,1.0,Magic dark,5\n" );
+        write( data / "Items/ArmorData.txt", "1010100,0,0,0,0,2.0\n1010101,0,0,0,0,5.0\n1010102,0,0,0,0,1.5\n1010103,0,0,0,0,2.5\n" );
+        write( data / "Items/SpellData.txt", "31010000,0,10,0,1\n" );
+        write( data / "Items/RingData.txt", "40010000,0.5\n40020000,0.8\n" );
+
+        std::vector< std::pair< u64, ShopItem > > shop;
+        for ( u64 row : { 77100000u, 77600000u, 77601000u, 77700000u, 77700001u, 77700002u, 77700003u, 77700004u, 77700005u } ) shop.push_back( { row, ShopItem{ } } );
+        write( data / "Params/ShopLineupParam.param", shop );
+        std::vector< std::pair< u64, ItemLot > > other;
+        for ( auto lot : unmissable ) other.push_back( { u64( lot ), ItemLot{ } } );
+        for ( u64 row : { 11000u, 11010u, 11020u, 12000u } ) other.push_back( { row, ItemLot{ } } );
+        for ( u64 j = 0; j < 400u; j += 100u ) {
+            for ( u64 i = 0; i < 4u; ++i ) other.push_back( { 50000000u + j + i, ItemLot{ } } );
+        }
+        std::sort( other.begin( ), other.end( ), []( auto const &a, auto const &b ) { return a.first < b.first; } );
+        other.push_back( { 50001000u, ItemLot{ } } );
+        write( data / "Params/ItemLotParam2_Other.param", other );
+        std::vector< std::pair< u64, ItemLot > > chr;
+        for ( u64 row : { 20000u, 20010u, 30000u, 101000000u, 101000001u, 102000000u } ) chr.push_back( { row, ItemLot{ } } );
+        write( data / "Params/ItemLotParam2_Chr.param", chr );
+        std::vector< std::pair< u64, PlayerStatus > > classes;
+        for ( u64 row : { 20u, 30u, 50u, 70u, 80u, 90u, 100u, 110u, 510u, 520u, 530u, 540u, 550u, 560u, 570u } ) classes.push_back( { row, PlayerStatus{ } } );
+        write( data / "Params/PlayerStatusParam.param", classes );
+    }
+
+    auto item_config( uint64_t seed ) -> item_rando::ItemRandoConfig {
+        item_rando::ItemRandoConfig config{ };
+        std::istringstream text{ "#SEED " + std::to_string( seed ) + "\n#CHEATSHEET 1\n" };
+        item_rando::read_config( text, config );
+        config.valid = true;
+        return config;
+    }
+
+    auto items_run( item_rando::IRData const &irdata, fs::path const &out, uint64_t seed, size_t stage_threads ) -> Randomized {
+        std::stringstream spoiler;
+        bool done = false;
+        {
+            spoiler_log::Writer log{ spoiler, spoiler_log::Format::Json };
+            done = item_rando::randomize_items( irdata, { item_config( seed ), out / "Param", nullptr, &log, nullptr, out / "cheatsheets", stage_threads }, false );
+        }
+        return { spoiler.str( ), read_folder( out / "Param" ), read_written( out / "cheatsheets", ".txt" ), 0u, done };
+    }
+
+    // Key placement, item stages and classes of every seed at once from one loaded data set come out the same as the seed alone, cheatsheets included
+    // Seeds at once run their stages inline, the seed alone on a thread per core
+    auto items( fs::path const &root ) -> bool {
+        item_rando::IRData irdata{ };
+        if ( !item_rando::load_randomizer_data( irdata ) ) return check( false, "items" );
+        std::vector< Randomized > runs( threads );
+        parallel( threads, [&]( size_t worker ) {
+            runs[worker] = items_run( irdata, root / "items" / std::to_string( worker ), 3000u + worker, 1u );
+        } );
+        bool ok = true;
+        for ( size_t i = 0; i < threads; ++i ) {
+            ok &= runs[i].done && items_run( irdata, root / "items" / ( "alone" + std::to_string( i ) ), 3000u + i, 0u ) == runs[i];
+            ok &= runs[i].spoiler.find( "\"lots\"" ) != std::string::npos && runs[i].params.size( ) == 4u && runs[i].cheatsheets.size( ) == 1u;
+        }
+        ok &= runs[0].params != runs[1].params;
+        return check( ok, "items" );
+    }
+}
+
+int main( ) try {
+    test::Scratch const scratch{ "ds2srand_contexts_test" };
+    auto const &root = scratch.root;
+    auto const cwd = std::filesystem::current_path( );
+    bool passed = true;
+    passed &= test::configs( );
+    passed &= test::start( root );
+    // The randomizers read their data from the working folder
+    test::enemy_data( root / "game" );
+    test::item_data( root / "game" );
+    std::filesystem::current_path( root / "game" );
+    passed &= test::enemies( root );
+    passed &= test::items( root );
+    std::filesystem::current_path( cwd );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
@@ -0,0 +1,71 @@
+#include "modules/output_cache.hpp"
+#include "check.hxx"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace test {
+    namespace fs = std::filesystem;
+
+    auto keys( ) -> bool {
+        auto key = output_cache::make_key( "items", "#SEED 1\n", 1u, 7u );
+        bool ok = key == output_cache::make_key( "items", "#SEED 1\n", 1u, 7u );
+        ok &= key != output_cache::make_key( "enemies", "#SEED 1\n", 1u, 7u );
+        ok &= key != output_cache::make_key( "items", "#SEED 1\n", 2u, 7u );
+        ok &= key != output_cache::make_key( "items", "#SEED 1\n", 1u, 8u );
+        ok &= key != output_cache::make_key( "items", "#SEED 2\n", 1u, 7u );
+        return check( ok, "keys" );
+    }
+
+    // A served file is replaced, never written through, so the entry stays as stored
+    auto serve( fs::path const &root ) -> bool {
+        auto out = root / "Param";
+        write( out / "Linked.param", "linked" );
+        write( out / "Copied.param", "copied" );
+        output_cache::Cache cache{ root / "cache", 1u << 20 };
+        bool ok = !cache.serve( "key", out );
+        cache.store( "key", { { out / "Linked.param", true }, { out / "Copied.param", false } } );
+        write( out / "Linked.param", "changed" );
+        write( out / "Copied.param", "changed" );
+        ok &= cache.serve( "key", out );
+        ok &= read( out / "Linked.param" ) == "linked" && read( out / "Copied.param" ) == "copied";
+        std::ofstream{ out / "Copied.param", std::ios::binary | std::ios::in | std::ios::out } << "edited";
+        ok &= read( root / "cache" / "key" / "Copied.param" ) == "copied";
+        return check( ok, "serve" );
+    }
+
+    // Three entries of 100 bytes under a 250 byte cap, the one used longest ago goes
+    auto evict( fs::path const &root ) -> bool {
+        auto out = root / "Param";
+        write( out / "A.param", std::string( 100u, 'a' ) );
+        output_cache::Cache cache{ root / "lru", 250u };
+        auto now = fs::file_time_type::clock::now( );
+        cache.store( "old", { { out / "A.param", true } } );
+        cache.store( "used", { { out / "A.param", true } } );
+        fs::last_write_time( root / "lru" / "old", now - std::chrono::hours{ 2 } );
+        fs::last_write_time( root / "lru" / "used", now - std::chrono::hours{ 1 } );
+        bool ok = cache.serve( "old", out );
+        cache.store( "new", { { out / "A.param", true } } );
+        ok &= fs::exists( root / "lru" / "old" ) && !fs::exists( root / "lru" / "used" ) && fs::exists( root / "lru" / "new" );
+        return check( ok, "evict" );
+    }
+}
+
+int main( ) try {
+    test::Scratch const scratch{ "ds2srand_cache_test" };
+    auto const &root = scratch.root;
+    bool passed = true;
+    passed &= test::keys( );
+    passed &= test::serve( root );
+    passed &= test::evict( root );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
@@ -0,0 +1,140 @@
+#include "modules/param_editor.hpp"
+#include "modules/param_writes.hpp"
+#include "check.hxx"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace test {
+    namespace fs = std::filesystem;
+
+    struct Row {
+        uint16_t soul_level;
+        uint16_t vigor;
+        int32_t weapon;
+    };
+
+    // Rows 20, 30 and 50 with the same stats, weapon tells them apart
+    auto param( int32_t weapon = 0 ) -> ParamFile< Row > {
+        ParamFile< Row > file{ };
+        file.header = { };
+        for ( uint64_t row : { 20u, 30u, 50u } ) add_entry( row, Row{ 10u, 5u, weapon + static_cast< int32_t >( row ) }, file );
+        return file;
+    }
+
+    auto text( ParamFile< Row > file ) -> std::string { return write_param_file( file ); }
+
+    auto bytes( auto value ) -> std::string { return std::string( reinterpret_cast< char const * >( &value ), sizeof( value ) ); }
+
+    // Offset of a row's data in the file, the way the start module knows its fields
+    auto offset_of( std::string const &file, size_t index ) -> uint64_t {
+        ParamRowInfo info{ };
+        std::memcpy( &info, file.data( ) + sizeof( ParamHeader ) + sizeof( ParamRowInfo ) * index, sizeof( info ) );
+        return info.initial_byte;
+    }
+
+    auto diff( ) -> bool {
+        auto changed = param( );
+        changed.data[1].weapon = 7;
+        std::vector< param_writes::Edit > edits;
+        bool ok = param_writes::diff( text( param( ) ), text( changed ), edits );
+        ok &= edits.size( ) == 1u && edits[0].row == 30u && edits[0].offset == offsetof( Row, weapon );
+        auto fewer = param( );
+        fewer.row_info.pop_back( );
+        fewer.data.pop_back( );
+        ok &= !param_writes::diff( text( param( ) ), text( fewer ), edits );
+        return check( ok, "diff" );
+    }
+
+    struct Merged {
+        std::string contents;
+        std::string preview;
+        size_t written;
+        std::vector< param_writes::Conflict > conflicts;
+    };
+
+    // Items hands in the vanilla file and its own rows, start edits stats by file offset
+    auto merge_run( fs::path const &out, bool threads ) -> Merged {
+        param_writes::Coordinator writes{ out, { "start", "enemy", "items" } };
+        auto const vanilla = text( param( ) );
+        auto items = param( );
+        items.data[0].weapon = 1234;
+        items.data[2].vigor = 9;
+        std::vector< param_writes::Edit > edits;
+        param_writes::diff( vanilla, text( items ), edits );
+        auto start = [&] {
+            writes.submit_at( "start", "Classes.param", offset_of( vanilla, 0 ) + offsetof( Row, vigor ), bytes( uint16_t{ 40u } ) );
+            writes.submit_at( "start", "Classes.param", offset_of( vanilla, 2 ) + offsetof( Row, vigor ), bytes( uint16_t{ 12u } ) );
+        };
+        auto item = [&] {
+            writes.submit_file( "items", "Classes.param", vanilla );
+            writes.submit_edits( "items", "Classes.param", edits );
+            writes.submit_file( "items", "Shop.param", "shop" );
+        };
+        if ( threads ) {
+            std::thread a{ item }, b{ start };
+            a.join( );
+            b.join( );
+        } else {
+            start( );
+            item( );
+        }
+        Merged merged{ };
+        writes.preview( "Classes.param", merged.preview );
+        merged.written = writes.commit( ).size( );
+        merged.contents = read( out / "Classes.param" );
+        merged.conflicts = writes.conflicts( );
+        return merged;
+    }
+
+    // Either order of submissions writes the same file, the stats start set win over the ones items changed
+    auto merge( fs::path const &root ) -> bool {
+        auto first = merge_run( root / "first", false );
+        auto second = merge_run( root / "second", true );
+        auto rows = read_param_file< Row >( first.contents );
+        bool ok = first.contents == second.contents && first.preview == first.contents && first.written == 2u;
+        ok &= read( root / "second" / "Shop.param" ) == "shop";
+        ok &= rows.data.size( ) == 3u && rows.data[0].vigor == 40u && rows.data[0].weapon == 1234;
+        ok &= rows.data[2].vigor == 12u && rows.data[1].vigor == 5u;
+        ok &= second.conflicts.size( ) == 1u && second.conflicts[0].row == 50u && second.conflicts[0].kept == "start" && second.conflicts[0].dropped == "items";
+        return check( ok, "merge" );
+    }
+
+    // Without a whole file the one in the out folder is edited, and a lone linked file is linked
+    auto on_disk( fs::path const &root ) -> bool {
+        auto out = root / "disk";
+        auto const current = text( param( 100 ) );
+        write( out / "Classes.param", current );
+        write( root / "cache" / "Enemy.param", "enemy" );
+        param_writes::Coordinator writes{ out, { "start" } };
+        writes.submit_at( "start", "Classes.param", offset_of( current, 1 ), bytes( uint16_t{ 99u } ) );
+        writes.submit_link( "enemy", "Enemy.param", root / "cache" / "Enemy.param" );
+        writes.submit_at( "start", "Missing.param", 0u, "x" );
+        auto written = writes.commit( );
+        auto merged = read_param_file< Row >( read( out / "Classes.param" ) );
+        bool ok = written.size( ) == 2u && merged.data[1].soul_level == 99u && merged.data[1].weapon == 130;
+        ok &= read( out / "Enemy.param" ) == "enemy" && !fs::exists( out / "Missing.param" );
+        return check( ok, "on_disk" );
+    }
+}
+
+int main( ) try {
+    test::Scratch const scratch{ "ds2srand_param_writes_test" };
+    auto const &root = scratch.root;
+    bool passed = true;
+    passed &= test::diff( );
+    passed &= test::merge( root );
+    passed &= test::on_disk( root );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
@@ -0,0 +1,70 @@
+#include "modules/plan_file.hpp"
+#include "check.hxx"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace test {
+    auto numbers( ) -> bool {
+        plan_file::Writer out;
+        int64_t const values[]{ 0, -1, 1, 63, -64, 10105000, -10105000, std::numeric_limits< int64_t >::min( ), std::numeric_limits< int64_t >::max( ) };
+        for ( auto v : values ) out.s( v );
+        out.u( std::numeric_limits< uint64_t >::max( ) );
+        out.f( 100.f );
+        out.str( "Pursuer" );
+        plan_file::Reader in{ out.data };
+        bool ok = true;
+        for ( auto v : values ) ok &= in.s( ) == v;
+        ok &= in.u( ) == std::numeric_limits< uint64_t >::max( );
+        ok &= in.f( ) == 100.f;
+        ok &= in.str( ) == "Pursuer";
+        ok &= in.ok && in.done( );
+        in.u( );
+        ok &= !in.ok;
+        std::string const overflow = std::string( 9u, '\xff' ) + '\x02';
+        plan_file::Reader too_long{ overflow };
+        too_long.u( );
+        ok &= !too_long.ok;
+        return check( ok, "varints" );
+    }
+
+    auto container( ) -> bool {
+        std::vector< plan_file::Section > sections{ { "ECFG", "#SEED 7\n" }, { "ENMY", std::string( "\0\1\2", 3 ) } };
+        auto bytes = plan_file::write( sections );
+        std::vector< plan_file::Section > read;
+        bool ok = plan_file::read( bytes, read ) && read.size( ) == 2 && read[1].tag == "ENMY" && read[1].data == sections[1].data;
+        bytes[8] ^= 1;
+        std::vector< plan_file::Section > corrupted;
+        ok &= !plan_file::read( bytes, corrupted );
+        return check( ok, "container" );
+    }
+
+    // Saving one module's sections keeps the other module's ones
+    auto merge( ) -> bool {
+        test::Scratch const scratch{ "ds2srand_plan_test" };
+        auto const path = scratch.root / "plan.ds2p";
+        bool ok = plan_file::save( path, { { "ECFG", "a" }, { "ENMY", "b" } } );
+        ok &= plan_file::save( path, { { "ICFG", "c" }, { "ENMY", "d" } } );
+        std::vector< plan_file::Section > read;
+        ok &= plan_file::load( path, read ) && read.size( ) == 3;
+        auto enemy = plan_file::find( read, "ENMY" );
+        ok &= enemy && enemy->data == "d" && plan_file::find( read, "ECFG" ) && plan_file::find( read, "ICFG" );
+        return check( ok, "merge" );
+    }
+}
+
+int main( ) try {
+    bool passed = true;
+    passed &= test::numbers( );
+    passed &= test::container( );
+    passed &= test::merge( );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
@@ -0,0 +1,344 @@
+#include "modules/solver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace test {
+    using namespace item_rando;
+
+    struct Options {
+        size_t rooms{ 500u };
+        size_t keys{ 50u };
+        uint64_t seeds{ 256u };
+        uint64_t first_seed{ 0u };
+        unsigned threads{ std::max( 1u, std::thread::hardware_concurrency( ) ) };
+        bool unit{ false };
+        bool fuzz{ true };
+
+        Options( int argc, char* argv[] ) {
+            for ( int i = 1; i < argc; ++i ) {
+                std::string_view arg{ argv[i] };
+                auto value = [&arg]( std::string_view name ) -> std::string_view {
+                    if ( arg.starts_with( name ) && arg.size( ) > name.size( ) && arg[name.size( )] == '=' ) return arg.substr( name.size( ) + 1 );
+                    return { };
+                };
+                if ( arg == "--unit" ) { unit = true; fuzz = false; }
+                else if ( auto v = value( "--rooms" ); !v.empty( ) ) rooms = std::stoull( std::string{ v } );
+                else if ( auto v = value( "--keys" ); !v.empty( ) ) keys = std::stoull( std::string{ v } );
+                else if ( auto v = value( "--seeds" ); !v.empty( ) ) seeds = std::stoull( std::string{ v } );
+                else if ( auto v = value( "--first-seed" ); !v.empty( ) ) first_seed = std::stoull( std::string{ v } );
+                else if ( auto v = value( "--threads" ); !v.empty( ) ) threads = std::max( 1u, static_cast< unsigned >( std::stoul( std::string{ v } ) ) );
+                else throw std::runtime_error( "Unknown option: " + std::string{ arg } );
+            }
+            if ( rooms < 2 ) throw std::runtime_error( "--rooms must be at least 2" );
+        }
+    };
+
+    // Rooms hang off a random spanning tree rooted at room 0 plus some shortcuts, so every room is reachable with all keys
+    auto synthetic_graph( size_t n_rooms, size_t n_keys, uint64_t seed ) -> solver::Graph {
+        std::mt19937_64 generator{ seed };
+        auto roll = [&generator]( unsigned percent ) -> bool { return generator( ) % 100u < percent; };
+        auto any_key = [&generator, n_keys]( ) -> uint32_t { return n_keys ? static_cast< uint32_t >( 1u + generator( ) % n_keys ) : 0u; };
+        auto requirement = [&]( solver::Door &door ) {
+            solver::Requirement keys;
+            if ( roll( 30u ) ) keys.push_back( any_key( ) );
+            if ( roll( 5u ) ) keys.push_back( any_key( ) );
+            door.requirements.push_back( std::move( keys ) );
+            if ( roll( 10u ) ) door.requirements.push_back( { any_key( ), any_key( ) } );
+        };
+
+        solver::Graph graph;
+        graph.n_nodes = n_rooms;
+        graph.keys.push_back( { "NULL", 1u } );
+        for ( size_t i = 0; i < n_keys; ++i ) graph.keys.push_back( { "Key " + std::to_string( i + 1 ), 1u } );
+        for ( size_t i = 0; i < n_rooms; ++i ) graph.rooms.push_back( { "Room " + std::to_string( i ), 99999u } );
+        for ( uint32_t to = 1; to < n_rooms; ++to ) {
+            auto from = static_cast< uint32_t >( generator( ) % to );
+            solver::Door door{ from, to, { } };
+            requirement( door );
+            graph.blockades.push_back( door );
+            if ( roll( 80u ) ) graph.blockades.push_back( { to, from, { } } );
+        }
+        for ( size_t i = 0; i < n_rooms / 4; ++i ) {
+            solver::Door door{ static_cast< uint32_t >( generator( ) % n_rooms ), static_cast< uint32_t >( generator( ) % n_rooms ), { } };
+            requirement( door );
+            graph.blockades.push_back( door );
+        }
+        return graph;
+    }
+
+    // 0 <-> 1 <-> 2 and 0 -> 3 behind Key 1, which sits in room 2
+    auto reachable( ) -> bool {
+        solver::Graph graph;
+        graph.n_nodes = 4u;
+        graph.keys = { { "NULL", 1u }, { "Key 1", 1u } };
+        for ( size_t i = 0; i < graph.n_nodes; ++i ) graph.rooms.push_back( { "Room " + std::to_string( i ), 99999u } );
+        graph.blockades = { { 0u, 1u, { } }, { 1u, 0u, { } }, { 1u, 2u, { } }, { 2u, 1u, { } }, { 0u, 3u, { { 1u } } } };
+        auto state = solver::generate_state( graph );
+        state.placements[1].node.push_back( 2u );
+        auto all = solver::reachable_rooms( graph, state );
+        auto without_1 = solver::reachable_rooms( graph, state, 1u );
+        bool passed = all.count( ) == 4u && without_1.count( ) == 1u && without_1.test( 0u ) && !without_1.test( 1u ) && !without_1.test( 3u );
+        std::cout << "reachable rooms: " << ( passed ? "PASSED" : "FAILED" ) << '\n';
+        return passed;
+    }
+
+    // 0 -> 1 needs all five keys or Key 6, 1 -> 2 needs Key 1 and Key 2 or Key 3, keys are given by name like Drangleic.txt
+    auto requirements( ) -> bool {
+        auto path = std::filesystem::temp_directory_path( ) / "ds2srand_requirements_test.txt";
+        std::ofstream{ path } << "#KEYS\nKey 1,1\nKey 2,1\nKey 3,1\nKey 4,1\nKey 5,1\nKey 6,1\n#ROOMS\nStart\nMiddle\nEnd\n#DOORS\n"
+                                 "Start,Middle,[Key 1;Key 2;Key 3;Key 4;Key 5|Key 6]\nMiddle,End,[Key 1;Key 2|Key 3]\n";
+        solver::Graph graph;
+        bool passed = solver::parse_from_file( path, graph ) && graph.blockades.size( ) == 2u && graph.blockades[0].requirements.size( ) == 2u && graph.blockades[0].requirements[0].size( ) == 5u;
+        std::filesystem::remove( path );
+        auto rooms_with = [&graph]( std::vector< uint32_t > const &keys ) -> size_t {
+            auto state = solver::generate_state( graph );
+            for ( auto key : keys ) state.placements[key].node.push_back( 0u );
+            return solver::reachable_rooms( graph, state ).count( );
+        };
+        if ( passed ) {
+            passed &= rooms_with( { 1u, 2u, 3u, 4u } ) == 1u;
+            passed &= rooms_with( { 1u, 2u, 3u, 4u, 5u } ) == 3u;
+            passed &= rooms_with( { 6u } ) == 2u;
+            passed &= rooms_with( { 6u, 3u } ) == 3u;
+            passed &= rooms_with( { 6u, 1u } ) == 2u;
+        }
+        std::cout << "door requirements: " << ( passed ? "PASSED" : "FAILED" ) << '\n';
+        return passed;
+    }
+
+    // 0 <-> 1 free, 1 -> 2 behind Key 1, 2 <-> 3 free, 3 -> 1 free, 4 has no door in
+    auto analysis( ) -> bool {
+        solver::Graph graph;
+        graph.n_nodes = 5u;
+        graph.keys = { { "NULL", 1u }, { "Key 1", 1u }, { "Key 2", 1u } };
+        for ( size_t i = 0; i < graph.n_nodes; ++i ) graph.rooms.push_back( { "Room " + std::to_string( i ), 99999u } );
+        graph.blockades = { { 0u, 1u, { } }, { 1u, 0u, { } }, { 1u, 2u, { { 1u } } }, { 2u, 3u, { } }, { 3u, 2u, { } }, { 3u, 1u, { } }, { 4u, 0u, { { 2u } } } };
+        auto result = solver::analyze( graph );
+        bool passed = result.components == 2u && result.free_components == 3u;
+        passed &= result.component[0] == result.component[3] && result.component[4] != result.component[0];
+        passed &= result.free_component[0] == result.free_component[1] && result.free_component[2] == result.free_component[3] && result.free_component[1] != result.free_component[2];
+        passed &= result.unreachable.count( ) == 1u && result.unreachable.test( 4u );
+        passed &= result.behind_key[1].count( ) == 2u && result.behind_key[1].test( 2u ) && result.behind_key[1].test( 3u ) && result.behind_key[2].count( ) == 0u;
+        passed &= !solver::report_analysis( graph, result );
+        auto joined = solver::generate_state( graph );
+        passed &= joined.node_begin.size( ) == 4u;
+
+        // Joined rooms expand the same as rooms one by one
+        auto fuzz = synthetic_graph( 300u, 30u, 11u );
+        auto plain = solver::generate_state( fuzz, false );
+        auto state = solver::generate_state( fuzz );
+        std::mt19937_64 generator{ 11u };
+        for ( int i = 0; i < 50; ++i ) {
+            for ( auto &placement : state.placements ) placement.node.assign( 1u, generator( ) % fuzz.n_nodes );
+            plain.placements = state.placements;
+            passed &= solver::reachable_rooms( fuzz, state ).words == solver::reachable_rooms( fuzz, plain ).words;
+        }
+        std::cout << "graph analysis: " << ( passed ? "PASSED" : "FAILED" ) << " (" << state.node_begin.size( ) - 1u << " nodes for " << fuzz.n_nodes << " rooms)\n";
+        return passed;
+    }
+
+    // 0 -> 1 behind Key 1, 1 -> 2 behind Key 2 or Key 4, Key 1 and Key 4 start in room 0, Key 2 in 1 and Key 3 in 2
+    // Key 4 comes with Key 1, so rooms 1 and 2 both open in the second sphere
+    auto spheres( ) -> bool {
+        solver::Graph graph;
+        graph.n_nodes = 3u;
+        graph.keys = { { "NULL", 1u }, { "Key 1", 1u }, { "Key 2", 1u }, { "Key 3", 1u }, { "Key 4", 1u } };
+        for ( size_t i = 0; i < graph.n_nodes; ++i ) graph.rooms.push_back( { "Room " + std::to_string( i ), 99999u } );
+        graph.blockades = { { 0u, 1u, { { 1u } } }, { 1u, 2u, { { 2u }, { 4u } } } };
+        auto state = solver::generate_state( graph );
+        state.placements[1].node = { 0u };
+        state.placements[2].node = { 1u };
+        state.placements[3].node = { 2u };
+        state.placements[4].node = { 0u };
+        auto result = solver::playthrough( graph, state );
+        bool passed = result.spheres.size( ) == 2u && result.spheres[0].keys == std::vector< uint32_t >{ 1u, 4u };
+        passed &= result.key_sphere[1] == 0u && result.key_sphere[2] == 1u && result.key_sphere[3] == 1u && result.key_sphere[4] == 0u;
+        // Key 2 is dropped first, then Key 4 is needed for room 2
+        passed &= result.required == std::vector< uint32_t >{ 1u, 4u };
+
+        solver::DepthStats stats, other;
+        stats.add( result );
+        state.placements[3].node.clear( );
+        other.add( solver::playthrough( graph, state ) );
+        stats.merge( other );
+        std::stringstream csv;
+        stats.write_csv( graph, csv );
+        std::string line;
+        std::getline( csv, line );
+        passed &= line == "key,seeds,required,never,mean,sphere 0,sphere 1";
+        std::getline( csv, line );
+        passed &= line == "\"Key 1\",2,2,0,0,2,0";
+        std::getline( csv, line );
+        std::getline( csv, line );
+        passed &= line == "\"Key 3\",2,0,1,1,0,1";
+        std::cout << "spheres: " << ( passed ? "PASSED" : "FAILED" ) << '\n';
+        return passed;
+    }
+
+    // What the analyze command does per seed, on a fuzz graph
+    auto placement_stats( ) -> bool {
+        using clock = std::chrono::steady_clock;
+        auto graph = synthetic_graph( 300u, 30u, 5u );
+        uint64_t const seeds = 2000u;
+        solver::PlacementStats stats, half;
+        auto start = clock::now( );
+        for ( uint64_t seed = 0; seed < seeds; ++seed ) {
+            auto state = solver::generate_state( graph );
+            solver::solve( graph, state, seed );
+            ( seed % 2u ? stats : half ).add( graph, state, solver::playthrough( graph, state ) );
+        }
+        double seconds = std::chrono::duration< double >( clock::now( ) - start ).count( );
+        stats.merge( half );
+        bool passed = stats.depths.seeds == seeds;
+        // Every key is placed once per seed, and a required stop holds a placed key
+        for ( size_t key = 1; key < graph.keys.size( ); ++key ) {
+            uint64_t placed = 0;
+            for ( size_t room = 0; room < graph.n_nodes; ++room ) placed += stats.key_rooms[key * graph.n_nodes + room];
+            passed &= placed == seeds;
+        }
+        for ( size_t room = 0; room < graph.n_nodes; ++room ) {
+            uint64_t placed = 0;
+            for ( size_t key = 1; key < graph.keys.size( ); ++key ) placed += stats.key_rooms[key * graph.n_nodes + room];
+            passed &= stats.required_stops[room] <= placed;
+        }
+        std::stringstream rooms;
+        stats.write_rooms_csv( graph, rooms );
+        std::string line;
+        std::getline( rooms, line );
+        passed &= line == "room,required stop seeds,fraction,keys per seed";
+        std::cout << "placement stats: " << ( passed ? "PASSED" : "FAILED" ) << " (" << static_cast< double >( seeds ) / seconds << " seeds/s)\n";
+        return passed;
+    }
+
+    // Rooms are picked in proportion to the keys they can still take, full ones never
+    auto capacity( ) -> bool {
+        solver::Graph graph;
+        graph.n_nodes = 3u;
+        graph.keys = { { "NULL", 1u }, { "Key 1", 1u } };
+        graph.rooms = { { "Empty", 0u }, { "Two", 2u }, { "One", 1u } };
+        auto state = solver::generate_state( graph );
+        std::mt19937_64 generator{ 42u };
+        std::vector< size_t > const valid{ 0u, 1u, 2u };
+        size_t picked[3]{ };
+        for ( int i = 0; i < 30000; ++i ) ++picked[solver::pick_slot( state, valid, generator ).room];
+        bool passed = picked[0] == 0u && picked[1] > 19000u && picked[1] < 21000u;
+        auto frontier = solver::generate_frontier( graph, state );
+        solver::place_key( graph, state, frontier, 1u, 2u );
+        passed &= state.capacity_left[2] == 0u && solver::pick_slot( state, { 0u, 2u }, generator ).room == SIZE_MAX;
+        std::cout << "room capacity: " << ( passed ? "PASSED" : "FAILED" ) << '\n';
+        return passed;
+    }
+
+    // Solved placements and random ones, which mostly fail, must give the same rooms lane by lane as the scalar expansion
+    auto sliced( ) -> bool {
+        using clock = std::chrono::steady_clock;
+        auto graph = synthetic_graph( 300u, 30u, 7u );
+        std::mt19937_64 generator{ 7u };
+        std::vector< solver::GraphState > states;
+        for ( uint64_t seed = 0; seed < 200u; ++seed ) {
+            auto state = solver::generate_state( graph );
+            if ( seed % 2u ) solver::solve( graph, state, seed );
+            else for ( size_t key = 1; key < graph.keys.size( ); ++key ) state.placements[key].node.push_back( generator( ) % graph.n_nodes );
+            states.push_back( std::move( state ) );
+        }
+        auto start = clock::now( );
+        auto unreached = solver::check_solutions( graph, states );
+        double sliced_s = std::chrono::duration< double >( clock::now( ) - start ).count( );
+        start = clock::now( );
+        std::vector< solver::Bits > reached;
+        for ( auto const &state : states ) reached.push_back( solver::reachable_rooms( graph, state ) );
+        double scalar_s = std::chrono::duration< double >( clock::now( ) - start ).count( );
+        bool passed = unreached.size( ) == states.size( );
+        size_t failing = 0;
+        for ( size_t i = 0; i < states.size( ) && passed; ++i ) {
+            for ( size_t room = 0; room < graph.n_nodes; ++room ) passed &= reached[i].test( room ) != unreached[i].test( room );
+            failing += unreached[i].count( ) != 0u;
+        }
+        passed &= failing > 0u && failing < states.size( );
+        std::cout << "sliced check: " << ( passed ? "PASSED" : "FAILED" ) << " (" << failing << " of " << states.size( ) << " placements fail, " << sliced_s * 1e3 << " ms sliced, " << scalar_s * 1e3 << " ms scalar)\n";
+        return passed;
+    }
+
+    auto unit( ) -> bool {
+        bool passed = true;
+        passed &= solver::solver_test1( );
+        passed &= solver::solver_test2( );
+        passed &= solver::solver_test3( );
+        passed &= reachable( );
+        passed &= requirements( );
+        passed &= capacity( );
+        passed &= analysis( );
+        passed &= spheres( );
+        passed &= placement_stats( );
+        passed &= sliced( );
+        return passed;
+    }
+
+    auto fuzz( Options const &options ) -> bool {
+        using clock = std::chrono::steady_clock;
+        std::atomic< uint64_t > next_seed{ options.first_seed };
+        std::atomic< uint64_t > solved{ 0u };
+        std::atomic< int64_t > solve_ns{ 0 };
+        std::mutex failures_mutex;
+        std::vector< uint64_t > failures;
+        uint64_t const last_seed = options.first_seed + options.seeds;
+
+        auto worker = [&]( ) {
+            for ( uint64_t seed = next_seed++; seed < last_seed; seed = next_seed++ ) {
+                auto graph = synthetic_graph( options.rooms, options.keys, seed );
+                auto start = clock::now( );
+                auto state = solver::generate_state( graph );
+                solver::solve( graph, state, seed );
+                bool ok = solver::check_solution( graph, state );
+                solve_ns += std::chrono::duration_cast< std::chrono::nanoseconds >( clock::now( ) - start ).count( );
+                ++solved;
+                if ( !ok ) {
+                    std::lock_guard lock{ failures_mutex };
+                    failures.push_back( seed );
+                }
+            }
+        };
+
+        auto start = clock::now( );
+        std::vector< std::jthread > workers;
+        for ( unsigned i = 0; i < options.threads; ++i ) workers.emplace_back( worker );
+        workers.clear( );
+        double wall = std::chrono::duration< double >( clock::now( ) - start ).count( );
+        double busy = static_cast< double >( solve_ns.load( ) ) * 1e-9;
+
+        std::cout << "rooms: " << options.rooms << " keys: " << options.keys << " threads: " << options.threads << '\n';
+        std::cout << "solves: " << solved << " in " << wall << " s, " << static_cast< double >( solved ) / wall << " solves/s";
+        if ( busy > 0.0 ) std::cout << ", " << static_cast< double >( solved ) / busy << " solves/s per thread";
+        std::cout << '\n';
+        std::sort( failures.begin( ), failures.end( ) );
+        std::cout << "failures: " << failures.size( ) << '\n';
+        for ( auto seed : failures ) std::cout << "\tseed " << seed << '\n';
+        return failures.empty( );
+    }
+}
+
+int main( int argc, char *argv[] ) try {
+    test::Options options{ argc, argv };
+    bool passed = true;
+    if ( options.unit ) passed &= test::unit( );
+    if ( options.fuzz ) passed &= test::fuzz( options );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ
@@ -0,0 +1,102 @@
+#include "modules/spoiler_log.hpp"
+#include "check.hxx"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace test {
+    // The same calls made on a Json and a Binary writer
+    auto sample( spoiler_log::Writer &log, int records ) {
+        log.field( "enemy_seed", uint64_t{ 42u } );
+        log.section( "generators" );
+        for ( int i = 0; i < records; ++i ) {
+            log.begin_record( );
+            log.field( "map", "m10_02_00_00" );
+            log.field( "generator", i );
+            log.field( "enemy", -6750 + i );
+            log.field( "roaming_boss", i % 7 == 0 );
+            log.end_record( );
+        }
+        log.section( "shops" );
+        log.begin_record( );
+        log.field( "name", std::string{ "Say \"hi\"\\\n" } );
+        log.field( "price_mult", 1.5 );
+        log.end_record( );
+        log.field( "item_seed", int64_t{ -1 } );
+    }
+
+    // Sections, records and escaping come out as the documented layout
+    auto json( ) -> bool {
+        std::stringstream out;
+        {
+            spoiler_log::Writer log{ out, spoiler_log::Format::Json };
+            sample( log, 2 );
+        }
+        std::string const expected =
+            "{\n\"enemy_seed\":42,\n\"generators\":[\n"
+            "{\"map\":\"m10_02_00_00\",\"generator\":0,\"enemy\":-6750,\"roaming_boss\":true},\n"
+            "{\"map\":\"m10_02_00_00\",\"generator\":1,\"enemy\":-6749,\"roaming_boss\":false}\n],\n"
+            "\"shops\":[\n{\"name\":\"Say \\\"hi\\\"\\\\\\u000a\",\"price_mult\":1.5}\n],\n"
+            "\"item_seed\":-1\n}\n";
+        return check( out.str( ) == expected, "json" );
+    }
+
+    // A binary log far over the writer's buffer reads back to the Json text, and is smaller
+    auto binary( ) -> bool {
+        std::stringstream json, binary, replayed;
+        uint64_t records = 0;
+        {
+            spoiler_log::Writer text{ json, spoiler_log::Format::Json };
+            spoiler_log::Writer log{ binary, spoiler_log::Format::Binary };
+            sample( text, 20000 );
+            sample( log, 20000 );
+            records = log.records( );
+        }
+        bool ok = records == 20001u;
+        ok &= spoiler_log::binary_to_json( binary, replayed ) && replayed.str( ) == json.str( );
+        ok &= binary.str( ).size( ) * 2u < json.str( ).size( );
+        std::stringstream truncated{ binary.str( ).substr( 0u, binary.str( ).size( ) / 2u ) }, ignored;
+        ok &= !spoiler_log::binary_to_json( truncated, ignored );
+        ok &= spoiler_log::format_of( "spoiler.json" ) == spoiler_log::Format::Json && spoiler_log::format_of( "spoiler.bin" ) == spoiler_log::Format::Binary;
+        return check( ok, "binary" );
+    }
+
+    // Logs written apart and replayed one after the other read like one log written in that order
+    auto replay( ) -> bool {
+        std::stringstream direct, joined, first, second;
+        {
+            spoiler_log::Writer log{ direct, spoiler_log::Format::Json };
+            sample( log, 3 );
+            sample( log, 2 );
+        }
+        {
+            spoiler_log::Writer a{ first, spoiler_log::Format::Binary }, b{ second, spoiler_log::Format::Binary };
+            sample( b, 2 );
+            sample( a, 3 );
+        }
+        uint64_t records = 0;
+        bool ok = true;
+        {
+            spoiler_log::Writer log{ joined, spoiler_log::Format::Json };
+            ok &= spoiler_log::replay( first, log ) && spoiler_log::replay( second, log );
+            records = log.records( );
+        }
+        ok &= joined.str( ) == direct.str( ) && records == 7u;
+        return check( ok, "replay" );
+    }
+}
+
+int main( ) try {
+    bool passed = true;
+    passed &= test::json( );
+    passed &= test::binary( );
+    passed &= test::replay( );
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch (std::exception const &e) {
+    std::cerr << "std::exception: " << e.what( ) << std::endl;
+    return EXIT_FAILURE;
+} // main( ) try
+
+// Ⓒ 2025 Oleg'Ease'Kharchuk ᦒ